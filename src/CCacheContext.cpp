@@ -51,22 +51,78 @@ CCacheContext::CCacheContext(
 	const string& ccname,
 	const string& realm,
 	const string& host,
-	const int port
-)	:	Context("", realm, host, port),
-		_ccache(NULL)
+	const int port,
+	const bool lazy,
+	shared_ptr<Krb5Context> krb5
+)	:	Context("", realm, host, port, krb5),
+		_ccname(ccname),
+		_ccache(NULL),
+		_credentials(),
+		_lazy(lazy)
 {
 	KADM5_DEBUG("CCacheContext::CCacheContext(): Constructing...\n");
 	
 	// Tricky: 'this' is not yet completely initialized so be careful(!)
-	string f = ccname.empty() ? krb5_cc_default_name(*this) : ccname;
-	if (f.find(":") == string::npos) {
-		f.insert(0, "FILE:");
+	if (_ccname.empty()) {
+		_ccname = krb5_cc_default_name(*this);
 	}
+	if (_ccname.find(":") == string::npos) {
+		_ccname.insert(0, "FILE:");
+	}
+	
+	if (!_lazy) {
+		establish_handle();
+	}
+}
+
+
+CCacheContext::CCacheContext(
+	shared_ptr<MemoryCCache> credentials,
+	const string& client,
+	const string& realm,
+	const string& host,
+	const int port,
+	const bool lazy,
+	shared_ptr<Krb5Context> krb5
+)	:	Context(client, realm, host, port, krb5),
+		_ccname(credentials ? credentials->name() : ""),
+		_ccache(NULL),
+		_credentials(credentials),
+		_lazy(lazy)
+{
+	KADM5_DEBUG("CCacheContext::CCacheContext(): Constructing...\n");
+	if (!_lazy && _credentials) {
+		establish_handle();
+	}
+}
+
+
+void CCacheContext::open_handle()
+{
+	connect(_credentials ? _credentials->client().c_str() : NULL);
+}
+
 
+void CCacheContext::use_credentials(shared_ptr<MemoryCCache> credentials)
+{
+	if (_ccache) {
+		krb5_cc_close(*this, _ccache);
+		_ccache = NULL;
+	}
+	_credentials = credentials;
+	_ccname = credentials->name();
+}
+
+
+void CCacheContext::connect(const char* client)
+{
 	KADM5_DEBUG(
-		"CCacheContext(): Opening credential cache '" + f + "'\n"
+		"CCacheContext(): Opening credential cache '" + _ccname + "'\n"
 	);
-	krb5_cc_resolve(*this, f.c_str(), &_ccache);
+	// A failed lazy connect may be retried; keep the resolved cache.
+	if (!_ccache) {
+		krb5_cc_resolve(*this, _ccname.c_str(), &_ccache);
+	}
 	
 	// Test whether credential cache exists; kadm5_init_... won't do it.
 	krb5_principal ptmp = NULL;
@@ -77,7 +133,7 @@ CCacheContext::CCacheContext(
 	error::throw_on_error(
 		kadm5_init_with_creds_ctx(
 			*this,
-			NULL,
+			client,
 			_ccache,
 			KADM5_ADMIN_SERVICE,
 			config_params().get(),
@@ -90,6 +146,50 @@ CCacheContext::CCacheContext(
 }
 
 
+shared_ptr<Context> CCacheContext::clone() const
+{
+	// Reuse the original connection parameters rather than the values
+	// derived from them (e.g., host()), so the clone behaves the same.
+	string realm;
+	string host;
+	int port = 0;
+	shared_ptr<MemoryCCache> pcreds;
+	{
+		boost::mutex::scoped_lock lock(handle_mutex());
+		shared_ptr<kadm5_config_params> pp = config_params();
+		realm = pp->realm ? pp->realm : "";
+		host = pp->admin_server ? pp->admin_server : "";
+		port = (pp->mask & KADM5_CONFIG_KADMIND_PORT) ?
+				pp->kadmind_port : 0;
+		pcreds = _credentials;
+	}
+	
+	shared_ptr<CCacheContext> pclone;
+	if (pcreds) {
+		pclone.reset(
+			new CCacheContext(
+				pcreds,
+				pcreds->client(),
+				realm,
+				host,
+				port,
+				_lazy,
+				krb5()
+			)
+		);
+	}
+	else {
+		pclone.reset(
+			new CCacheContext(
+				_ccname, realm, host, port, _lazy, krb5()
+			)
+		);
+	}
+	pclone->inherit_failover(*this);
+	return pclone;
+}
+
+
 CCacheContext::~CCacheContext()
 {
 	// Tricky aswell: Context part of 'this' still exists right now.
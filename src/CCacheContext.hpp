@@ -42,11 +42,12 @@
 
 // Local
 #include "Context.hpp"
+#include "MemoryCCache.hpp"
 
 namespace kadm5
 {
 
-//using boost::shared_ptr;
+using boost::shared_ptr;
 using std::string;
 
 /**
@@ -78,22 +79,113 @@ public:
 	 * \param	port	The KAdmin server's port number.
 	 * 			If <code>0</code>, the libraries' default
 	 * 			port number is used.
+	 * \param	lazy	If true, connect on the first use of the
+	 * 			KAdmin handle instead of now.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
 	 **/
 	explicit CCacheContext(
 		const string& ccname,
 		const string& realm,
 		const string& host,
-		const int port
+		const int port,
+		const bool lazy =false,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
 	);
 	
 	/**
 	 * Releases all held resources.
 	 **/
 	virtual ~CCacheContext();
+	
+	/**
+	 * Open another connection with credentials from the same cache.
+	 * 
+	 * \return	a smart pointer to the new CCacheContext.
+	 **/
+	virtual shared_ptr<Context> clone() const;
+
+protected:
+	/**
+	 * Constructs a new CCacheContext that uses the given in-memory
+	 * credentials. The MemoryCCache will be kept alive as long as this
+	 * Context exists.
+	 * 
+	 * \param	credentials	The credentials to connect with. If
+	 * 			empty, the derived class must supply them with
+	 * 			use_credentials() and connect by itself.
+	 * \param	client	The name of the Kerberos principal the
+	 * 			credentials belong to.
+	 * \param	realm	The Kerberos realm for this context. If empty,
+	 * 			the default realm will be used.
+	 * \param	host	Hostname of the KAdmin server to which to
+	 *			connect. If empty, defaults to the used realm's
+	 * 			<code>admin_server</code> config parameter.
+	 * \param	port	The KAdmin server's port number. If
+	 * 			<code>0</code>, the libraries' default port
+	 * 			number is used.
+	 * \param	lazy	If true, connect on the first use of the
+	 * 			KAdmin handle instead of now.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
+	 **/
+	explicit CCacheContext(
+		shared_ptr<MemoryCCache> credentials,
+		const string& client,
+		const string& realm,
+		const string& host,
+		const int port,
+		const bool lazy =false,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
+	);
+	
+	/**
+	 * Connect to the KAdmin server on first use (see
+	 * Context::open_handle()).
+	 **/
+	virtual void open_handle();
+	
+	/**
+	 * Check whether this Context was constructed to connect lazily.
+	 * 
+	 * \return	true if the connection is opened on first use.
+	 **/
+	const bool lazy() const { return _lazy; }
+	
+	/**
+	 * Connect with the given in-memory credentials from now on, e.g.,
+	 * because the previous ones expired. Must not be called while a
+	 * KAdmin handle is open since that refers to the old cache.
+	 * 
+	 * \param	credentials	The credentials to connect with.
+	 **/
+	void use_credentials(shared_ptr<MemoryCCache> credentials);
+	
+	/**
+	 * Get the in-memory credentials this Context connects with.
+	 * 
+	 * \return	the MemoryCCache; empty for other caches.
+	 **/
+	shared_ptr<MemoryCCache> credentials() const { return _credentials; }
 
 private:
+	/**
+	 * Helper function for the constructors: open the credential cache
+	 * with the given name and connect to the KAdmin server.
+	 * 
+	 * \param	client	The principal to authenticate as; NULL
+	 * 			uses the cache's principal.
+	 **/
+	void connect(const char* client);
+	
+	/** Name of the used credential cache (of form TYPE:ID). */
+	string _ccname;
 	/** Used credential cache. */
 	krb5_ccache _ccache;
+	/** In-memory credentials to keep alive; NULL for other caches. */
+	shared_ptr<MemoryCCache> _credentials;
+	/** Whether the connection is opened on first use. */
+	bool _lazy;
 };
 
 } /* namespace kadm5 */
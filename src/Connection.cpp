@@ -32,9 +32,15 @@
 
 
 // STL and Boost
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
 #include <string>
 #include <vector>
+#include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 // Kerberos
 #include <krb5.h>
@@ -46,8 +52,15 @@
 #include "Connection.hpp"
 #include "Context.hpp"
 #include "Error.hpp"
+#include "KeytabContext.hpp"
+#include "KeytabWriter.hpp"
+#include "LocalContext.hpp"
+#include "NameStream.hpp"
+#include "PartitionedNameStream.hpp"
 #include "PasswordContext.hpp"
 #include "Principal.hpp"
+#include "RandomPassword.hpp"
+#include "RecordCache.hpp"
 
 
 namespace kadm5
@@ -62,24 +75,56 @@ shared_ptr<Connection> Connection::from_password(
 	const string& client,
 	const string& realm,
 	const string& host,
-	const int port
+	const int port,
+	const bool lazy
 ) {
 	shared_ptr<Context> pc(
-		new PasswordContext(password, client, realm, host, port)
+		new PasswordContext(password, client, realm, host, port, lazy)
 	);
 
 	return shared_ptr<Connection>( new Connection(pc) );
 }
 
 
+shared_ptr<Connection> Connection::from_keytab(
+	const string& keytab,
+	const string& client,
+	const string& realm,
+	const string& host,
+	const int port,
+	const bool lazy
+) {
+	shared_ptr<Context> pc(
+		new KeytabContext(keytab, client, realm, host, port, lazy)
+	);
+	
+	return shared_ptr<Connection>( new Connection(pc) );
+}
+
+
+shared_ptr<Connection> Connection::from_local(
+	const string& dbname,
+	const string& realm,
+	const string& client,
+	const bool lazy
+) {
+	shared_ptr<Context> pc(
+		new LocalContext(dbname, realm, client, lazy)
+	);
+	
+	return shared_ptr<Connection>( new Connection(pc) );
+}
+
+
 shared_ptr<Connection> Connection::from_credential_cache(
 	const string& ccname,
 	const string& realm,
 	const string& host,
-	const int port
+	const int port,
+	const bool lazy
 ) {
 	shared_ptr<Context> pc(
-		new CCacheContext(ccname, realm, host, port)
+		new CCacheContext(ccname, realm, host, port, lazy)
 	);
 	
 	return shared_ptr<Connection>( new Connection(pc) );
@@ -88,42 +133,68 @@ shared_ptr<Connection> Connection::from_credential_cache(
 
 
 Connection::Connection(shared_ptr<Context> context)
-	:	_context(context)
+	:	_context(context),
+		_privileges(0),
+		_privileges_fetched(boost::posix_time::not_a_date_time),
+		_privilege_ttl(boost::posix_time::pos_infin),
+		_privilege_queries(0),
+		_hot_prefixes(new PartitionedNameStream::HotPrefixes)
 {
+	// Reuse the privileges fetched while connecting, if any. Otherwise
+	// they will be fetched on the first privilege test.
+	if (_context->initial_privileges(_privileges)) {
+		_privileges_fetched =
+			boost::posix_time::microsec_clock::universal_time();
+	}
 }
 
 
 shared_ptr<Principal> Connection::create_principal(
 	const string& name,
-	const string& password
+	const string& password,
+	const CreateMode mode
 ) const
 {
 	if (!may_add()) {
 		throw add_auth_missing(KADM5_AUTH_ADD);
 	}
 	
-	shared_ptr< vector<string> > pexisting( list_principals(name) );
-	
-	// A bad principal name will throw an exception in list_principals(),
-	// so this test will work correctly.
-	if (!pexisting->empty()) {
-		throw already_exists(KADM5_DUP);
-	}
-
+	// A bad principal name will throw an exception here already.
 	shared_ptr<Principal> pp(
 		new Principal(_context, name, password)
 	);
-	
+	check_new(*pp, mode);
 	return pp;
 }
 
 
+Principal Connection::create_principal_value(
+	const string& name,
+	const string& password,
+	const CreateMode mode
+) const
+{
+	if (!may_add()) {
+		throw add_auth_missing(KADM5_AUTH_ADD);
+	}
+	
+	// A single returned object lets the compiler construct it in place.
+	Principal ret(_context, name, password);
+	check_new(ret, mode);
+	return ret;
+}
+
+
 void Connection::delete_principal(const string& id) const
 {
 	Principal p(_context, id);
 	error::throw_on_error(
-		kadm5_delete_principal(*_context, p._id.get())
+		_context->execute(
+			boost::bind(kadm5_delete_principal, _1, p._id.get()),
+			false
+		)
 	);
+	p.invalidate_cached(*_context, p._id.get());
 }
 
 
@@ -133,32 +204,48 @@ shared_ptr<Principal> Connection::get_principal(const string& id) const
 		throw get_auth_missing(KADM5_AUTH_GET);
 	}
 	
-	shared_ptr< vector<string> > pcandidates( list_principals(id) );
-	
-	// Unambiguous description suffices.
-	if (pcandidates->size() == 1) {
-		shared_ptr<Principal> pret(
-			new Principal(_context, (*pcandidates)[0])
-		);
+	// Exact names need no (server-side) search through the database.
+	if (!is_pattern(id)) {
+		shared_ptr<Principal> pret( new Principal(_context, id) );
+		pret->load_existing(*_context, Principal::default_fields);
 		return pret;
 	}
-	else if (pcandidates->size() < 1) {
-		throw unknown_principal(KADM5_UNK_PRINC);
+	
+	shared_ptr<Principal> pret( new Principal(_context, match_one(id)) );
+	pret->mark_existing();
+	return pret;
+}
+
+
+Principal Connection::get_principal_value(const string& id) const
+{
+	if (!may_get()) {
+		throw get_auth_missing(KADM5_AUTH_GET);
+	}
+	
+	// A single returned object lets the compiler construct it in place.
+	const bool exact = !is_pattern(id);
+	Principal ret(_context, exact ? id : match_one(id));
+	if (exact) {
+		ret.load_existing(*_context, Principal::default_fields);
 	}
 	else {
-		throw ambiguous_name(0);
+		ret.mark_existing();
 	}
+	return ret;
 }
 
 
 shared_ptr< vector< shared_ptr<Principal> > > Connection::get_principals(
-	const string& filter
+	const string& filter,
+	const unsigned int prefetch,
+	const u_int32_t fields
 ) const {
 	if (!may_get()) {
 		throw add_auth_missing(KADM5_AUTH_GET);
 	}
 	
-	shared_ptr< vector<string> > pnames( list_principals(filter) );
+	shared_ptr<NameList> pnames( list_names(filter) );
 	
 	shared_ptr< vector< shared_ptr<Principal> > > pret(
 		new vector< shared_ptr<Principal> >
@@ -166,64 +253,658 @@ shared_ptr< vector< shared_ptr<Principal> > > Connection::get_principals(
 	pret->reserve(pnames->size());
 	
 	for (
-		vector<string>::const_iterator it = pnames->begin();
+		NameList::const_iterator it = pnames->begin();
 		it != pnames->end();
 		it++
 	) {
 		pret->push_back(
 			shared_ptr<Principal>(new Principal(_context, *it))
 		);
+		// Listed names exist; committing needs no check.
+		pret->back()->mark_existing();
+	}
+	
+	if (prefetch > 0) {
+		load_all(*pret, prefetch, fields);
 	}
 	
 	return pret;
 }
 
 
+shared_ptr<PrincipalSet> Connection::get_principal_set(
+	const string& filter,
+	const u_int32_t fields,
+	const unsigned int handles
+) const {
+	if (!may_get()) {
+		throw add_auth_missing(KADM5_AUTH_GET);
+	}
+	
+	shared_ptr<NameList> pnames( list_names(filter) );
+	return shared_ptr<PrincipalSet>(
+		new PrincipalSet(_context, *pnames, fields, handles)
+	);
+}
+
+
+shared_ptr<Connection::BatchResult> Connection::commit_batch(
+	const vector< shared_ptr<Principal> >& principals,
+	const unsigned int handles
+) const {
+	ptime start = boost::posix_time::microsec_clock::universal_time();
+	
+	shared_ptr<BatchResult> pret( new BatchResult );
+	pret->errors.assign(principals.size(), 0);
+	pret->committed = 0;
+	pret->failed = 0;
+	
+	// The workers only update their own handles' record caches, so
+	// drop the affected entries (old and new names) from ours now.
+	shared_ptr<RecordCache> pcache = _context->record_cache();
+	if (pcache) {
+		for (size_t i = 0; i < principals.size(); i++) {
+			pcache->invalidate(principals[i]->_id.get());
+			pcache->invalidate(principals[i]->_data->principal);
+		}
+	}
+	
+	// New Principals may need random passwords; initialize the shared
+	// default character classes before several threads use them.
+	CharClass::defaults();
+	
+	size_t n = std::min<size_t>(handles, principals.size());
+	if (n <= 1) {
+		commit_slice(_context, &principals, 0, 1, &pret->errors);
+	}
+	else {
+		// See load_all().
+		vector< shared_ptr<const Context> > workers;
+		workers.push_back(_context);
+		while (workers.size() < n) {
+			workers.push_back(_context->clone());
+		}
+		
+		boost::thread_group threads;
+		for (size_t i = 0; i < n; i++) {
+			threads.create_thread(
+				boost::bind(
+					commit_slice,
+					workers[i],
+					&principals,
+					i,
+					n,
+					&pret->errors
+				)
+			);
+		}
+		threads.join_all();
+	}
+	
+	for (size_t i = 0; i < pret->errors.size(); i++) {
+		if (pret->errors[i]) {
+			pret->failed++;
+		}
+		else {
+			pret->committed++;
+		}
+	}
+	pret->elapsed =
+		boost::posix_time::microsec_clock::universal_time() - start;
+	
+	return pret;
+}
+
+
+const double Connection::BatchResult::throughput() const
+{
+	double seconds = elapsed.total_microseconds() / 1e6;
+	if (seconds <= 0) {
+		return 0;
+	}
+	return (committed + failed) / seconds;
+}
+
+
+/**
+ * Deleter for writers passed by reference to Connection::export_keytab();
+ * they stay owned by the caller.
+ * 
+ * \param	pw	The writer (ignored).
+ **/
+static void keep_writer(KeytabWriter*) {}
+
+
+shared_ptr<Connection::BatchResult> Connection::export_keytab(
+	const vector<string>& names,
+	KeytabWriter& writer,
+	const bool randomize,
+	const unsigned int handles,
+	const size_t batch_size
+) const {
+	vector< shared_ptr<KeytabWriter> > writers(
+		1, shared_ptr<KeytabWriter>(&writer, keep_writer)
+	);
+	return export_keytab(names, writers, randomize, handles, batch_size);
+}
+
+
+shared_ptr<Connection::BatchResult> Connection::export_keytab(
+	const vector<string>& names,
+	const vector< shared_ptr<KeytabWriter> >& writers,
+	const bool randomize,
+	const unsigned int handles,
+	const size_t batch_size
+) const {
+	if (writers.empty() ||
+		(writers.size() != 1 && writers.size() != names.size())
+	) {
+		error::throw_on_error(EINVAL);
+	}
+	
+	ptime start = boost::posix_time::microsec_clock::universal_time();
+	
+	shared_ptr<BatchResult> pret( new BatchResult );
+	pret->errors.assign(names.size(), 0);
+	pret->committed = 0;
+	pret->failed = 0;
+	
+	size_t batch = std::max<size_t>(batch_size, 1);
+	size_t n = std::min<size_t>(handles, std::min(batch, names.size()));
+	
+	// See load_all().
+	vector< shared_ptr<const Context> > workers;
+	workers.push_back(_context);
+	while (workers.size() < n) {
+		workers.push_back(_context->clone());
+	}
+	
+	shared_ptr<RecordCache> pcache = _context->record_cache();
+	
+	for (size_t offset = 0; offset < names.size(); offset += batch) {
+		size_t count = std::min(batch, names.size() - offset);
+		
+		vector< shared_ptr<krb5_principal_data> > principals(count);
+		vector< vector<ExportedKey> > keys(count);
+		vector<int32_t> errors(count, 0);
+		for (size_t i = 0; i < count; i++) {
+			try {
+				principals[i] =
+					parse_name(_context, names[offset + i]);
+			}
+			catch (const error& e) {
+				errors[i] = e.error_code() ?
+						e.error_code() : KADM5_FAILURE;
+			}
+		}
+		
+		if (n <= 1) {
+			export_slice(
+				_context, &principals, 0, 1, randomize,
+				&keys, &errors
+			);
+		}
+		else {
+			boost::thread_group threads;
+			for (size_t i = 0; i < n; i++) {
+				threads.create_thread(
+					boost::bind(
+						export_slice,
+						workers[i],
+						&principals,
+						i,
+						n,
+						randomize,
+						&keys,
+						&errors
+					)
+				);
+			}
+			threads.join_all();
+		}
+		
+		// All entries of a batch share one timestamp.
+		time_t now = time(NULL);
+		for (size_t i = 0; i < count; i++) {
+			if (randomize && pcache && principals[i]) {
+				pcache->invalidate(principals[i].get());
+			}
+			
+			KeytabWriter& w = *writers[
+				writers.size() == 1 ? 0 : offset + i
+			];
+			for (size_t k = 0; k < keys[i].size(); k++) {
+				ExportedKey& key = keys[i][k];
+				if (key.key.empty()) {
+					continue;
+				}
+				if (!errors[i]) {
+					try {
+						w.add(
+							*_context,
+							principals[i].get(),
+							key.kvno,
+							key.enctype,
+							&key.key[0],
+							key.key.size(),
+							now
+						);
+					}
+					catch (const error& e) {
+						errors[i] = e.error_code() ?
+							e.error_code() :
+							KADM5_FAILURE;
+					}
+				}
+				memset(&key.key[0], 0, key.key.size());
+			}
+			
+			pret->errors[offset + i] = errors[i];
+		}
+	}
+	
+	for (size_t i = 0; i < writers.size(); i++) {
+		writers[i]->flush();
+	}
+	
+	for (size_t i = 0; i < pret->errors.size(); i++) {
+		if (pret->errors[i]) {
+			pret->failed++;
+		}
+		else {
+			pret->committed++;
+		}
+	}
+	pret->elapsed =
+		boost::posix_time::microsec_clock::universal_time() - start;
+	
+	return pret;
+}
+
+
 shared_ptr< vector<string> > Connection::list_principals(
 	const string& filter
+) const {
+	return list_names(filter)->strings();
+}
+
+
+shared_ptr<NameList> Connection::list_names(const string& filter) const
+{
+	if (!may_list()) {
+		throw list_auth_missing(KADM5_AUTH_LIST);
+	}
+	
+	return shared_ptr<NameList>( new NameList(_context, filter) );
+}
+
+
+shared_ptr<NameStream> Connection::stream_principals(
+	const string& filter
 ) const {
 	if (!may_list()) {
 		throw list_auth_missing(KADM5_AUTH_LIST);
 	}
+	
+	return shared_ptr<NameStream>( new NameStream(_context, filter) );
+}
+
 
-	char** list = NULL;
-	int count = 0;
+shared_ptr<PartitionedNameStream> Connection::stream_principals_partitioned(
+	const string& filter,
+	const unsigned int handles
+) const {
+	if (!may_list()) {
+		throw list_auth_missing(KADM5_AUTH_LIST);
+	}
 	
+	// The stream's threads run while this Connection is in use, so they
+	// get connections of their own.
+	vector< shared_ptr<const Context> > workers;
+	while (workers.size() < std::max(handles, 1u)) {
+		workers.push_back(_context->clone());
+	}
+	
+	return shared_ptr<PartitionedNameStream>(
+		new PartitionedNameStream(workers, filter, _hot_prefixes)
+	);
+}
+
+
+void Connection::refresh_privileges() const
+{
+	u_int32_t p;
+
+	error::throw_on_error(
+		_context->execute(boost::bind(kadm5_get_privs, _1, &p), true)
+	);
+	_privilege_queries++;
+	
+	_privileges = p;
+	_privileges_fetched =
+		boost::posix_time::microsec_clock::universal_time();
+}
+
+
+void Connection::enable_record_cache(
+	const size_t capacity,
+	const time_duration& ttl
+) const {
+	_context->enable_record_cache(capacity, ttl);
+}
+
+
+void Connection::disable_record_cache() const
+{
+	_context->disable_record_cache();
+}
+
+
+const unsigned long Connection::record_cache_hits() const
+{
+	shared_ptr<RecordCache> pcache = _context->record_cache();
+	return pcache ? pcache->hits() : 0;
+}
+
+
+const unsigned long Connection::record_cache_misses() const
+{
+	shared_ptr<RecordCache> pcache = _context->record_cache();
+	return pcache ? pcache->misses() : 0;
+}
+
+
+void Connection::load_slice(
+	shared_ptr<const Context> handle,
+	const vector< shared_ptr<Principal> >* principals,
+	const size_t first,
+	const size_t step,
+	const u_int32_t fields,
+	int32_t* result
+) {
 	try {
+		for (size_t i = first; i < principals->size(); i += step) {
+			(*principals)[i]->load(*handle, fields);
+		}
+	}
+	catch (const error& e) {
+		*result = e.error_code() ? e.error_code() : KADM5_FAILURE;
+	}
+	catch (const std::bad_alloc&) {
+		*result = ENOMEM;
+	}
+	catch (...) {
+		*result = KADM5_FAILURE;
+	}
+}
+
+
+void Connection::commit_slice(
+	shared_ptr<const Context> handle,
+	const vector< shared_ptr<Principal> >* principals,
+	const size_t first,
+	const size_t step,
+	vector<int32_t>* errors
+) {
+	for (size_t i = first; i < principals->size(); i += step) {
+		try {
+			(*principals)[i]->commit(*handle);
+		}
+		catch (const error& e) {
+			(*errors)[i] = e.error_code() ?
+					e.error_code() : KADM5_FAILURE;
+		}
+		catch (const std::bad_alloc&) {
+			(*errors)[i] = ENOMEM;
+		}
+		catch (...) {
+			(*errors)[i] = KADM5_FAILURE;
+		}
+	}
+}
+
+
+void Connection::export_slice(
+	shared_ptr<const Context> handle,
+	const vector< shared_ptr<krb5_principal_data> >* principals,
+	const size_t first,
+	const size_t step,
+	const bool randomize,
+	vector< vector<ExportedKey> >* keys,
+	vector<int32_t>* errors
+) {
+	for (size_t i = first; i < principals->size(); i += step) {
+		if ((*errors)[i]) {
+			continue;
+		}
+		try {
+			fetch_keys(
+				*handle, (*principals)[i].get(), randomize,
+				(*keys)[i]
+			);
+		}
+		catch (const error& e) {
+			(*errors)[i] = e.error_code() ?
+					e.error_code() : KADM5_FAILURE;
+		}
+		catch (const std::bad_alloc&) {
+			(*errors)[i] = ENOMEM;
+		}
+		catch (...) {
+			(*errors)[i] = KADM5_FAILURE;
+		}
+	}
+}
+
+
+void Connection::fetch_keys(
+	const Context& handle,
+	krb5_principal pp,
+	const bool randomize,
+	vector<ExportedKey>& keys
+) {
+	kadm5_principal_ent_rec ent;
+	memset(&ent, 0, sizeof(kadm5_principal_ent_rec));
+	
+	if (randomize) {
+		krb5_keyblock* pkeys = NULL;
+		int n_keys = 0;
 		error::throw_on_error(
-			kadm5_get_principals(
-				*_context,
-				filter.c_str(),
-				&list,
-				&count
+			handle.execute(
+				boost::bind(
+					kadm5_randkey_principal,
+					_1,
+					pp,
+					&pkeys,
+					&n_keys
+				),
+				false
 			)
 		);
 		
-		// Initialize vector with the list of principal names
-		// (treat char** pointer as iterator).
-		shared_ptr< vector<string> > pret(
-			new vector<string>(list, list + count)
+		// Copy the new keys before anything else can fail, so that
+		// they are erased in any case.
+		try {
+			keys.resize(n_keys);
+			for (int i = 0; i < n_keys; i++) {
+				const char* pkey = static_cast<const char*>(
+					pkeys[i].keyvalue.data
+				);
+				keys[i].enctype = pkeys[i].keytype;
+				keys[i].key.assign(
+					pkey, pkey + pkeys[i].keyvalue.length
+				);
+			}
+		}
+		catch (...) {
+			for (int i = 0; i < n_keys; i++) {
+				krb5_free_keyblock_contents(handle, &pkeys[i]);
+			}
+			free(pkeys);
+			throw;
+		}
+		for (int i = 0; i < n_keys; i++) {
+			krb5_free_keyblock_contents(handle, &pkeys[i]);
+		}
+		free(pkeys);
+		
+		// The new version number is not returned with the keys.
+		error::throw_on_error(
+			handle.execute(
+				boost::bind(
+					kadm5_get_principal, _1, pp, &ent, KADM5_KVNO
+				),
+				true
+			)
 		);
+		for (size_t i = 0; i < keys.size(); i++) {
+			keys[i].kvno = ent.kvno;
+		}
+		kadm5_free_principal_ent(handle, &ent);
+		return;
+	}
 	
-		return pret;
-	} catch (...) {
-		if (list) {
-			kadm5_free_name_list(*_context, list, &count);
+	error::throw_on_error(
+		handle.execute(
+			boost::bind(
+				kadm5_get_principal,
+				_1,
+				pp,
+				&ent,
+				KADM5_KVNO | KADM5_KEY_DATA
+			),
+			true
+		)
+	);
+	try {
+		for (int i = 0; i < ent.n_key_data; i++) {
+			const krb5_key_data& data = ent.key_data[i];
+			// Without the get-keys privilege, the server sends
+			// the key records with empty contents.
+			if (data.key_data_length[0] <= 0 ||
+				!data.key_data_contents[0]
+			) {
+				continue;
+			}
+			const char* pkey = static_cast<const char*>(
+				data.key_data_contents[0]
+			);
+			ExportedKey key;
+			key.kvno = data.key_data_kvno;
+			key.enctype = data.key_data_type[0];
+			keys.push_back(key);
+			keys.back().key.assign(
+				pkey, pkey + data.key_data_length[0]
+			);
 		}
+	}
+	catch (...) {
+		kadm5_free_principal_ent(handle, &ent);
 		throw;
 	}
+	kadm5_free_principal_ent(handle, &ent);
+	
+	if (keys.empty()) {
+		throw get_auth_missing(KADM5_AUTH_GET);
+	}
 }
 
 
-const bool Connection::has_privilege(u_int32_t flags) const
+void Connection::load_all(
+	const vector< shared_ptr<Principal> >& principals,
+	const unsigned int handles,
+	const u_int32_t fields
+) const {
+	size_t n = std::min<size_t>(handles, principals.size());
+	
+	if (n <= 1) {
+		for (size_t i = 0; i < principals.size(); i++) {
+			principals[i]->load(*_context, fields);
+		}
+		return;
+	}
+	
+	// A Context must not be used by several threads at once, so every
+	// worker gets its own connection. Open them here (contexts are not
+	// thread-safe during construction either) and keep using this
+	// Connection's one in the first worker.
+	vector< shared_ptr<const Context> > workers;
+	workers.push_back(_context);
+	while (workers.size() < n) {
+		workers.push_back(_context->clone());
+	}
+	
+	vector<int32_t> results(n, 0);
+	boost::thread_group threads;
+	for (size_t i = 0; i < n; i++) {
+		threads.create_thread(
+			boost::bind(
+				load_slice,
+				workers[i],
+				&principals,
+				i,
+				n,
+				fields,
+				&results[i]
+			)
+		);
+	}
+	threads.join_all();
+	
+	for (size_t i = 0; i < n; i++) {
+		error::throw_on_error(results[i]);
+	}
+}
+
+
+const bool Connection::is_pattern(const string& name)
 {
-	u_int32_t p;
+	return name.find_first_of("*?[") != string::npos;
+}
 
-	error::throw_on_error(
-		kadm5_get_privs(*_context, &p)
-	);
+
+const string Connection::match_one(const string& pattern) const
+{
+	shared_ptr<NameList> pcandidates( list_names(pattern) );
+	
+	// Unambiguous description suffices.
+	if (pcandidates->size() == 1) {
+		return (*pcandidates)[0];
+	}
+	else if (pcandidates->size() < 1) {
+		throw unknown_principal(KADM5_UNK_PRINC);
+	}
+	else {
+		throw ambiguous_name(0);
+	}
+}
+
+
+void Connection::check_new(Principal& p, const CreateMode mode) const
+{
+	if (mode == create_checked) {
+		if (p.probe()) {
+			throw already_exists(KADM5_DUP);
+		}
+	}
+	else {
+		// Without this, committing would look the name up anyway and
+		// modify the entry if it exists.
+		p.mark_absent();
+	}
+}
+
+
+const bool Connection::has_privilege(u_int32_t flags) const
+{
+	if (	_privileges_fetched.is_not_a_date_time() ||
+		(boost::posix_time::microsec_clock::universal_time() -
+			_privileges_fetched >= _privilege_ttl)
+	) {
+		refresh_privileges();
+	}
 	
-	return (flags & p) == flags;
+	return (flags & _privileges) == flags;
 }
 
 
@@ -37,6 +37,7 @@
 // STL and Boost
 #include <string>
 #include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/shared_ptr.hpp>
 
 // Kerberos
@@ -45,16 +46,22 @@
 
 // Local
 #include "Context.hpp"
+#include "KeytabWriter.hpp"
+#include "NameList.hpp"
+#include "NameStream.hpp"
+#include "PartitionedNameStream.hpp"
+#include "Principal.hpp"
+#include "PrincipalSet.hpp"
 
 namespace kadm5
 {
 
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
 using boost::shared_ptr;
 using std::string;
 using std::vector;
 
-class Principal;
-
 /**
  * \brief
  * Represents a Connection to a KAdmin server.
@@ -73,6 +80,50 @@ class Principal;
 class Connection
 {
 public:
+	/**
+	 * Ways in which create_principal() makes sure that a new Principal's
+	 * name is not already taken.
+	 **/
+	enum CreateMode {
+		/**
+		 * Look up the name with a single request before creating the
+		 * Principal in memory.
+		 **/
+		create_checked,
+		/**
+		 * Skip the check. If the name is taken, the server refuses
+		 * the creation in Principal::commit_modifications(), which
+		 * then throws already_exists.
+		 **/
+		create_optimistic
+	};
+	
+	/**
+	 * \brief
+	 * Outcome of commit_batch().
+	 **/
+	struct BatchResult
+	{
+		/**
+		 * Error code per Principal, in the order they were passed;
+		 * <code>0</code> if the commit succeeded. See error.
+		 **/
+		vector<int32_t> errors;
+		/** Number of successful commits. */
+		size_t committed;
+		/** Number of failed commits. */
+		size_t failed;
+		/** Wall-clock time the batch took. */
+		time_duration elapsed;
+		
+		/**
+		 * Get the number of commits (successful or not) per second.
+		 * 
+		 * \return	the batch's throughput.
+		 **/
+		const double throughput() const;
+	};
+	
 	///@{\name Factory Functions
 	
 	/**
@@ -91,6 +142,9 @@ public:
 	 * 			<code>admin_server</code> parameter in the
 	 * 			Kerberos configuration.
 	 * \param	port	The KAdmin server's port number.
+	 * \param	lazy	If true, only resolve the configuration now
+	 * 			and connect on the first operation (see
+	 * 			Context::open_handle()).
 	 * \return	a smart pointer to the created and initialized
 	 * 		Connection.
 	 **/
@@ -99,11 +153,71 @@ public:
 		const string& client ="",
 		const string& realm ="",
 		const string& host ="",
-		const int port =0
+		const int port =0,
+		const bool lazy =false
+	);
+	
+	/**
+	 * Factory function that creates a Connection, authenticating with a
+	 * key from the given keytab. The KAdmin service ticket is kept in
+	 * memory and shared with other Connections for the same keytab and
+	 * client until it is about to expire (see
+	 * MemoryCCache::from_keytab()).
+	 * 
+	 * \param	keytab	The name of the keytab holding the client's
+	 * 			key. If empty, the libraries' default keytab
+	 * 			will be used.
+	 * \param	client	The name of the Kerberos principal to
+	 * 			authenticate as. If missing, the libraries'
+	 * 			default value will be used.
+	 * \param	realm	The realm to assume if this part of a
+	 * 			Principal's name is omitted. If missing,
+	 * 			the libraries' default value will be used.
+	 * \param	host	Hostname of the KAdmin server to connect to.
+	 * 			If missing, defaults to the
+	 * 			<code>admin_server</code> parameter in the
+	 * 			Kerberos configuration.
+	 * \param	port	The KAdmin server's port number.
+	 * \param	lazy	If true, only resolve the configuration now
+	 * 			and connect on the first operation (see
+	 * 			Context::open_handle()).
+	 * \return	a smart pointer to the created and initialized
+	 * 		Connection.
+	 **/
+	static shared_ptr<Connection> from_keytab(
+		const string& keytab ="",
+		const string& client ="",
+		const string& realm ="",
+		const string& host ="",
+		const int port =0,
+		const bool lazy =false
 	);
-// TODO Implement
-//	static shared_ptr<Connection> from_keytab();
 
+	/**
+	 * Factory function that creates a Connection operating directly on
+	 * the principal database, without a KAdmin server (see
+	 * LocalContext). Only usable on the KDC host.
+	 * 
+	 * \param	dbname	The name of the principal database. If empty,
+	 * 			the configured database will be used.
+	 * \param	realm	The realm to assume if this part of a
+	 * 			Principal's name is omitted. If missing,
+	 * 			the libraries' default value will be used.
+	 * \param	client	The name to record as modifier and check
+	 * 			against the ACL. If missing,
+	 * 			<code>kadmin/admin</code> will be used.
+	 * \param	lazy	If true, open the database on the first
+	 * 			operation.
+	 * \return	a smart pointer to the created and initialized
+	 * 		Connection.
+	 **/
+	static shared_ptr<Connection> from_local(
+		const string& dbname ="",
+		const string& realm ="",
+		const string& client ="",
+		const bool lazy =false
+	);
+	
 	/**
 	 * Factory function that creates a Connection from authentication
 	 * information in a credential cache.
@@ -122,6 +236,9 @@ public:
 	 * 			If empty, defaults to the used realm's
 	 * 			<code>admin_server</code> config parameter.
 	 * \param	port	The KAdmin server's port number.
+	 * \param	lazy	If true, only resolve the configuration now
+	 * 			and connect on the first operation (see
+	 * 			Context::open_handle()).
 	 * \return	a smart pointer to the freshly created and
 	 * 		initialized Connection.
 	 **/
@@ -129,14 +246,16 @@ public:
 		const string& ccname = "",
 		const string& realm ="",
 		const string& host ="",
-		const int port =0
+		const int port =0,
+		const bool lazy =false
 	);
 	///@}
 
 	/**
 	 * Create a new Principal with the given name in memory.
 	 * 
-	 * This function may throw exceptions if the Principal already exists.
+	 * This function may throw exceptions if the Principal already exists
+	 * (unless <code>mode</code> is <code>create_optimistic</code>).
 	 * 
 	 * \note
 	 * The creation remains unnoticed by the server until
@@ -151,12 +270,33 @@ public:
 	 * \param	password	The new Principal's password. If empty,
 	 * 			defaults to a completely random key. (See
 	 * 			Principal::randomize_keys().)
+	 * \param	mode	How to check whether the name is already
+	 * 			taken. See CreateMode.
 	 * \return	a smart pointer to a new Principal instance that does
 	 * 		not yet exist in the Kerberos database.
 	 **/
 	shared_ptr<Principal> create_principal(
 		const string& name,
-		const string& password =""
+		const string& password ="",
+		const CreateMode mode =create_checked
+	) const;
+	
+	/**
+	 * Create a new Principal like create_principal(), but return it by
+	 * value. It is moved out with C++11; before, compilers elide the
+	 * copy.
+	 * 
+	 * \param	name	The name of the new Principal.
+	 * \param	password	The new Principal's password.
+	 * \param	mode	How to check whether the name is already
+	 * 			taken. See CreateMode.
+	 * \return	a new Principal that does not yet exist in the
+	 * 		Kerberos database.
+	 **/
+	Principal create_principal_value(
+		const string& name,
+		const string& password ="",
+		const CreateMode mode =create_checked
 	) const;
 	
 	/**
@@ -173,6 +313,12 @@ public:
 	/**
 	 * Fetch a Kerberos Principal from the database.
 	 * 
+	 * If <code>id</code> contains no wildcard characters
+	 * (<code>*</code>, <code>?</code> or <code>[</code>), the entry is
+	 * looked up directly with a single request. Otherwise, <code>id</code>
+	 * is treated as a search pattern that must match exactly one
+	 * Principal.
+	 * 
 	 * \note
 	 * Modifications remain unnoticed by the server until
 	 * Principal::commit_modifications() is executed.
@@ -184,26 +330,154 @@ public:
 	 **/
 	shared_ptr<Principal> get_principal(const string& id) const;
 	
+	/**
+	 * Fetch a Kerberos Principal like get_principal(), but return it by
+	 * value. It is moved out with C++11; before, compilers elide the
+	 * copy.
+	 * 
+	 * \param	id	The id (name) of the Kerberos Principal to
+	 * 			fetch.
+	 * \return	the fetched Principal.
+	 **/
+	Principal get_principal_value(const string& id) const;
+	
 	/**
 	 * Fetch a list of Kerberos Principals whose names match the given
 	 * search string.
 	 * 
+	 * By default, the Principals' data is fetched lazily, that is, with
+	 * one request per Principal when its attributes are first accessed.
+	 * If <code>prefetch</code> is positive, all data is loaded before
+	 * returning. With <code>prefetch > 1</code>, the requests are spread
+	 * over that many connections to the KAdmin server (this Connection
+	 * and clones of its Context), which work concurrently.
+	 * 
 	 * \note
 	 * Modifications to the Principals remain unnoticed by the server until
 	 * Principal::commit_modifications() is executed.
 	 * 
 	 * \param	filter	The search string against which the Principal
 	 * 			names are matched.
+	 * \param	prefetch	The number of connections used to
+	 * 			load the Principals' data in advance. If
+	 * 			<code>0</code>, data is fetched lazily.
+	 * \param	fields	Bit-mask of the attributes to prefetch (see
+	 * 			Principal::Field). Restricting them reduces
+	 * 			the transferred data; other attributes are
+	 * 			fetched on access.
 	 * \return	a list containing all Principals whose names match the
 	 *		filter.
 	 **/
 	shared_ptr< vector< shared_ptr<Principal> > > get_principals(
-		const string& filter
+		const string& filter,
+		const unsigned int prefetch =0,
+		const u_int32_t fields =Principal::default_fields
+	) const;
+	
+	/**
+	 * Fetch the entries of all Kerberos Principals whose names match the
+	 * given search string into a read-only PrincipalSet.
+	 * 
+	 * Use this instead of get_principals() to read many entries: the set
+	 * stores them together and needs only a few allocations in total,
+	 * where get_principals() needs several per Principal. Principals
+	 * removed between listing and fetching are skipped.
+	 * 
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \param	fields	Bit-mask of the attributes to fetch (see
+	 * 			Principal::Field).
+	 * \param	handles	The number of connections fetching the entries
+	 * 			concurrently (see get_principals()).
+	 * \return	the set of matching Principals' entries.
+	 **/
+	shared_ptr<PrincipalSet> get_principal_set(
+		const string& filter,
+		const u_int32_t fields =Principal::default_fields,
+		const unsigned int handles =1
+	) const;
+	
+	/**
+	 * Commit the modifications of many Principals, spreading them over
+	 * up to <code>handles</code> concurrent connections (see
+	 * Context::clone()). Unlike calling
+	 * Principal::commit_modifications() in a loop, a failure does not
+	 * stop the batch; the error code of each Principal is recorded in
+	 * the result instead.
+	 * 
+	 * \note
+	 * Each Principal must appear at most once, and none of them may be
+	 * used by other threads during the call.
+	 * 
+	 * \param	principals	The Principals to commit. They must
+	 * 			belong to this Connection.
+	 * \param	handles	The maximum number of connections to use.
+	 * \return	the per-Principal results and throughput.
+	 **/
+	shared_ptr<BatchResult> commit_batch(
+		const vector< shared_ptr<Principal> >& principals,
+		const unsigned int handles =4
+	) const;
+	
+	/**
+	 * Write the current keys of many principals to keytabs. The keys
+	 * are fetched in batches of <code>batch_size</code> principals over
+	 * up to <code>handles</code> concurrent connections (see
+	 * Context::clone()); each batch is then added through the writers
+	 * before the next one is fetched. A failure does not stop the
+	 * export; the error code of each principal is recorded in the
+	 * result instead.
+	 * 
+	 * Exporting existing keys requires the <code>get-keys</code>
+	 * privilege, which kadmind does not include in <code>all</code>.
+	 * 
+	 * \note
+	 * The writers are flushed, but not closed, when the export is done.
+	 * 
+	 * \param	names	The names of the principals to export.
+	 * \param	writers	Either a single writer receiving all keys,
+	 * 			or one writer per name. A writer may occur
+	 * 			several times.
+	 * \param	randomize	If true, give the principals new random
+	 * 			keys (see Principal::randomize_keys()) and
+	 * 			export those.
+	 * \param	handles	The maximum number of connections to use.
+	 * \param	batch_size	The number of principals whose keys are
+	 * 			held in memory at once.
+	 * \return	the per-principal results and throughput.
+	 **/
+	shared_ptr<BatchResult> export_keytab(
+		const vector<string>& names,
+		const vector< shared_ptr<KeytabWriter> >& writers,
+		const bool randomize =false,
+		const unsigned int handles =4,
+		const size_t batch_size =64
+	) const;
+	
+	/**
+	 * Write the current keys of many principals to a single keytab.
+	 * See export_keytab() above.
+	 * 
+	 * \param	names	The names of the principals to export.
+	 * \param	writer	The writer receiving all keys.
+	 * \param	randomize	If true, export new random keys.
+	 * \param	handles	The maximum number of connections to use.
+	 * \param	batch_size	The number of principals whose keys are
+	 * 			held in memory at once.
+	 * \return	the per-principal results and throughput.
+	 **/
+	shared_ptr<BatchResult> export_keytab(
+		const vector<string>& names,
+		KeytabWriter& writer,
+		const bool randomize =false,
+		const unsigned int handles =4,
+		const size_t batch_size =64
 	) const;
 	
 	/**
 	 * Fetch a list of <em>names</em> of Kerberos Principals matching the
-	 * given search string.
+	 * given search string. The names are copied into strings; use
+	 * list_names() to read them without copying.
 	 * 
 	 * \param	filter	The search string against which the Principal
 	 * 			names are matched.
@@ -213,6 +487,50 @@ public:
 	shared_ptr< vector<string> > list_principals(
 		const string& filter
 	) const;
+	
+	/**
+	 * Fetch the <em>names</em> of Kerberos Principals matching the given
+	 * search string, kept in the buffer the KAdmin library returned (see
+	 * NameList).
+	 * 
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \return	the list of all Principal names that match the filter.
+	 **/
+	shared_ptr<NameList> list_names(const string& filter) const;
+	
+	/**
+	 * Fetch the <em>names</em> of Kerberos Principals matching the given
+	 * search string one after another. Unlike list_principals(), the
+	 * names are requested in chunks while they are read, so memory usage
+	 * does not depend on the number of matching Principals. See
+	 * NameStream for details.
+	 * 
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \return	a stream of all Principal names that match the filter.
+	 **/
+	shared_ptr<NameStream> stream_principals(const string& filter) const;
+	
+	/**
+	 * Fetch the <em>names</em> of Kerberos Principals matching the given
+	 * search string concurrently over several connections, in sorted
+	 * order. The search string is split into disjoint partitions that
+	 * are fetched in parallel; prefixes found to match many names are
+	 * split further in later calls. See PartitionedNameStream for
+	 * details.
+	 * 
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \param	handles	The number of connections to open (clones
+	 * 			of this Connection's Context).
+	 * \return	a sorted stream of all Principal names that match
+	 * 		the filter.
+	 **/
+	shared_ptr<PartitionedNameStream> stream_principals_partitioned(
+		const string& filter,
+		const unsigned int handles =4
+	) const;
 
 
 	 ///@{\name Privilege Tests
@@ -291,6 +609,85 @@ public:
 	 * \return	true if this Connection has all privileges.
 	 **/
 	const bool may_all() const { return has_privilege(KADM5_PRIV_ALL); }
+	
+	/**
+	 * Fetch this Connection's privileges from the KAdmin server again.
+	 * 
+	 * The privilege tests above use a cached copy of the privileges that
+	 * is filled when connecting. Call this method after changing the
+	 * server's ACLs to see the new privileges immediately.
+	 **/
+	void refresh_privileges() const;
+	
+	/**
+	 * Get the time after which cached privileges are considered stale
+	 * and fetched from the server again.
+	 * 
+	 * \return	the privilege cache's time-to-live. Defaults to
+	 * 		<code>boost::posix_time::pos_infin</code> (never
+	 * 		refetch automatically).
+	 **/
+	const time_duration privilege_ttl() const { return _privilege_ttl; }
+	
+	/**
+	 * Set the time after which cached privileges are considered stale.
+	 * 
+	 * \param	ttl	The privilege cache's new time-to-live. Use
+	 * 			<code>boost::posix_time::pos_infin</code> to
+	 * 			keep the privileges until refresh_privileges()
+	 * 			is called, or a zero duration to ask the server
+	 * 			on every privilege test.
+	 **/
+	void set_privilege_ttl(const time_duration& ttl) { _privilege_ttl = ttl; }
+	
+	/**
+	 * Get the number of times this Connection asked the KAdmin server for
+	 * its privileges (not counting the check while connecting).
+	 * 
+	 * \return	the number of <code>kadm5_get_privs</code> calls
+	 * 		issued by this Connection.
+	 **/
+	const unsigned long privilege_queries() const { return _privilege_queries; }
+	///@}
+	
+	///@{\name Principal Record Cache
+	/**
+	 * Cache the Principal records fetched through this Connection, so
+	 * repeated requests for the same Principals need not ask the KAdmin
+	 * server again. Changing, renaming or deleting a Principal through
+	 * this Connection drops its cached record; changes made elsewhere
+	 * are noticed once the record expires. See RecordCache.
+	 * 
+	 * \param	capacity	The maximum number of cached records;
+	 * 			the least recently used ones are dropped first.
+	 * \param	ttl	The time after which a record expires.
+	 **/
+	void enable_record_cache(
+		const size_t capacity =1024,
+		const time_duration& ttl =boost::posix_time::seconds(30)
+	) const;
+	
+	/**
+	 * Stop caching Principal records (the default).
+	 **/
+	void disable_record_cache() const;
+	
+	/**
+	 * Get the number of Principal loads answered from the record cache.
+	 * 
+	 * \return	the cache's hit counter; <code>0</code> if caching
+	 * 		is disabled.
+	 **/
+	const unsigned long record_cache_hits() const;
+	
+	/**
+	 * Get the number of Principal loads that had to ask the server
+	 * although the record cache was enabled.
+	 * 
+	 * \return	the cache's miss counter; <code>0</code> if caching
+	 * 		is disabled.
+	 **/
+	const unsigned long record_cache_misses() const;
 	///@}
 	
 	
@@ -324,9 +721,106 @@ public:
 	 * \return	the KAdmin server's port number.
 	 **/
 	const int port() const { return _context->port(); }
+	
+	/**
+	 * Re-read the Kerberos configuration and determine the connection
+	 * information above again (see Context::reload_config()).
+	 **/
+	void reload_config() { _context->reload_config(); }
+	
+	/**
+	 * Check whether the connection to the KAdmin server is open. It
+	 * is always open unless the Connection was created lazily and not
+	 * used yet.
+	 * 
+	 * \return	true if connected; otherwise false.
+	 **/
+	const bool connected() const { return _context->connected(); }
+	///@}
+	
+	
+	///@{\name Reconnect and Failover
+	/**
+	 * Get the KAdmin servers this Connection may fail over to (see
+	 * Context::admin_servers()).
+	 * 
+	 * \return	the list of admin servers.
+	 **/
+	const vector<string> admin_servers() const
+	{
+		return _context->admin_servers();
+	}
+	
+	/**
+	 * Set the KAdmin servers to use on the next reconnect (see
+	 * Context::set_admin_servers()).
+	 * 
+	 * \param	servers	The servers, of form <code>host</code> or
+	 * 			<code>host:port</code>.
+	 **/
+	void set_admin_servers(const vector<string>& servers)
+	{
+		_context->set_admin_servers(servers);
+	}
+	
+	/**
+	 * Set the order in which the admin servers are tried (see
+	 * Context::set_endpoint_order()).
+	 * 
+	 * \param	order	The new order.
+	 **/
+	void set_endpoint_order(const Context::EndpointOrder order)
+	{
+		_context->set_endpoint_order(order);
+	}
+	
+	/**
+	 * Set how operations are retried after the connection broke (see
+	 * Context::set_retry_policy()). Only reading operations and
+	 * modifications are retried; creating, deleting, renaming and
+	 * changing keys are not, since a lost reply may hide their success.
+	 * 
+	 * \param	retries	The maximum number of retries per operation.
+	 * \param	backoff	The delay before the second retry.
+	 **/
+	void set_retry_policy(
+		const unsigned int retries,
+		const time_duration& backoff
+	) {
+		_context->set_retry_policy(retries, backoff);
+	}
+	
+	/**
+	 * Drop the connection and open a new one (see
+	 * Context::reconnect()).
+	 **/
+	void reconnect() const { _context->reconnect(); }
+	
+	/**
+	 * Get the number of successful reconnects.
+	 * 
+	 * \return	the number of reconnects.
+	 **/
+	const unsigned long reconnects() const
+	{
+		return _context->reconnects();
+	}
+	
+	/**
+	 * Get the total time spent reconnecting.
+	 * 
+	 * \return	the time spent reconnecting.
+	 **/
+	const time_duration reconnect_time() const
+	{
+		return _context->reconnect_time();
+	}
 	///@}
 	
 private:
+	// The pool wraps the Contexts it opens in Connections.
+	friend class ConnectionPool;
+	
 	/**
 	 * Constructor called by the factory functions after creating a suitable
 	 * Context object.
@@ -346,9 +840,154 @@ private:
 	 * 		indicated by <code>flags</code>.
 	 **/
 	const bool has_privilege(u_int32_t flags) const;
+	
+	/**
+	 * Helper function to test whether a Principal name contains
+	 * wildcard characters, that is, whether it is a search pattern.
+	 * 
+	 * \param	name	The Principal name to test.
+	 * \return	true if <code>name</code> contains wildcards.
+	 **/
+	static const bool is_pattern(const string& name);
+	
+	/**
+	 * Helper function for get_principal(): find the single Principal
+	 * matching a search pattern.
+	 * 
+	 * \param	pattern	The search pattern.
+	 * \return	the name of the matching Principal.
+	 **/
+	const string match_one(const string& pattern) const;
+	
+	/**
+	 * Helper function for create_principal(): check whether the name
+	 * of a new Principal is taken, as requested by <code>mode</code>.
+	 * 
+	 * \param	p	The new Principal.
+	 * \param	mode	How to check the name. See CreateMode.
+	 **/
+	void check_new(Principal& p, const CreateMode mode) const;
+	
+	/**
+	 * Helper function to load the data of all given Principals,
+	 * using up to <code>handles</code> concurrent connections.
+	 * 
+	 * \param	principals	The Principals to load.
+	 * \param	handles	The maximum number of connections to use.
+	 * \param	fields	Bit-mask of the attributes to load.
+	 **/
+	void load_all(
+		const vector< shared_ptr<Principal> >& principals,
+		const unsigned int handles,
+		const u_int32_t fields
+	) const;
+	
+	/**
+	 * Helper function for load_all() that runs in a worker thread: load
+	 * every <code>step</code>-th Principal, beginning with
+	 * <code>first</code>, over the given handle. Exceptions are reported
+	 * through <code>result</code> as error code.
+	 * 
+	 * \param	handle	The connection to use.
+	 * \param	principals	All Principals to load.
+	 * \param	first	Index of the worker's first Principal.
+	 * \param	step	Distance between the worker's Principals.
+	 * \param	fields	Bit-mask of the attributes to load.
+	 * \param	result	Receives the error code; left untouched on
+	 * 			success.
+	 **/
+	static void load_slice(
+		shared_ptr<const Context> handle,
+		const vector< shared_ptr<Principal> >* principals,
+		const size_t first,
+		const size_t step,
+		const u_int32_t fields,
+		int32_t* result
+	);
 
+	/**
+	 * Thread function for commit_batch(): commit every
+	 * <code>step</code>th Principal, starting with the one at index
+	 * <code>first</code>, over the given handle.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	principals	All Principals to commit.
+	 * \param	first	Index of the first Principal of the slice.
+	 * \param	step	Distance between the slice's Principals.
+	 * \param	errors	Receives the error code of each Principal.
+	 **/
+	static void commit_slice(
+		shared_ptr<const Context> handle,
+		const vector< shared_ptr<Principal> >* principals,
+		const size_t first,
+		const size_t step,
+		vector<int32_t>* errors
+	);
+	
+	/**
+	 * \brief
+	 * A key fetched by export_slice().
+	 **/
+	struct ExportedKey
+	{
+		/** The key's version number. */
+		krb5_kvno kvno;
+		/** The key's encryption type. */
+		krb5_enctype enctype;
+		/** The raw key; wiped after it was written. */
+		vector<char> key;
+	};
+	
+	/**
+	 * Thread function for export_keytab(): fetch the keys of every
+	 * <code>step</code>th principal, starting with the one at index
+	 * <code>first</code>, over the given handle.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	principals	The principals of the current batch.
+	 * \param	first	Index of the first principal of the slice.
+	 * \param	step	Distance between the slice's principals.
+	 * \param	randomize	If true, set new random keys first.
+	 * \param	keys	Receives the keys of each principal.
+	 * \param	errors	Receives the error code of each principal.
+	 **/
+	static void export_slice(
+		shared_ptr<const Context> handle,
+		const vector< shared_ptr<krb5_principal_data> >* principals,
+		const size_t first,
+		const size_t step,
+		const bool randomize,
+		vector< vector<ExportedKey> >* keys,
+		vector<int32_t>* errors
+	);
+	
+	/**
+	 * Fetch the keys of a single principal for export_slice().
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	pp	The principal whose keys to fetch.
+	 * \param	randomize	If true, set new random keys first.
+	 * \param	keys	Receives the keys.
+	 **/
+	static void fetch_keys(
+		const Context& handle,
+		krb5_principal pp,
+		const bool randomize,
+		vector<ExportedKey>& keys
+	);
+	
 	/** Kerberos and KAdmin context for this Connection. */
 	shared_ptr<Context> _context;
+	/** Cached privilege bit-flags (valid if _privileges_fetched is set). */
+	mutable u_int32_t _privileges;
+	/** Time of the last privilege fetch; not_a_date_time if none. */
+	mutable ptime _privileges_fetched;
+	/** Time after which cached privileges are fetched again. */
+	time_duration _privilege_ttl;
+	/** Number of kadm5_get_privs calls issued by this Connection. */
+	mutable unsigned long _privilege_queries;
+	/** Prefixes that partitioned listings split further. */
+	shared_ptr<PartitionedNameStream::HotPrefixes> _hot_prefixes;
 };
 
 } /* namespace kadm5 */
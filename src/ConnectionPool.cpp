@@ -0,0 +1,352 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+
+// Local
+#include "CCacheContext.hpp"
+#include "ConnectionPool.hpp"
+#include "Error.hpp"
+#include "KeytabContext.hpp"
+#include "PasswordContext.hpp"
+
+namespace kadm5
+{
+
+using boost::posix_time::microsec_clock;
+
+
+shared_ptr<ConnectionPool> ConnectionPool::from_password(
+	const size_t size,
+	const string& password,
+	const string& client,
+	const string& realm,
+	const string& host,
+	const int port
+) {
+	shared_ptr<Context> pc(
+		new PasswordContext(password, client, realm, host, port)
+	);
+	
+	return shared_ptr<ConnectionPool>( new ConnectionPool(pc, size) );
+}
+
+
+shared_ptr<ConnectionPool> ConnectionPool::from_keytab(
+	const size_t size,
+	const string& keytab,
+	const string& client,
+	const string& realm,
+	const string& host,
+	const int port
+) {
+	shared_ptr<Context> pc(
+		new KeytabContext(keytab, client, realm, host, port)
+	);
+	
+	return shared_ptr<ConnectionPool>( new ConnectionPool(pc, size) );
+}
+
+
+shared_ptr<ConnectionPool> ConnectionPool::from_context(
+	const size_t size,
+	shared_ptr<Context> prototype
+) {
+	return shared_ptr<ConnectionPool>(
+		new ConnectionPool(prototype, size)
+	);
+}
+
+
+shared_ptr<ConnectionPool> ConnectionPool::from_credential_cache(
+	const size_t size,
+	const string& ccname,
+	const string& realm,
+	const string& host,
+	const int port
+) {
+	shared_ptr<Context> pc(
+		new CCacheContext(ccname, realm, host, port)
+	);
+	
+	return shared_ptr<ConnectionPool>( new ConnectionPool(pc, size) );
+}
+
+
+ConnectionPool::ConnectionPool(
+	shared_ptr<Context> prototype,
+	const size_t size
+) :
+	_prototype(prototype),
+	_size( std::max<size_t>(size, 1) ),
+	_open(1),
+	_idle(),
+	_check_interval( boost::posix_time::minutes(1) ),
+	_statistics(),
+	_mutex(),
+	_available(),
+	_hot_prefixes(new PartitionedNameStream::HotPrefixes)
+{
+	_statistics.acquisitions = 0;
+	_statistics.waits = 0;
+	_statistics.timeouts = 0;
+	_statistics.replacements = 0;
+	_statistics.total_wait = boost::posix_time::seconds(0);
+	_statistics.max_wait = boost::posix_time::seconds(0);
+	
+	// The prototype was just authenticated, so it needs no check.
+	_idle.push_back(
+		IdleEntry(
+			microsec_clock::universal_time(),
+			shared_ptr<Connection>( new Connection(_prototype) )
+		)
+	);
+}
+
+
+shared_ptr<Connection> ConnectionPool::acquire(const time_duration& timeout)
+{
+	ptime start = microsec_clock::universal_time();
+	boost::system_time deadline;
+	if (!timeout.is_pos_infinity()) {
+		deadline = boost::get_system_time() + timeout;
+	}
+	
+	shared_ptr<Connection> conn;
+	bool check = false;
+	{
+		boost::unique_lock<boost::mutex> lock(_mutex);
+		bool waited = false;
+		while (_idle.empty() && (_open >= _size)) {
+			waited = true;
+			if (timeout.is_pos_infinity()) {
+				_available.wait(lock);
+			}
+			else if (
+				!_available.timed_wait(lock, deadline) &&
+				_idle.empty() && (_open >= _size)
+			) {
+				time_duration waited_for =
+					microsec_clock::universal_time() - start;
+				_statistics.waits++;
+				_statistics.timeouts++;
+				_statistics.total_wait += waited_for;
+				_statistics.max_wait =
+					std::max(_statistics.max_wait, waited_for);
+				throw pool_exhausted(0);
+			}
+		}
+		
+		ptime now = microsec_clock::universal_time();
+		if (waited) {
+			_statistics.waits++;
+			_statistics.total_wait += now - start;
+			_statistics.max_wait =
+				std::max(_statistics.max_wait, now - start);
+		}
+		
+		if (!_idle.empty()) {
+			// The most recently returned Connection is the least
+			// likely to have timed out on the server.
+			conn = _idle.back().second;
+			check = (now - _idle.back().first >= _check_interval);
+			_idle.pop_back();
+		}
+		else {
+			// Reserve the slot; open the Connection without
+			// blocking the other threads.
+			_open++;
+		}
+	}
+	
+	if (conn && check && !healthy(*conn)) {
+		KADM5_DEBUG("ConnectionPool::acquire(): Replacing connection.\n");
+		conn.reset();
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			_statistics.replacements++;
+		}
+	}
+	
+	if (!conn) {
+		try {
+			conn = open();
+		}
+		catch (...) {
+			drop_slot();
+			throw;
+		}
+	}
+	
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		_statistics.acquisitions++;
+	}
+	return lease(conn);
+}
+
+
+shared_ptr<PartitionedNameStream>
+ConnectionPool::stream_principals_partitioned(
+	const string& filter,
+	const unsigned int handles
+) {
+	shared_ptr<Connection> first = acquire();
+	if (!first->may_list()) {
+		throw list_auth_missing(KADM5_AUTH_LIST);
+	}
+	
+	// Each handle keeps its lease until the stream's thread is done.
+	vector< shared_ptr<const Context> > workers;
+	workers.push_back(
+		shared_ptr<const Context>(first, first->_context.get())
+	);
+	while (workers.size() < handles) {
+		shared_ptr<Connection> conn;
+		try {
+			conn = acquire(boost::posix_time::seconds(0));
+		}
+		catch (const pool_exhausted&) {
+			break;
+		}
+		workers.push_back(
+			shared_ptr<const Context>(conn, conn->_context.get())
+		);
+	}
+	
+	return shared_ptr<PartitionedNameStream>(
+		new PartitionedNameStream(workers, filter, _hot_prefixes)
+	);
+}
+
+
+const ConnectionPool::Statistics ConnectionPool::statistics() const
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	
+	Statistics s(_statistics);
+	s.size = _size;
+	s.open = _open;
+	s.in_use = _open - _idle.size();
+	return s;
+}
+
+
+const time_duration ConnectionPool::check_interval() const
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _check_interval;
+}
+
+
+void ConnectionPool::set_check_interval(const time_duration& d)
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	_check_interval = d;
+}
+
+
+shared_ptr<Connection> ConnectionPool::open() const
+{
+	// Contexts are not thread-safe, but clone() only reads the
+	// prototype's connection parameters and failover state under the
+	// lock that a concurrent reconnect of the prototype holds.
+	return shared_ptr<Connection>( new Connection(_prototype->clone()) );
+}
+
+
+const bool ConnectionPool::healthy(const Connection& conn)
+{
+	try {
+		conn.refresh_privileges();
+		return true;
+	}
+	catch (const error&) {
+		return false;
+	}
+}
+
+
+void ConnectionPool::release(
+	weak_ptr<ConnectionPool> pool,
+	shared_ptr<Connection> conn,
+	Connection*
+) {
+	shared_ptr<ConnectionPool> pp = pool.lock();
+	if (pp) {
+		pp->give_back(conn);
+	}
+}
+
+
+void ConnectionPool::give_back(shared_ptr<Connection> conn)
+{
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		_idle.push_back(
+			IdleEntry(microsec_clock::universal_time(), conn)
+		);
+	}
+	_available.notify_one();
+}
+
+
+void ConnectionPool::drop_slot()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		_open--;
+	}
+	_available.notify_one();
+}
+
+
+shared_ptr<Connection> ConnectionPool::lease(shared_ptr<Connection> conn)
+{
+	return shared_ptr<Connection>(
+		conn.get(),
+		boost::bind(
+			release,
+			weak_ptr<ConnectionPool>( shared_from_this() ),
+			conn,
+			_1
+		)
+	);
+}
+
+
+} /* namespace kadm5 */
@@ -0,0 +1,368 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef CONNECTIONPOOL_HPP_
+#define CONNECTIONPOOL_HPP_
+
+// STL and Boost
+#include <deque>
+#include <string>
+#include <utility>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+// Local
+#include "Connection.hpp"
+#include "Context.hpp"
+#include "PartitionedNameStream.hpp"
+
+namespace kadm5
+{
+
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using boost::weak_ptr;
+using std::string;
+
+/**
+ * \brief
+ * A set of Connections to the same KAdmin server with the same credentials,
+ * to be shared by several threads.
+ * 
+ * A single Connection must not be used by several threads at once. Instead
+ * of serializing all threads on one Connection, or authenticating anew for
+ * every thread, let the threads lease Connections from a pool:
+ * \code
+ * shared_ptr<ConnectionPool> pool =
+ * 	ConnectionPool::from_password(8, "secret", "admin/admin");
+ * 
+ * // In each thread:
+ * {
+ * 	shared_ptr<Connection> conn = pool->acquire();
+ * 	conn->get_principal("user")->...;
+ * }	// The Connection returns to the pool here.
+ * \endcode
+ * 
+ * The pool authenticates once; the further connections are opened on
+ * demand with the same credentials (see Context::clone()). Connections
+ * that have been idle for a while are checked before they are handed out,
+ * and replaced if the check fails.
+ * 
+ * \note
+ * Principals remain bound to the Connection they were obtained from; do
+ * not use them after returning that Connection.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class ConnectionPool
+	: public boost::noncopyable,
+	  public boost::enable_shared_from_this<ConnectionPool>
+{
+public:
+	/**
+	 * \brief
+	 * Snapshot of a pool's occupancy and usage counters.
+	 **/
+	struct Statistics
+	{
+		/** Maximum number of Connections. */
+		size_t size;
+		/** Number of Connections currently open. */
+		size_t open;
+		/** Number of Connections currently leased. */
+		size_t in_use;
+		/** Number of successful acquire() calls. */
+		unsigned long acquisitions;
+		/** Number of acquire() calls that had to wait. */
+		unsigned long waits;
+		/** Number of acquire() calls that timed out. */
+		unsigned long timeouts;
+		/** Number of Connections replaced after a failed check. */
+		unsigned long replacements;
+		/** Total time spent waiting in acquire(). */
+		time_duration total_wait;
+		/** Longest time spent waiting in a single acquire() call. */
+		time_duration max_wait;
+	};
+	
+	///@{\name Factory Functions
+	
+	/**
+	 * Factory function that creates a pool, authenticating via the
+	 * given password. See Connection::from_password() for details on
+	 * the parameters.
+	 * 
+	 * \param	size	The maximum number of Connections.
+	 * \param	password	The password used for authentication.
+	 * \param	client	The name of the Kerberos principal to
+	 * 			authenticate as.
+	 * \param	realm	The default realm of the Connections.
+	 * \param	host	Hostname of the KAdmin server to connect to.
+	 * \param	port	The KAdmin server's port number.
+	 * \return	a smart pointer to the pool, holding one open
+	 * 		Connection.
+	 **/
+	static shared_ptr<ConnectionPool> from_password(
+		const size_t size,
+		const string& password,
+		const string& client ="",
+		const string& realm ="",
+		const string& host ="",
+		const int port =0
+	);
+	
+	/**
+	 * Factory function that creates a pool, authenticating with a key
+	 * from the given keytab. All Connections of the pool share one
+	 * KAdmin service ticket. See Connection::from_keytab() for details
+	 * on the parameters.
+	 * 
+	 * \param	size	The maximum number of Connections.
+	 * \param	keytab	The name of the keytab.
+	 * \param	client	The name of the Kerberos principal to
+	 * 			authenticate as.
+	 * \param	realm	The default realm of the Connections.
+	 * \param	host	Hostname of the KAdmin server to connect to.
+	 * \param	port	The KAdmin server's port number.
+	 * \return	a smart pointer to the pool, holding one open
+	 * 		Connection.
+	 **/
+	static shared_ptr<ConnectionPool> from_keytab(
+		const size_t size,
+		const string& keytab ="",
+		const string& client ="",
+		const string& realm ="",
+		const string& host ="",
+		const int port =0
+	);
+	
+	/**
+	 * Factory function that creates a pool from authentication
+	 * information in a credential cache. See
+	 * Connection::from_credential_cache() for details on the parameters.
+	 * 
+	 * \param	size	The maximum number of Connections.
+	 * \param	ccname	Use credentials from this cache.
+	 * \param	realm	The default realm of the Connections.
+	 * \param	host	Hostname of the KAdmin server to connect to.
+	 * \param	port	The KAdmin server's port number.
+	 * \return	a smart pointer to the pool, holding one open
+	 * 		Connection.
+	 **/
+	static shared_ptr<ConnectionPool> from_credential_cache(
+		const size_t size,
+		const string& ccname ="",
+		const string& realm ="",
+		const string& host ="",
+		const int port =0
+	);
+	
+	/**
+	 * Factory function that creates a pool around an existing Context,
+	 * e.g., a LocalContext or one of a class derived by the
+	 * application. Further Contexts are opened with Context::clone().
+	 * 
+	 * \param	size	The maximum number of Connections.
+	 * \param	prototype	The Context of the pool's first
+	 * 			Connection.
+	 * \return	a smart pointer to the pool, holding one Connection.
+	 **/
+	static shared_ptr<ConnectionPool> from_context(
+		const size_t size,
+		shared_ptr<Context> prototype
+	);
+	///@}
+	
+	/**
+	 * Lease a Connection from the pool. If none is idle, a new one is
+	 * opened unless the pool is full; then the call waits until another
+	 * thread returns a Connection.
+	 * 
+	 * The Connection returns to the pool as soon as the last copy of the
+	 * returned pointer is gone, even if the pool has been destroyed
+	 * meanwhile.
+	 * 
+	 * \param	timeout	The maximum time to wait for a Connection.
+	 * \return	a smart pointer to the leased Connection.
+	 * \throws	pool_exhausted if no Connection became available
+	 * 		within <code>timeout</code>.
+	 **/
+	shared_ptr<Connection> acquire(
+		const time_duration& timeout =boost::posix_time::pos_infin
+	);
+	
+	/**
+	 * Fetch the names of Kerberos Principals matching the given search
+	 * string concurrently over pooled Connections, in sorted order (see
+	 * Connection::stream_principals_partitioned()). Only the first
+	 * Connection is waited for; further ones are used if available
+	 * right away. They return to the pool when the stream is exhausted
+	 * or destroyed.
+	 * 
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \param	handles	The maximum number of Connections to use.
+	 * \return	a sorted stream of all Principal names that match
+	 * 		the filter.
+	 **/
+	shared_ptr<PartitionedNameStream> stream_principals_partitioned(
+		const string& filter,
+		const unsigned int handles =4
+	);
+	
+	/**
+	 * Get the maximum number of Connections.
+	 * 
+	 * \return	the pool's size.
+	 **/
+	const size_t size() const { return _size; }
+	
+	/**
+	 * Get the current occupancy and the usage counters.
+	 * 
+	 * \return	a consistent snapshot of the pool's statistics.
+	 **/
+	const Statistics statistics() const;
+	
+	/**
+	 * Get the idle time after which a Connection is checked before it
+	 * is handed out. Defaults to one minute.
+	 * 
+	 * \return	the idle time that triggers a check.
+	 **/
+	const time_duration check_interval() const;
+	
+	/**
+	 * Set the idle time after which a Connection is checked before it
+	 * is handed out. Use <code>0</code> to check on every acquire()
+	 * and <code>boost::posix_time::pos_infin</code> to never check.
+	 * 
+	 * \param	d	The idle time that triggers a check.
+	 **/
+	void set_check_interval(const time_duration& d);
+
+private:
+	/** An idle Connection and the time it was returned. */
+	typedef std::pair< ptime, shared_ptr<Connection> > IdleEntry;
+	
+	/**
+	 * Constructor called by the factory functions.
+	 * 
+	 * \param	prototype	The first Context; further ones are
+	 * 			cloned from it.
+	 * \param	size	The maximum number of Connections.
+	 **/
+	ConnectionPool(shared_ptr<Context> prototype, const size_t size);
+	
+	/**
+	 * Open another Connection with the prototype's credentials.
+	 * 
+	 * \return	a smart pointer to the new Connection.
+	 **/
+	shared_ptr<Connection> open() const;
+	
+	/**
+	 * Test whether a Connection still works by asking the server for
+	 * its privileges.
+	 * 
+	 * \param	conn	The Connection to test.
+	 * \return	true if the server answered.
+	 **/
+	static const bool healthy(const Connection& conn);
+	
+	/**
+	 * Custom deletion function for leased Connections: puts the
+	 * Connection back into the pool, or lets it close if the pool no
+	 * longer exists.
+	 * 
+	 * \param	pool	The pool the Connection was leased from.
+	 * \param	conn	The pooled Connection.
+	 * \param	plent	The lease's raw pointer (unused).
+	 **/
+	static void release(
+		weak_ptr<ConnectionPool> pool,
+		shared_ptr<Connection> conn,
+		Connection* plent
+	);
+	
+	/**
+	 * Make a returned Connection available again.
+	 * 
+	 * \param	conn	The returned Connection.
+	 **/
+	void give_back(shared_ptr<Connection> conn);
+	
+	/**
+	 * Give up a reserved Connection slot, e.g. after opening a
+	 * Connection failed.
+	 **/
+	void drop_slot();
+	
+	/**
+	 * Wrap a pooled Connection into a lease.
+	 * 
+	 * \param	conn	The pooled Connection.
+	 * \return	a smart pointer that returns <code>conn</code> to the
+	 * 		pool on deletion.
+	 **/
+	shared_ptr<Connection> lease(shared_ptr<Connection> conn);
+	
+	/** The Context further Connections are cloned from. */
+	shared_ptr<Context> _prototype;
+	/** Maximum number of Connections. */
+	const size_t _size;
+	/** Number of open (or opening) Connections. */
+	size_t _open;
+	/** Idle Connections; the most recently returned one at the back. */
+	std::deque<IdleEntry> _idle;
+	/** Idle time that triggers a check before leasing. */
+	time_duration _check_interval;
+	/** Usage counters (the occupancy fields are computed on demand). */
+	Statistics _statistics;
+	/** Protects all members above except _prototype and _size. */
+	mutable boost::mutex _mutex;
+	/** Signalled when a Connection was returned or a slot freed. */
+	boost::condition_variable _available;
+	/** Prefixes that partitioned listings split further. */
+	shared_ptr<PartitionedNameStream::HotPrefixes> _hot_prefixes;
+};
+
+} /* namespace kadm5 */
+
+#endif /*CONNECTIONPOOL_HPP_*/
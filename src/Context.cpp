@@ -32,11 +32,15 @@
 
 
 // STL and Boost
+#include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 // Kerberos
 #include <krb5.h>
@@ -45,151 +49,531 @@
 // Local
 #include "Context.hpp"
 #include "Error.hpp"
+#include "RecordCache.hpp"
 
 namespace kadm5
 {
 	
 using boost::shared_ptr;
 using std::string;
+using std::vector;
+
+/** Default port of kadmind. */
+static const int DEFAULT_KADMIND_PORT = 749;
+
+/** Upper bound for the delay between two retries in Context::execute(). */
+static const boost::posix_time::seconds MAX_RETRY_BACKOFF(30);
+
+/** Template attributes: all except the principal, key and tagged data. */
+static const u_int32_t TEMPLATE_FIELDS =
+	( KADM5_PRINC_EXPIRE_TIME | KADM5_PW_EXPIRATION
+	| KADM5_LAST_PWD_CHANGE | KADM5_ATTRIBUTES | KADM5_MAX_LIFE
+	| KADM5_MOD_TIME | KADM5_MOD_NAME | KADM5_KVNO | KADM5_MKVNO
+	| KADM5_AUX_ATTRIBUTES | KADM5_POLICY | KADM5_MAX_RLIFE
+	| KADM5_LAST_SUCCESS | KADM5_LAST_FAILED
+	| KADM5_FAIL_AUTH_COUNT );
+
+/**
+ * Custom deletion function for the heap-allocated template records held by
+ * Context::_templates.
+ **/
+static void free_template(void* ph, kadm5_principal_ent_t pp)
+{
+	kadm5_free_principal_ent(ph, pp);
+	delete pp;
+}
+
+
+/**
+ * Check whether a KAdmin library error means that the connection to the
+ * server is unusable, so reconnecting may help.
+ * 
+ * \param	ret	The error code.
+ * \return	true if the error is a connection failure.
+ **/
+static bool is_connection_failure(const kadm5_ret_t ret)
+{
+	switch (ret) {
+	case KADM5_RPC_ERROR:
+	case KADM5_BAD_SERVER_HANDLE:
+	case KADM5_NO_SRV:
+	case ECONNREFUSED:
+	case ECONNRESET:
+	case EPIPE:
+	case ETIMEDOUT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+/**
+ * Comparison for sorting admin servers by the time the last connect
+ * took, for Context::endpoints_by_latency.
+ **/
+struct LatencyOrder
+{
+	LatencyOrder(const std::map<string, time_duration>& latencies)
+		: _latencies(latencies) {}
+	
+	bool operator()(const string& a, const string& b) const
+	{
+		return latency(a) < latency(b);
+	}
+	
+	time_duration latency(const string& server) const
+	{
+		std::map<string, time_duration>::const_iterator it =
+			_latencies.find(server);
+		// Try servers not connected to yet before known ones.
+		return it != _latencies.end() ? it->second : time_duration(0, 0, 0);
+	}
+	
+	const std::map<string, time_duration>& _latencies;
+};
 
 
 Context::Context(
 		const string& client,
 		const string& realm,
 		const string& host,
-		const int port
+		const int port,
+		shared_ptr<Krb5Context> krb5
 	) :
-		_kadm_handle(),
-		_krb_context(),
+		_krb5( krb5 ? krb5 : Krb5Context::shared() ),
+		_krb_context( _krb5, *_krb5 ),
 		_config_params( create_config_params(realm, host, port) ),
-		_client(client)
+		_client(client),
+		_resolved_client(),
+		_realm(),
+		_host(),
+		_port(0),
+		_kadm_handle(),
+		_handle_mutex(),
+		_initial_privileges(0),
+		_privileges_known(false),
+		_template_ttl(boost::posix_time::minutes(5)),
+		_templates(),
+		_record_cache(),
+		_admin_servers(),
+		_explicit_admin_servers(!host.empty()),
+		_endpoint_order(endpoints_in_order),
+		_latencies(),
+		_retry_attempts(3),
+		_retry_backoff(boost::posix_time::millisec(250)),
+		_reconnects(0),
+		_reconnect_time()
 {
 	KADM5_DEBUG("Context(): Constructing...\n");
-	krb5_context_data* pc = NULL;
-	error::throw_on_error( krb5_init_context(&pc) );
-	_krb_context.reset(pc, krb5_free_context);
-	
-	if (!realm.empty()) {
-		error::throw_on_error(
-			krb5_set_default_realm(
-				_krb_context.get(),
-				realm.c_str()
-			)
-		);
+	if (_explicit_admin_servers) {
+		_admin_servers.push_back(host);
 	}
+	// The realm is not made the Kerberos context's default since that
+	// may be shared; see qualified_name().
+	resolve_config();
 }
 
 
-const string Context::client() const
+void Context::reload_config()
 {
-	if (_client.empty()) {
-		krb5_principal_data* pdefp = NULL;
-		
-		try {
-			error::throw_on_error(
-				krb5_get_default_principal(
-					_krb_context.get(),
-					&pdefp
-				)
-			);
-			
-			char* ptmps = NULL;
-			error::throw_on_error(
-				krb5_unparse_name(
-					_krb_context.get(),
-					pdefp,
-					&ptmps
-				)
-			);
-			string name( ptmps );
-
-			free(ptmps);
-			krb5_free_principal(_krb_context.get(), pdefp);
-			
-			// FIXME Is this always correct?
-			if (name.find("/") == string::npos) {
-				if (name.find("@") == string::npos) {
-					name += "/admin";
-				}
-				else {
-					name.insert(name.find("@"), "/admin");
-				}
-			}
-			
-			return name;
+	KADM5_DEBUG("Context::reload_config()\n");
+	_krb5->reload_config();
+	resolve_config();
+}
+
+
+const string Context::qualified_name(const string& name) const
+{
+	// Look for an unescaped realm separator.
+	for (string::size_type i = 0; i < name.length(); i++) {
+		if (name[i] == '\\') {
+			i++;
 		}
-		catch(...) {
-			krb5_free_principal(_krb_context.get(), pdefp);
-			throw;
+		else if (name[i] == '@') {
+			return name;
 		}
 	}
-	else {
-		return _client.find("@") == string::npos ?
-			_client + "@" + realm():
-			_client;
-	}
+	return name + "@" + _realm;
 }
 
 
-const string Context::realm() const
+void Context::resolve_config()
 {
+	krb5_context pc = _krb_context.get();
+	
 	if (_config_params->mask & KADM5_CONFIG_REALM) {
-		return _config_params->realm;
+		_realm = _config_params->realm;
 	}
 	else {
 		char* ptmp = NULL;
-		error::throw_on_error(
-			krb5_get_default_realm(_krb_context.get(), &ptmp)
-		);
+		error::throw_on_error( krb5_get_default_realm(pc, &ptmp) );
 		shared_ptr<char> pr( ptmp, free );
 		
-		return pr.get();
+		_realm = pr.get();
 	}
-}
-
-
-const string Context::host() const
-{
-	if (_config_params->mask & KADM5_CONFIG_ADMIN_SERVER) {
-		return _config_params->admin_server;
+	
+	if (_client.empty()) {
+		_resolved_client = default_admin_client(pc);
 	}
 	else {
-		const char* ps = krb5_config_get_string_default(
-					_krb_context.get(),
-					NULL,
+		_resolved_client = _client.find("@") == string::npos ?
+			_client + "@" + _realm :
+			_client;
+	}
+	
+	if (!_explicit_admin_servers) {
+		_admin_servers.clear();
+		char** pservers = krb5_config_get_strings(
+					pc,
 					NULL,
 					"realms",
-					realm().c_str(),
+					_realm.c_str(),
 					"admin_server",
 					NULL
 				);
-		
-		// "admin_server" config key must exist since construction
-		// would have thrown an exception otherwise (no admin server
-		// known).
-		assert(ps != NULL);
-		string s(ps);
-		
-		return s.substr(0, s.rfind(":"));
+		// Unknown realms have no admin server; connecting will fail.
+		for (char** ps = pservers; ps && *ps; ps++) {
+			_admin_servers.push_back(*ps);
+		}
+		krb5_config_free_strings(pservers);
+	}
+	
+	if (_config_params->mask & KADM5_CONFIG_ADMIN_SERVER) {
+		set_host_port(_config_params->admin_server);
+	}
+	else {
+		set_host_port(_admin_servers.empty() ? "" : _admin_servers.front());
 	}
 }
 
 
-const int Context::port() const {
-	if (	(_config_params->mask & KADM5_CONFIG_ADMIN_SERVER) &&
-		(host().rfind(":") != string::npos)
-	) {
-		string h = host();
-		
-		// This will deliver a correct port since the construction
-		// would have failed otherwise.
-		return atoi( h.substr(h.rfind(":")).c_str() );
+void Context::set_host_port(const string& server)
+{
+	// The admin server may be given as "host:port"; such a port takes
+	// precedence over the kadmind_port parameter.
+	string::size_type colon = server.rfind(":");
+	_host = server.substr(0, colon);
+	if (colon != string::npos) {
+		_port = atoi( server.substr(colon + 1).c_str() );
 	}
 	else if (_config_params->mask & KADM5_CONFIG_KADMIND_PORT) {
-		return _config_params->kadmind_port;
+		_port = _config_params->kadmind_port;
 	}
 	else {
-		return 749;
+		_port = DEFAULT_KADMIND_PORT;
+	}
+}
+
+
+void Context::use_admin_server(const string& server)
+{
+	char* pserver = new char[server.length() + 1];
+	server.copy(pserver, string::npos);
+	pserver[server.length()] = 0;
+	
+	delete[] _config_params->admin_server;
+	_config_params->admin_server = pserver;
+	_config_params->mask |= KADM5_CONFIG_ADMIN_SERVER;
+	set_host_port(server);
+}
+
+
+void* Context::kadm_handle() const
+{
+	boost::mutex::scoped_lock lock(_handle_mutex);
+	if (!_kadm_handle) {
+		KADM5_DEBUG("Context: Connecting on first use\n");
+		const_cast<Context*>(this)->connect_any();
+	}
+	return _kadm_handle.get();
+}
+
+
+const bool Context::connected() const
+{
+	boost::mutex::scoped_lock lock(_handle_mutex);
+	return _kadm_handle.get() != NULL;
+}
+
+
+void* Context::current_handle() const
+{
+	boost::mutex::scoped_lock lock(_handle_mutex);
+	return _kadm_handle.get();
+}
+
+
+void Context::open_handle()
+{
+	// Plain Contexts know no credentials to connect with.
+	throw not_initialized(KADM5_NOT_INIT);
+}
+
+
+void Context::establish_handle()
+{
+	boost::mutex::scoped_lock lock(_handle_mutex);
+	connect_any();
+}
+
+
+void Context::connect_any()
+{
+	if (_admin_servers.size() < 2) {
+		open_handle();
+		return;
+	}
+	
+	vector<string> servers(_admin_servers);
+	if (_endpoint_order == endpoints_by_latency) {
+		std::stable_sort(
+			servers.begin(), servers.end(), LatencyOrder(_latencies)
+		);
+	}
+	
+	for (vector<string>::size_type i = 0; i < servers.size(); i++) {
+		KADM5_DEBUG("Context: Connecting to " + servers[i] + "\n");
+		ptime start = boost::posix_time::microsec_clock::universal_time();
+		try {
+			use_admin_server(servers[i]);
+			open_handle();
+			_latencies[servers[i]] =
+				boost::posix_time::microsec_clock::universal_time()
+				- start;
+			return;
+		}
+		catch (const error&) {
+			_latencies[servers[i]] = boost::posix_time::pos_infin;
+			if (i + 1 == servers.size()) {
+				throw;
+			}
+		}
+	}
+}
+
+
+void Context::inherit_failover(const Context& original)
+{
+	boost::mutex::scoped_lock lock(original._handle_mutex);
+	_admin_servers = original._admin_servers;
+	_explicit_admin_servers = original._explicit_admin_servers;
+	_endpoint_order = original._endpoint_order;
+	_latencies = original._latencies;
+	_retry_attempts = original._retry_attempts;
+	_retry_backoff = original._retry_backoff;
+}
+
+
+void Context::set_admin_servers(const vector<string>& servers)
+{
+	_admin_servers = servers;
+	_explicit_admin_servers = true;
+	_latencies.clear();
+}
+
+
+void Context::set_retry_policy(
+	const unsigned int retries,
+	const time_duration& backoff
+) {
+	_retry_attempts = retries;
+	_retry_backoff = backoff;
+}
+
+
+kadm5_ret_t Context::execute(
+	const boost::function<kadm5_ret_t (void*)>& op,
+	const bool idempotent
+) const {
+	kadm5_ret_t ret = op(*this);
+	time_duration backoff = _retry_backoff;
+	
+	for (unsigned int retry = 0; is_connection_failure(ret); retry++) {
+		if (retry > 0) {
+			if (retry >= _retry_attempts) {
+				break;
+			}
+			boost::this_thread::sleep(backoff);
+			backoff = std::min(
+				backoff * 2, time_duration(MAX_RETRY_BACKOFF)
+			);
+		}
+		try {
+			reconnect();
+		}
+		catch (const error&) {
+			// All servers down; back off and try again.
+			continue;
+		}
+		if (!idempotent || retry >= _retry_attempts) {
+			break;
+		}
+		ret = op(*this);
+	}
+	return ret;
+}
+
+
+void Context::reconnect() const
+{
+	boost::mutex::scoped_lock lock(_handle_mutex);
+	KADM5_DEBUG("Context::reconnect()\n");
+	
+	ptime start = boost::posix_time::microsec_clock::universal_time();
+	// The deleters of the cached templates and records refer to the
+	// old handle.
+	_templates.clear();
+	if (_record_cache) {
+		_record_cache->clear();
+	}
+	const_cast<Context*>(this)->_kadm_handle.reset();
+	try {
+		const_cast<Context*>(this)->connect_any();
+	}
+	catch (...) {
+		_reconnect_time +=
+			boost::posix_time::microsec_clock::universal_time() - start;
+		throw;
+	}
+	_reconnect_time +=
+		boost::posix_time::microsec_clock::universal_time() - start;
+	_reconnects++;
+}
+
+
+shared_ptr<Context> Context::clone() const
+{
+	// Plain Contexts know no credentials to connect with.
+	throw error(KADM5_FAILURE);
+}
+
+
+const bool Context::initial_privileges(u_int32_t& p) const
+{
+	if (_privileges_known) {
+		p = _initial_privileges;
+	}
+	return _privileges_known;
+}
+
+
+void Context::set_initial_privileges(u_int32_t p)
+{
+	_initial_privileges = p;
+	_privileges_known = true;
+}
+
+
+shared_ptr<const kadm5_principal_ent_rec> Context::default_template(
+	const string& realm
+) const
+{
+	ptime now = boost::posix_time::microsec_clock::universal_time();
+	
+	TemplateMap::const_iterator it = _templates.find(realm);
+	if ((it != _templates.end()) && (now - it->second.first < _template_ttl)) {
+		return it->second.second;
+	}
+	
+	KADM5_DEBUG("Context::default_template(): Fetching from server.\n");
+	krb5_principal ptmp = NULL;
+	error::throw_on_error(
+		krb5_make_principal(
+			_krb_context.get(),
+			&ptmp,
+			realm.c_str(),
+			"default",
+			NULL
+		)
+	);
+	shared_ptr<krb5_principal_data> pdefault(
+		ptmp, boost::bind(krb5_free_principal, _krb_context.get(), _1)
+	);
+	
+	// The record is freed through the handle it was fetched with,
+	// which is only known after execute() (it may reconnect).
+	kadm5_principal_ent_t pent = new kadm5_principal_ent_rec;
+	memset(pent, 0, sizeof(kadm5_principal_ent_rec));
+	kadm5_ret_t ret = KADM5_FAILURE;
+	try {
+		ret = execute(
+			boost::bind(
+				kadm5_get_principal,
+				_1,
+				pdefault.get(),
+				pent,
+				TEMPLATE_FIELDS
+			),
+			true
+		);
+	}
+	catch (...) {
+		delete pent;
+		throw;
+	}
+	if (ret) {
+		delete pent;
+		error::throw_on_error(ret);
+	}
+	
+	void* ph = *this;
+	shared_ptr<kadm5_principal_ent_rec> ptemplate(
+		pent, boost::bind(free_template, ph, _1)
+	);
+	_templates[realm] = std::make_pair(now, ptemplate);
+	return ptemplate;
+}
+
+
+void Context::invalidate_templates() const
+{
+	_templates.clear();
+}
+
+
+void Context::enable_record_cache(
+	const size_t capacity,
+	const time_duration& ttl
+) {
+	_record_cache.reset(
+		new RecordCache(*this, capacity, ttl)
+	);
+}
+
+
+string default_admin_client(krb5_context pc)
+{
+	krb5_principal_data* pdefp = NULL;
+	
+	try {
+		error::throw_on_error( krb5_get_default_principal(pc, &pdefp) );
+		
+		char* ptmps = NULL;
+		error::throw_on_error( krb5_unparse_name(pc, pdefp, &ptmps) );
+		string name( ptmps );
+
+		free(ptmps);
+		krb5_free_principal(pc, pdefp);
+		pdefp = NULL;
+		
+		// FIXME Is this always correct?
+		if (name.find("/") == string::npos) {
+			if (name.find("@") == string::npos) {
+				name += "/admin";
+			}
+			else {
+				name.insert(name.find("@"), "/admin");
+			}
+		}
+		
+		return name;
+	}
+	catch(...) {
+		if (pdefp) {
+			krb5_free_principal(pc, pdefp);
+		}
+		throw;
 	}
 }
 
@@ -215,7 +599,7 @@ shared_ptr<kadm5_config_params> create_config_params(
 		realm.copy(pret->realm, string::npos);
 		pret->realm[realm.length()] = 0;
 		
-		pret->mask | KADM5_CONFIG_REALM;
+		pret->mask |= KADM5_CONFIG_REALM;
 	}		
 
 	if (!host.empty()) {
@@ -223,7 +607,7 @@ shared_ptr<kadm5_config_params> create_config_params(
 		host.copy(pret->admin_server, string::npos);
 		pret->admin_server[host.length()] = 0;
 		
-		pret->mask | KADM5_CONFIG_ADMIN_SERVER;
+		pret->mask |= KADM5_CONFIG_ADMIN_SERVER;
 	}		
 	
 	if (port > 0) {
@@ -241,6 +625,7 @@ void delete_config_params(kadm5_config_params* pp)
 	// Unconditional delete works since uninitialized pointers are NULL.
 	delete[] pp->realm;
 	delete[] pp->admin_server;
+	delete[] pp->dbname;
 	delete pp;
 }
 
@@ -289,7 +674,108 @@ void delete_kadm5_principal_ent(
 	kadm5_principal_ent_t pe
 ) {
 	KADM5_DEBUG("delete_kadm5_principal_ent()\n");
-	kadm5_free_principal_ent(*pc, pe);
+	// Deleters must not connect; see Context::current_handle().
+	void* ph = pc->current_handle();
+	if (ph) {
+		kadm5_free_principal_ent(ph, pe);
+	}
+}
+
+
+void copy_kadm5_principal_ent_fields(
+	krb5_context pc,
+	kadm5_principal_ent_t pdst,
+	const kadm5_principal_ent_rec* psrc,
+	const u_int32_t mask
+) {
+	if(mask & KADM5_PRINC_EXPIRE_TIME)
+		pdst->princ_expire_time = psrc->princ_expire_time;
+	if(mask & KADM5_PW_EXPIRATION)
+		pdst->pw_expiration = psrc->pw_expiration;
+	if(mask & KADM5_LAST_PWD_CHANGE)
+		pdst->last_pwd_change = psrc->last_pwd_change;
+	if(mask & KADM5_ATTRIBUTES)
+		pdst->attributes = psrc->attributes;
+	if(mask & KADM5_MAX_LIFE)
+		pdst->max_life = psrc->max_life;
+	if(mask & KADM5_MOD_TIME)
+		pdst->mod_date = psrc->mod_date;
+	if(mask & KADM5_KVNO)
+		pdst->kvno = psrc->kvno;
+	if(mask & KADM5_MKVNO)
+		pdst->mkvno = psrc->mkvno;
+	if(mask & KADM5_AUX_ATTRIBUTES)
+		pdst->aux_attributes = psrc->aux_attributes;
+	if(mask & KADM5_MAX_RLIFE)
+		pdst->max_renewable_life = psrc->max_renewable_life;
+	if(mask & KADM5_LAST_SUCCESS)
+		pdst->last_success = psrc->last_success;
+	if(mask & KADM5_LAST_FAILED)
+		pdst->last_failed = psrc->last_failed;
+	if(mask & KADM5_FAIL_AUTH_COUNT)
+		pdst->fail_auth_count = psrc->fail_auth_count;
+	
+	// The libraries free these members with free() and
+	// krb5_free_principal(), so allocate them accordingly.
+	if((mask & KADM5_MOD_NAME) && psrc->mod_name) {
+		error::throw_on_error(
+			krb5_copy_principal(pc, psrc->mod_name, &pdst->mod_name)
+		);
+	}
+	if((mask & KADM5_POLICY) && psrc->policy) {
+		pdst->policy = strdup(psrc->policy);
+		if (!pdst->policy) {
+			error::throw_on_error(ENOMEM);
+		}
+	}
+}
+
+
+void swap_kadm5_principal_ent_fields(
+	kadm5_principal_ent_t pa,
+	kadm5_principal_ent_t pb,
+	const u_int32_t mask
+) {
+	using std::swap;
+	
+	if(mask & KADM5_PRINC_EXPIRE_TIME)
+		swap(pa->princ_expire_time, pb->princ_expire_time);
+	if(mask & KADM5_PW_EXPIRATION)
+		swap(pa->pw_expiration, pb->pw_expiration);
+	if(mask & KADM5_LAST_PWD_CHANGE)
+		swap(pa->last_pwd_change, pb->last_pwd_change);
+	if(mask & KADM5_ATTRIBUTES)
+		swap(pa->attributes, pb->attributes);
+	if(mask & KADM5_MAX_LIFE)
+		swap(pa->max_life, pb->max_life);
+	if(mask & KADM5_MOD_TIME)
+		swap(pa->mod_date, pb->mod_date);
+	if(mask & KADM5_MOD_NAME)
+		swap(pa->mod_name, pb->mod_name);
+	if(mask & KADM5_KVNO)
+		swap(pa->kvno, pb->kvno);
+	if(mask & KADM5_MKVNO)
+		swap(pa->mkvno, pb->mkvno);
+	if(mask & KADM5_AUX_ATTRIBUTES)
+		swap(pa->aux_attributes, pb->aux_attributes);
+	if(mask & KADM5_POLICY)
+		swap(pa->policy, pb->policy);
+	if(mask & KADM5_MAX_RLIFE)
+		swap(pa->max_renewable_life, pb->max_renewable_life);
+	if(mask & KADM5_LAST_SUCCESS)
+		swap(pa->last_success, pb->last_success);
+	if(mask & KADM5_LAST_FAILED)
+		swap(pa->last_failed, pb->last_failed);
+	if(mask & KADM5_FAIL_AUTH_COUNT)
+		swap(pa->fail_auth_count, pb->fail_auth_count);
+	if(mask & KADM5_KEY_DATA) {
+		swap(pa->n_key_data, pb->n_key_data);
+		swap(pa->key_data, pb->key_data);
+	}
+	if(mask & KADM5_TL_DATA) {
+		swap(pa->n_tl_data, pb->n_tl_data);
+		swap(pa->tl_data, pb->tl_data);
+	}
 }
 
 
@@ -301,7 +787,9 @@ shared_ptr<krb5_principal_data> parse_name(
 ) {
 	krb5_principal_data* ptmp = NULL;
 
-	error::throw_on_error( krb5_parse_name(*pc, name.c_str(), &ptmp) );
+	error::throw_on_error(
+		krb5_parse_name(*pc, pc->qualified_name(name).c_str(), &ptmp)
+	);
 	shared_ptr<krb5_principal_data> pret(
 		ptmp, boost::bind(delete_krb5_principal, pc, _1)
 	);
@@ -35,19 +35,33 @@
 #define CONTEXT_HPP_
 
 // STL and Boost
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 // Kerberos
 #include <krb5.h>
 #include <kadm5/admin.h>
 
+// Local
+#include "Krb5Context.hpp"
+
 namespace kadm5
 {
 
+class RecordCache;
+
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
 using boost::shared_ptr;
 using std::string;
+using std::vector;
 
 /**
  * \brief
@@ -76,7 +90,9 @@ using std::string;
  * This class is <code>noncopyable</code> as it holds resource pointers.
  * 
  * Classes derived from this class must set the Context::_kadm_handle in their
- * constructors via Context::set_kadm_handle().
+ * constructors via Context::set_kadm_handle(). Alternatively, they may leave
+ * it empty and connect in open_handle(), which is called when the handle is
+ * first used (<em>lazy</em> connection).
  * 
  * \author Peter Dinges <pdinges@acm.org>
  **/
@@ -85,7 +101,7 @@ class Context : public boost::noncopyable
 public:
 	// Implicit type conversion for library functions
 	operator krb5_context_data*() const { return _krb_context.get(); }
-	operator void*() const { return _kadm_handle.get(); }
+	operator void*() const { return kadm_handle(); }
 	
 	/**
 	 * Get the name of the Kerberos principal this context uses for
@@ -93,28 +109,295 @@ public:
 	 * 
 	 * \return The Kerberos principal used to connect to the KAdmin server.
 	 **/
-	const string client() const;
+	const string& client() const { return _resolved_client; }
 	
 	/**
 	 * Get the realm name this context uses.
 	 * 
 	 * \return The Kerberos realm of this context.
 	 **/
-	const string realm() const;
+	const string& realm() const { return _realm; }
 	
 	/**
 	 * Get the used KAdmin server's hostname.
 	 * 
-	 * \return The hostname of this context's KAdmin server.
+	 * \return The hostname of this context's KAdmin server; empty if
+	 * 		none is configured for the realm.
 	 **/
-	const string host() const;
+	const string& host() const { return _host; }
 	
 	/**
 	 * Get the used KAdmin server's port number.
 	 * 
 	 * \return The port number of this context's KAdmin server.
 	 **/
-	const int port() const;
+	const int port() const { return _port; }
+	
+	/**
+	 * Re-read the Kerberos configuration files and determine client(),
+	 * realm(), host() and port() again. These values are otherwise
+	 * fixed when the Context is constructed.
+	 * 
+	 * \note
+	 * The open KAdmin connection is not affected. The configuration
+	 * is re-read for all Contexts sharing this one's Kerberos context
+	 * (see Krb5Context::reload_config()).
+	 **/
+	void reload_config();
+	
+	/**
+	 * Get the Kerberos context this Context uses, e.g., to create more
+	 * Contexts sharing it.
+	 * 
+	 * \return	a smart pointer to the Krb5Context.
+	 **/
+	shared_ptr<Krb5Context> krb5() const { return _krb5; }
+	
+	/**
+	 * Complete a principal name with this Context's realm if it names
+	 * none. Use it instead of relying on the Kerberos context's default
+	 * realm, which may be shared with Contexts of other realms.
+	 * 
+	 * \param	name	The principal name.
+	 * \return	the name including a realm.
+	 **/
+	const string qualified_name(const string& name) const;
+	
+	/**
+	 * Get the privileges the KAdmin server granted this Context when the
+	 * connection was checked during construction.
+	 * 
+	 * \param	p	Receives the privilege bit-flags (see
+	 * 			<code>kadm5/admin.h</code>). Left untouched if
+	 * 			no privileges were fetched.
+	 * \return	true if the privileges were fetched while connecting;
+	 * 		otherwise false.
+	 **/
+	const bool initial_privileges(u_int32_t& p) const;
+	
+	/**
+	 * Check whether the KAdmin connection is open. Lazily constructed
+	 * Contexts connect on the first use of their KAdmin handle.
+	 * 
+	 * \return	true if the KAdmin handle exists; otherwise false.
+	 **/
+	const bool connected() const;
+	
+	/**
+	 * Get the KAdmin handle without connecting. Use it to free memory
+	 * the libraries allocated, e.g., in deleters and destructors, which
+	 * must neither connect nor throw.
+	 * 
+	 * \return	the KAdmin handle; NULL if not connected.
+	 **/
+	void* current_handle() const;
+	
+	/**
+	 * Open another, independent connection to the same KAdmin server
+	 * with the same credentials. Use clones to work on several handles
+	 * concurrently (a single Context must not be used from several
+	 * threads at once).
+	 * 
+	 * \note
+	 * The default implementation throws an exception since there are
+	 * no credentials to reuse.
+	 * 
+	 * \return	a smart pointer to the new Context.
+	 **/
+	virtual shared_ptr<Context> clone() const;
+	
+	///@{\name Default Principal Templates
+	/**
+	 * Get the <code>default</code> principal of the given realm, whose
+	 * attributes serve as template values for principals that do not
+	 * exist yet. The record is fetched from the KAdmin server once and
+	 * then kept until it expires (see template_ttl()) or
+	 * invalidate_templates() is called.
+	 * 
+	 * \note
+	 * The record contains all attributes except the key data and tagged
+	 * data. It stays valid as long as the returned pointer is held,
+	 * even if the cache entry is dropped in the meantime.
+	 * 
+	 * \param	realm	The realm whose template to get.
+	 * \return	a smart pointer to the cached template record.
+	 **/
+	shared_ptr<const kadm5_principal_ent_rec> default_template(
+		const string& realm
+	) const;
+	
+	/**
+	 * Drop all cached templates, e.g. after the <code>default</code>
+	 * principal was changed.
+	 **/
+	void invalidate_templates() const;
+	
+	/**
+	 * Get the time after which a cached template is fetched again.
+	 * Defaults to five minutes.
+	 * 
+	 * \return	the lifetime of cached templates.
+	 **/
+	const time_duration template_ttl() const { return _template_ttl; }
+	
+	/**
+	 * Set the time after which a cached template is fetched again.
+	 * Use <code>boost::posix_time::pos_infin</code> to keep templates
+	 * until invalidate_templates() is called.
+	 * 
+	 * \param	d	The lifetime of cached templates.
+	 **/
+	void set_template_ttl(const time_duration& d) { _template_ttl = d; }
+	///@}
+	
+	///@{\name Principal Record Cache
+	/**
+	 * Start caching the principal records fetched through this Context,
+	 * replacing any previous cache. Cached records are used instead of
+	 * asking the server again until they expire or the Principal is
+	 * changed through this Context.
+	 * 
+	 * \note
+	 * Changes made through other Contexts (or other programs) remain
+	 * unnoticed until the records expire.
+	 * 
+	 * \param	capacity	The maximum number of cached records.
+	 * \param	ttl	The time after which a record expires.
+	 **/
+	void enable_record_cache(
+		const size_t capacity,
+		const time_duration& ttl
+	);
+	
+	/**
+	 * Stop caching principal records and drop the cached ones.
+	 **/
+	void disable_record_cache() { _record_cache.reset(); }
+	
+	/**
+	 * Get the principal record cache.
+	 * 
+	 * \return	a smart pointer to the cache; empty if caching is
+	 * 		disabled (the default).
+	 **/
+	shared_ptr<RecordCache> record_cache() const { return _record_cache; }
+	///@}
+	
+	///@{\name Reconnect and Failover
+	
+	/**
+	 * Order in which reconnect() tries the admin servers.
+	 **/
+	enum EndpointOrder
+	{
+		/** Try the servers in the order of admin_servers(). */
+		endpoints_in_order,
+		/**
+		 * Try the server that was fastest to connect to first.
+		 * Servers not connected to yet come first (in order), and
+		 * servers that failed last.
+		 **/
+		endpoints_by_latency
+	};
+	
+	/**
+	 * Get the KAdmin servers this Context may connect to, of form
+	 * <code>host</code> or <code>host:port</code>. Unless set
+	 * explicitly, these are the host given on construction or all
+	 * <code>admin_server</code> entries of the realm in the Kerberos
+	 * configuration.
+	 * 
+	 * \return	the list of admin servers.
+	 **/
+	const vector<string>& admin_servers() const { return _admin_servers; }
+	
+	/**
+	 * Set the KAdmin servers to use on the next (re)connect.
+	 * 
+	 * \param	servers	The servers, of form <code>host</code> or
+	 * 			<code>host:port</code>.
+	 **/
+	void set_admin_servers(const vector<string>& servers);
+	
+	/**
+	 * Set the order in which the admin servers are tried. The default
+	 * is endpoints_in_order.
+	 * 
+	 * \param	order	The new order.
+	 **/
+	void set_endpoint_order(const EndpointOrder order) { _endpoint_order = order; }
+	
+	/**
+	 * Set how execute() retries operations that failed because the
+	 * connection broke. The first retry follows the reconnect
+	 * immediately; the delay before each further one doubles, up to
+	 * 30 seconds. The default is 3 retries starting with 250ms.
+	 * 
+	 * \param	retries	The maximum number of retries per operation.
+	 * \param	backoff	The delay before the second retry.
+	 **/
+	void set_retry_policy(
+		const unsigned int retries,
+		const time_duration& backoff
+	);
+	
+	/**
+	 * Run a KAdmin library call on this Context's handle. If the call
+	 * fails because the connection to the server broke (e.g., kadmind
+	 * was restarted), the handle is re-established (see reconnect()).
+	 * Calls marked as idempotent are then retried according to the
+	 * retry policy; others return the error, but the next call uses
+	 * the new handle.
+	 * 
+	 * Usage example:
+	 * \code
+	 * kadm5_ret_t ret = context.execute(
+	 * 	boost::bind(kadm5_get_privs, _1, &privileges),
+	 * 	true
+	 * );
+	 * \endcode
+	 * 
+	 * \param	op	The library call, receiving the KAdmin handle.
+	 * \param	idempotent	true if repeating the call is safe,
+	 * 			i.e., it does not change anything or sets the
+	 * 			same values again.
+	 * \return	the library call's last return value.
+	 **/
+	kadm5_ret_t execute(
+		const boost::function<kadm5_ret_t (void*)>& op,
+		const bool idempotent
+	) const;
+	
+	/**
+	 * Drop the KAdmin handle and open a new one, trying the admin
+	 * servers in the configured order (see set_endpoint_order()).
+	 * 
+	 * \note
+	 * Cached <code>default</code> principals are dropped since they
+	 * belong to the old handle.
+	 **/
+	void reconnect() const;
+	
+	/**
+	 * Get the number of successful reconnects.
+	 * 
+	 * \return	the number of handles re-established.
+	 **/
+	const unsigned long reconnects() const { return _reconnects; }
+	
+	/**
+	 * Get the total time spent in reconnect(), including failed
+	 * attempts.
+	 * 
+	 * \return	the time spent reconnecting.
+	 **/
+	const time_duration reconnect_time() const { return _reconnect_time; }
+	///@}
+	
+	/**
+	 * Destructor.
+	 **/
+	virtual ~Context() {}
 
 protected:
 	/**
@@ -138,12 +421,16 @@ protected:
 	 * \param	port	The KAdmin server's port number.
 	 * 			If <code>0</code>, uses the libraries' default
 	 * 			port number.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one (see Krb5Context::shared())
+	 * 			will be used.
 	 **/
 	explicit Context(
 		const string& client,
 		const string& realm,
 		const string& host,
-		const int port
+		const int port,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
 	);
 
 	/**
@@ -154,6 +441,44 @@ protected:
 	 **/
 	void set_kadm_handle(shared_ptr<void> ph) { _kadm_handle = ph; }
 	
+	/**
+	 * Open the KAdmin connection of a lazily constructed Context and
+	 * set it via set_kadm_handle(). Called on the first conversion to
+	 * the KAdmin handle (<code>void*</code>), while holding a lock that
+	 * makes concurrent first uses wait for a single connect.
+	 * 
+	 * \note
+	 * Implementations must not use the KAdmin handle themselves.
+	 * The default implementation throws not_initialized.
+	 **/
+	virtual void open_handle();
+	
+	/**
+	 * Open the KAdmin connection now, trying the admin servers in the
+	 * configured order. Constructors of derived classes that connect
+	 * eagerly call this instead of open_handle().
+	 **/
+	void establish_handle();
+	
+	/**
+	 * Take over the failover settings (admin servers, their order,
+	 * measured latencies and retry policy) of another Context, e.g.,
+	 * in clone(). Locks the other Context's handle_mutex() while
+	 * copying, so it may be reconnecting meanwhile.
+	 * 
+	 * \param	original	The Context whose settings to copy.
+	 **/
+	void inherit_failover(const Context& original);
+	
+	/**
+	 * Remember the privileges fetched while checking the connection, so
+	 * a Connection need not ask the server for them again.
+	 * 
+	 * \param	p	The privilege bit-flags returned by
+	 * 			<code>kadm5_get_privs</code>.
+	 **/
+	void set_initial_privileges(u_int32_t p);
+	
 	/**
 	 * Helper function to retrieve the <code>kadm5_config_params</code>
 	 * in constructors of derived classes.
@@ -161,20 +486,133 @@ protected:
 	 * \return	a smart pointer to the <code>kadm5_config_params</code>
 	 * 		for this Context.
 	 **/
-	shared_ptr<kadm5_config_params> config_params() { return _config_params; }
+	shared_ptr<kadm5_config_params> config_params() const { return _config_params; }
+	
+	/**
+	 * Get the lock held while connecting. Connecting may switch the
+	 * admin server in config_params() and change the state of derived
+	 * classes (e.g., their credentials), so clone() must hold the lock
+	 * while reading these: another thread may reconnect this Context.
+	 * 
+	 * \return	the mutex that serializes connecting.
+	 **/
+	boost::mutex& handle_mutex() const { return _handle_mutex; }
 
 private:
-	/** Kerberos context information. */
+	/**
+	 * Get the KAdmin handle, connecting first if necessary (see
+	 * open_handle()).
+	 * 
+	 * \return	the KAdmin connection handle.
+	 **/
+	void* kadm_handle() const;
+	
+	/**
+	 * Open the KAdmin connection via open_handle(), trying the admin
+	 * servers until one works. The caller must hold _handle_mutex.
+	 **/
+	void connect_any();
+	
+	/**
+	 * Make the given admin server the one open_handle() connects to,
+	 * and the one host() and port() return. Callers hold
+	 * handle_mutex(), so clone() sees either the old or the new server.
+	 * 
+	 * \param	server	The server, of form <code>host</code> or
+	 * 			<code>host:port</code>.
+	 **/
+	void use_admin_server(const string& server);
+	
+	/**
+	 * Set _host and _port from an admin server entry.
+	 * 
+	 * \param	server	The server, of form <code>host</code> or
+	 * 			<code>host:port</code>.
+	 **/
+	void set_host_port(const string& server);
+	
+	/**
+	 * Helper function for the constructor and reload_config(): derive
+	 * the values of client(), realm(), host() and port() from the
+	 * connection parameters and the Kerberos configuration.
+	 **/
+	void resolve_config();
+	
+	/** Cached template records by realm, with their fetch time. */
+	typedef std::map<
+			string,
+			std::pair< ptime, shared_ptr<kadm5_principal_ent_rec> >
+		> TemplateMap;
+	
+	/** The (possibly shared) Kerberos context. */
+	shared_ptr<Krb5Context> _krb5;
+	/** Kerberos context information; keeps _krb5 alive. */
 	shared_ptr<krb5_context_data> _krb_context;
 	/** KAdmin connection configuration parameters. */
 	shared_ptr<kadm5_config_params> _config_params;
 	/** Client name (as it isn't saved in Context::_config_params). */
 	string _client;
+	/** The full client name returned by client(). */
+	string _resolved_client;
+	/** The realm returned by realm(). */
+	string _realm;
+	/** The KAdmin server's hostname returned by host(). */
+	string _host;
+	/** The KAdmin server's port number returned by port(). */
+	int _port;
 	/** KAdmin connection handle. */
 	shared_ptr<void> _kadm_handle;
+	/** Serializes connecting; see handle_mutex(). */
+	mutable boost::mutex _handle_mutex;
+	/** Privileges fetched on connect (valid if _privileges_known). */
+	u_int32_t _initial_privileges;
+	/** Flag to check if _initial_privileges was set. */
+	bool _privileges_known;
+	/** Lifetime of the entries in _templates. */
+	time_duration _template_ttl;
+	/**
+	 * Cached <code>default</code> principals by realm, with the time
+	 * they were fetched. Declared after _kadm_handle so the records are
+	 * freed while the KAdmin handle still exists.
+	 **/
+	mutable TemplateMap _templates;
+	/**
+	 * Cache of fetched principal records (may be empty). Declared after
+	 * _kadm_handle for the same reason as _templates.
+	 **/
+	shared_ptr<RecordCache> _record_cache;
+	/** KAdmin servers to try, of form host or host:port. */
+	vector<string> _admin_servers;
+	/** Whether _admin_servers was given rather than configured. */
+	bool _explicit_admin_servers;
+	/** Order in which the admin servers are tried. */
+	EndpointOrder _endpoint_order;
+	/** Time of the last connect per admin server; pos_infin if failed. */
+	std::map<string, time_duration> _latencies;
+	/** Maximum number of retries of an idempotent operation. */
+	unsigned int _retry_attempts;
+	/** Delay before the second retry. */
+	time_duration _retry_backoff;
+	/** Number of successful reconnects. */
+	mutable unsigned long _reconnects;
+	/** Time spent reconnecting. */
+	mutable time_duration _reconnect_time;
 };
 
 
+/**
+ * Get the name of the administrative principal that belongs to the Kerberos
+ * libraries' default principal, e.g., <code>user/admin@REALM</code> for
+ * <code>user@REALM</code>. The KAdmin server expects clients to use such
+ * principals.
+ * 
+ * \param	pc	The Kerberos context to query for the default
+ * 			principal.
+ * \return	the name of the default administrative principal.
+ **/
+string default_admin_client(krb5_context pc);
+
+
 /* Helper functions for structure memory management with shared_ptr<T>. */
 
 /**
@@ -255,13 +693,54 @@ void delete_kadm5_principal_ent(
 	kadm5_principal_ent_t pp
 );
 
+/**
+ * Copies the members selected by a kadm5 field mask from one
+ * <code>kadm5_principal_ent_t</code> into another. Pointer members are
+ * copied deeply, so both records can be freed independently.
+ * 
+ * \note
+ * The selected pointer members of the destination must be empty, as
+ * they are overwritten without being freed. The principal name, key data
+ * and tagged data are never copied.
+ * 
+ * \param	pc	The Kerberos context used for copying principal
+ * 			names.
+ * \param	pdst	The record to copy into.
+ * \param	psrc	The record to copy from.
+ * \param	mask	<code>KADM5_*</code> bits of the members to copy.
+ **/
+void copy_kadm5_principal_ent_fields(
+	krb5_context pc,
+	kadm5_principal_ent_t pdst,
+	const kadm5_principal_ent_rec* psrc,
+	const u_int32_t mask
+);
+
+/**
+ * Exchanges the members selected by a kadm5 field mask between two
+ * <code>kadm5_principal_ent_t</code>s. Ownership of any pointer members is
+ * exchanged along with them, so both records stay valid for
+ * <code>kadm5_free_principal_ent</code>. The principal name is never
+ * exchanged, even if <code>KADM5_PRINCIPAL</code> is part of the mask.
+ * 
+ * \param	pa	The first record.
+ * \param	pb	The second record.
+ * \param	mask	<code>KADM5_*</code> bits of the members to exchange.
+ **/
+void swap_kadm5_principal_ent_fields(
+	kadm5_principal_ent_t pa,
+	kadm5_principal_ent_t pb,
+	const u_int32_t mask
+);
+
 
 /* Convenience wrappers for library functions */
 
 /**
  * Convenience wrapper for the <code>krb5_parse_name</code> Kerberos library
  * function. It returns an initialized smart pointer to a fresh
- * <code>krb5_principal</code> structure with the given name.
+ * <code>krb5_principal</code> structure with the given name. Names without
+ * a realm get the Context's realm (see Context::qualified_name()).
  * 
  * This function may throw exceptions; however, it guarantees that no memory
  * leaks will result from such a case.
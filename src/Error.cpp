@@ -188,6 +188,11 @@ void error::throw_on_error(int32_t c)
 		// KADM5_BAD_PRINCIPAL
 		case KRB5_PARSE_MALFORMED:
 			throw bad_principal(c);
+		// Wrong passwords when fetching initial credentials (treat
+		// them like KADM5_BAD_PASSWORD)
+		case KRB5KDC_ERR_PREAUTH_FAILED:
+		case KRB5KRB_AP_ERR_BAD_INTEGRITY:
+			throw bad_pw(c);
 		case ENOMEM:
 			// FIXME Have a preallocated instance to throw on
 			// memory shortage. How does this affect thread-
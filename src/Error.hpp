@@ -177,6 +177,8 @@ struct already_initialized: public connection_error
 	{ already_initialized(int32_t c) : connection_error(c) {} };
 struct bad_pw: public connection_error
 	{ bad_pw(int32_t c) : connection_error(c) {} };
+struct pool_exhausted: public connection_error
+	{ pool_exhausted(int32_t c) : connection_error(c) {} };
 
 /*
  * Authentication errors (missing privileges)
@@ -0,0 +1,569 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// System
+#include <fcntl.h>
+
+// Kerberos
+#include <krb5.h>
+#include <hdb.h>
+#include <kadm5/admin.h>
+
+// Local
+#include "Error.hpp"
+#include "HdbScanner.hpp"
+
+
+namespace kadm5
+{
+
+/** Number of entries handed to a conversion thread at once. */
+static const size_t BATCH_SIZE = 256;
+
+
+/**
+ * Convert a database timestamp into a ptime.
+ * 
+ * \param	t	The timestamp.
+ * \param	none	The value for timestamps that are not set.
+ * \return	the converted timestamp.
+ **/
+static ptime to_ptime(const krb5_timestamp t, const ptime& none)
+{
+	return t > 0 ? boost::posix_time::from_time_t(t) : none;
+}
+
+
+/**
+ * Convert a database lifetime into a time_duration.
+ * 
+ * \param	d	The lifetime in seconds.
+ * \return	the lifetime; <code>pos_infin</code> if unlimited.
+ **/
+static time_duration to_duration(const krb5_deltat d)
+{
+	if (d > 0) {
+		return boost::posix_time::seconds(d);
+	}
+	else {
+		return boost::posix_time::pos_infin;
+	}
+}
+
+
+/**
+ * Unparse a principal name.
+ * 
+ * \param	pc	The Kerberos context.
+ * \param	pp	The principal; may be <code>NULL</code>.
+ * \return	the name; empty for <code>NULL</code>.
+ **/
+static string unparse(krb5_context pc, krb5_const_principal pp)
+{
+	if (!pp) {
+		return "";
+	}
+	char* ptmp = NULL;
+	error::throw_on_error( krb5_unparse_name(pc, pp, &ptmp) );
+	string name(ptmp);
+	free(ptmp);
+	return name;
+}
+
+
+ScannedPrincipal::ScannedPrincipal()
+	:	_name(),
+		_modifier(),
+		_princ_expire_time(0),
+		_pw_expiration(0),
+		_mod_date(0),
+		_last_pwd_change(0),
+		_max_life(0),
+		_max_renewable_life(0),
+		_kvno(0)
+{}
+
+
+const ptime ScannedPrincipal::expire_time() const
+{
+	return to_ptime(_princ_expire_time, boost::posix_time::pos_infin);
+}
+
+
+const ptime ScannedPrincipal::password_expiration() const
+{
+	return to_ptime(_pw_expiration, boost::posix_time::pos_infin);
+}
+
+
+const time_duration ScannedPrincipal::max_lifetime() const
+{
+	return to_duration(_max_life);
+}
+
+
+const time_duration ScannedPrincipal::max_renewable_lifetime() const
+{
+	return to_duration(_max_renewable_life);
+}
+
+
+const ptime ScannedPrincipal::modify_time() const
+{
+	return to_ptime(_mod_date, boost::posix_time::neg_infin);
+}
+
+
+const ptime ScannedPrincipal::last_password_change() const
+{
+	return to_ptime(_last_pwd_change, boost::posix_time::neg_infin);
+}
+
+
+const ptime ScannedPrincipal::last_success() const
+{
+	return boost::posix_time::neg_infin;
+}
+
+
+const ptime ScannedPrincipal::last_failed() const
+{
+	return boost::posix_time::neg_infin;
+}
+
+
+HdbScanner::HdbScanner(
+	const string& dbname,
+	shared_ptr<Krb5Context> krb5
+)	:	_krb5( krb5 ? krb5 : Krb5Context::shared() ),
+		_db(NULL),
+		_dbname(dbname),
+		_position(0)
+{
+	KADM5_DEBUG("HdbScanner::HdbScanner(" + dbname + ")\n");
+	
+	krb5_context pc = *_krb5;
+	if (_dbname.empty()) {
+		_dbname = default_dbname(pc);
+	}
+	
+	error::throw_on_error(
+		hdb_create(pc, &_db, _dbname.empty() ? NULL : _dbname.c_str())
+	);
+	krb5_error_code ret = _db->hdb_open(pc, _db, O_RDONLY, 0);
+	if (ret) {
+		_db->hdb_destroy(pc, _db);
+		_db = NULL;
+		error::throw_on_error(ret);
+	}
+}
+
+
+HdbScanner::~HdbScanner()
+{
+	close();
+}
+
+
+/**
+ * Free decoded database entries.
+ * 
+ * \param	pc	The Kerberos context.
+ * \param	entries	The entries; emptied.
+ **/
+static void free_entries(krb5_context pc, vector<hdb_entry_ex>& entries)
+{
+	for (size_t i = 0; i < entries.size(); i++) {
+		hdb_free_entry(pc, &entries[i]);
+	}
+	entries.clear();
+}
+
+
+/**
+ * Batches of decoded entries, handed from the reading thread of
+ * HdbScanner::scan() to the converting ones.
+ **/
+struct HdbScanner::ConversionQueue
+{
+	/** Entries converted together, and their conversions. */
+	struct Batch
+	{
+		vector<hdb_entry_ex> entries;
+		vector<ScannedPrincipal> records;
+	};
+	
+	ConversionQueue(const size_t capacity)
+		:	capacity(capacity), closed(false), result(0) {}
+	
+	/**
+	 * Queue a batch, waiting while the queue is full.
+	 * 
+	 * \return	false if a conversion failed; the batch was not
+	 * 		queued then.
+	 **/
+	const bool push(Batch* pb)
+	{
+		{
+			boost::unique_lock<boost::mutex> lock(mutex);
+			while (pending.size() >= capacity && !result) {
+				drained.wait(lock);
+			}
+			if (result) {
+				return false;
+			}
+			pending.push_back(pb);
+		}
+		filled.notify_one();
+		return true;
+	}
+	
+	/**
+	 * Take the next batch, waiting while the queue is empty.
+	 * 
+	 * \return	the batch; <code>NULL</code> once the queue is
+	 * 		closed and empty.
+	 **/
+	Batch* pop()
+	{
+		Batch* pb = NULL;
+		{
+			boost::unique_lock<boost::mutex> lock(mutex);
+			while (pending.empty() && !closed) {
+				filled.wait(lock);
+			}
+			if (pending.empty()) {
+				return NULL;
+			}
+			pb = pending.front();
+			pending.pop_front();
+		}
+		drained.notify_one();
+		return pb;
+	}
+	
+	/**
+	 * Let the converting threads end once the queue is empty.
+	 **/
+	void close()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			closed = true;
+		}
+		filled.notify_all();
+	}
+	
+	/**
+	 * Record a failed conversion; only the first error is kept.
+	 **/
+	void fail(const int32_t code)
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			if (!result) {
+				result = code;
+			}
+		}
+		drained.notify_all();
+	}
+	
+	/**
+	 * Get the error code of the first failed conversion.
+	 **/
+	const int32_t failure()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		return result;
+	}
+	
+	boost::mutex mutex;
+	/** Signalled when a batch was queued or the queue was closed. */
+	boost::condition_variable filled;
+	/** Signalled when a batch was taken or a conversion failed. */
+	boost::condition_variable drained;
+	std::deque<Batch*> pending;
+	const size_t capacity;
+	bool closed;
+	int32_t result;
+};
+
+
+const bool HdbScanner::next_entry(hdb_entry_ex& entry)
+{
+	if (!_db) {
+		return false;
+	}
+	krb5_context pc = *_krb5;
+	
+	memset(&entry, 0, sizeof(hdb_entry_ex));
+	// Without HDB_F_DECRYPT, the keys stay encrypted (and the
+	// master key is not needed).
+	krb5_error_code ret = (_position == 0) ?
+			_db->hdb_firstkey(pc, _db, 0, &entry) :
+			_db->hdb_nextkey(pc, _db, 0, &entry);
+	if (ret == HDB_ERR_NOENTRY) {
+		close();
+		return false;
+	}
+	error::throw_on_error(ret);
+	_position++;
+	return true;
+}
+
+
+const bool HdbScanner::next(ScannedPrincipal& record)
+{
+	hdb_entry_ex entry;
+	if (!next_entry(entry)) {
+		return false;
+	}
+	
+	krb5_context pc = *_krb5;
+	try {
+		convert(pc, entry.entry, record);
+	}
+	catch (...) {
+		hdb_free_entry(pc, &entry);
+		throw;
+	}
+	hdb_free_entry(pc, &entry);
+	return true;
+}
+
+
+shared_ptr< vector<ScannedPrincipal> > HdbScanner::scan(
+	const string& dbname,
+	const unsigned int workers,
+	shared_ptr<Krb5Context> krb5
+) {
+	HdbScanner scanner(dbname, krb5);
+	krb5_context pc = *scanner._krb5;
+	
+	shared_ptr< vector<ScannedPrincipal> > pret(
+		new vector<ScannedPrincipal>()
+	);
+	if (workers <= 1) {
+		ScannedPrincipal record;
+		while (scanner.next(record)) {
+			pret->push_back(record);
+		}
+		return pret;
+	}
+	
+	// Decoding happens while reading and cannot be split up, but the
+	// conversions (name unparsing and copies) can overlap with it.
+	typedef ConversionQueue::Batch Batch;
+	ConversionQueue queue(2 * workers);
+	boost::thread_group threads;
+	vector< shared_ptr<Batch> > batches;
+	shared_ptr<Batch> pb;
+	bool queued = true;
+	try {
+		for (unsigned int i = 0; i < workers; i++) {
+			threads.create_thread(
+				boost::bind(convert_batches, pc, &queue)
+			);
+		}
+		
+		bool more = true;
+		while (more) {
+			pb.reset(new Batch());
+			queued = false;
+			pb->entries.reserve(BATCH_SIZE);
+			hdb_entry_ex entry;
+			while (pb->entries.size() < BATCH_SIZE &&
+					(more = scanner.next_entry(entry))) {
+				pb->entries.push_back(entry);
+			}
+			if (pb->entries.empty()) {
+				break;
+			}
+			pb->records.resize(pb->entries.size());
+			batches.push_back(pb);
+			if (!queue.push(pb.get())) {
+				break;
+			}
+			queued = true;
+		}
+	}
+	catch (...) {
+		if (pb && !queued) {
+			free_entries(pc, pb->entries);
+		}
+		queue.close();
+		threads.join_all();
+		throw;
+	}
+	if (pb && !queued) {
+		free_entries(pc, pb->entries);
+	}
+	queue.close();
+	threads.join_all();
+	error::throw_on_error(queue.failure());
+	
+	size_t total = 0;
+	for (size_t i = 0; i < batches.size(); i++) {
+		total += batches[i]->records.size();
+	}
+	pret->reserve(total);
+	for (size_t i = 0; i < batches.size(); i++) {
+		vector<ScannedPrincipal>& records = batches[i]->records;
+		pret->insert(pret->end(), records.begin(), records.end());
+		vector<ScannedPrincipal>().swap(records);
+	}
+	return pret;
+}
+
+
+void HdbScanner::convert_batches(krb5_context pc, ConversionQueue* queue)
+{
+	while (ConversionQueue::Batch* pb = queue->pop()) {
+		// After a failure, the entries are only freed.
+		bool skip = queue->failure() != 0;
+		for (size_t i = 0; i < pb->entries.size(); i++) {
+			if (!skip) {
+				try {
+					convert(pc, pb->entries[i].entry, pb->records[i]);
+				}
+				catch (const error& e) {
+					queue->fail(e.error_code() ? e.error_code() : KADM5_FAILURE);
+					skip = true;
+				}
+				catch (const std::bad_alloc&) {
+					queue->fail(ENOMEM);
+					skip = true;
+				}
+				catch (...) {
+					queue->fail(KADM5_FAILURE);
+					skip = true;
+				}
+			}
+			hdb_free_entry(pc, &pb->entries[i]);
+		}
+		pb->entries.clear();
+	}
+}
+
+
+string HdbScanner::default_dbname(krb5_context pc)
+{
+	struct hdb_dbinfo* pinfo = NULL;
+	if (hdb_get_dbinfo(pc, &pinfo) != 0) {
+		return "";
+	}
+	
+	char* prealm = NULL;
+	krb5_get_default_realm(pc, &prealm);
+	
+	// Prefer the default realm's database, else take the first one.
+	string dbname;
+	for (struct hdb_dbinfo* pd = hdb_dbinfo_get_next(pinfo, NULL);
+		pd;
+		pd = hdb_dbinfo_get_next(pinfo, pd)
+	) {
+		const char* pdbrealm = hdb_dbinfo_get_realm(pc, pd);
+		const char* pdbname = hdb_dbinfo_get_dbname(pc, pd);
+		if (!pdbname) {
+			continue;
+		}
+		if (dbname.empty()) {
+			dbname = pdbname;
+		}
+		if (prealm && pdbrealm && strcmp(prealm, pdbrealm) == 0) {
+			dbname = pdbname;
+			break;
+		}
+	}
+	
+	free(prealm);
+	hdb_free_dbinfo(pc, &pinfo);
+	return dbname;
+}
+
+
+void HdbScanner::convert(
+	krb5_context pc,
+	const hdb_entry& entry,
+	ScannedPrincipal& record
+) {
+	record._name = unparse(pc, entry.principal);
+	
+	// The library reports the creation if there was no modification.
+	const Event& changed = entry.modified_by ?
+			*entry.modified_by : entry.created_by;
+	record._modifier = unparse(pc, changed.principal);
+	record._mod_date = changed.time;
+	
+	record._princ_expire_time = entry.valid_end ? *entry.valid_end : 0;
+	record._pw_expiration = entry.pw_end ? *entry.pw_end : 0;
+	record._max_life = entry.max_life ? *entry.max_life : 0;
+	record._max_renewable_life = entry.max_renew ? *entry.max_renew : 0;
+	
+	time_t t = 0;
+	if (hdb_entry_get_pw_change_time(&entry, &t) != 0) {
+		t = 0;
+	}
+	record._last_pwd_change = t;
+	record._kvno = entry.kvno;
+}
+
+
+void HdbScanner::close()
+{
+	if (!_db) {
+		return;
+	}
+	KADM5_DEBUG("HdbScanner::close()\n");
+	
+	krb5_context pc = *_krb5;
+	_db->hdb_close(pc, _db);
+	_db->hdb_destroy(pc, _db);
+	_db = NULL;
+}
+
+
+} /* namespace kadm5 */
@@ -0,0 +1,405 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef HDBSCANNER_HPP_
+#define HDBSCANNER_HPP_
+
+// STL and Boost
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <hdb.h>
+
+// Local
+#include "Krb5Context.hpp"
+
+namespace kadm5
+{
+
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+/**
+ * \brief
+ * Read-only copy of a principal's database entry, as produced by HdbScanner.
+ * 
+ * The accessors return the same values as those of Principal, but do not
+ * need a Context or server round trips.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class ScannedPrincipal
+{
+public:
+	/**
+	 * Creates an empty record.
+	 **/
+	ScannedPrincipal();
+	
+	/**
+	 * Get the Principal's name, including the realm.
+	 * 
+	 * \return	the Principal's name.
+	 **/
+	const string& name() const { return _name; }
+	
+	/**
+	 * Get the date when the Principal expires.
+	 * 
+	 * \return	the expiry date; <code>pos_infin</code> if the
+	 * 		Principal never expires.
+	 **/
+	const ptime expire_time() const;
+	
+	/**
+	 * Get the date when the Principal's password expires.
+	 * 
+	 * \return	the password's expiry date; <code>pos_infin</code>
+	 * 		if it never expires.
+	 **/
+	const ptime password_expiration() const;
+	
+	/**
+	 * Get the maximum lifetime of the Principal's tickets.
+	 * 
+	 * \return	the maximum ticket lifetime; <code>pos_infin</code>
+	 * 		if the realm's limit applies.
+	 **/
+	const time_duration max_lifetime() const;
+	
+	/**
+	 * Get the maximum renewable lifetime of the Principal's tickets.
+	 * 
+	 * \return	the maximum renewable lifetime;
+	 * 		<code>pos_infin</code> if the realm's limit applies.
+	 **/
+	const time_duration max_renewable_lifetime() const;
+	
+	/**
+	 * Get the name of the Principal who last modified (or created)
+	 * the entry.
+	 * 
+	 * \return	the modifier's name; empty if unknown.
+	 **/
+	const string& modifier() const { return _modifier; }
+	
+	/**
+	 * Get the date of the entry's last modification (or creation).
+	 * 
+	 * \return	the modification date; <code>neg_infin</code> if
+	 * 		unknown.
+	 **/
+	const ptime modify_time() const;
+	
+	/**
+	 * Get the date of the last password change.
+	 * 
+	 * \return	the date of the last password change;
+	 * 		<code>neg_infin</code> if the database does not
+	 * 		record it.
+	 **/
+	const ptime last_password_change() const;
+	
+	/**
+	 * Get the date of the last successful authentication.
+	 * 
+	 * \note
+	 * Heimdal's database does not record this; see
+	 * Principal::last_success().
+	 * 
+	 * \return	<code>neg_infin</code>.
+	 **/
+	const ptime last_success() const;
+	
+	/**
+	 * Get the date of the last failed authentication.
+	 * 
+	 * \note
+	 * Heimdal's database does not record this; see
+	 * Principal::last_failed().
+	 * 
+	 * \return	<code>neg_infin</code>.
+	 **/
+	const ptime last_failed() const;
+	
+	/**
+	 * Get the version number of the Principal's current keys.
+	 * 
+	 * \return	the key version number.
+	 **/
+	const unsigned int key_version() const { return _kvno; }
+
+private:
+	friend class HdbScanner;
+	
+	/** The Principal's name. */
+	string _name;
+	/** Name of the last modifier. */
+	string _modifier;
+	/** Expiry date of the Principal; 0 if none. */
+	krb5_timestamp _princ_expire_time;
+	/** Expiry date of the password; 0 if none. */
+	krb5_timestamp _pw_expiration;
+	/** Date of the last modification; 0 if unknown. */
+	krb5_timestamp _mod_date;
+	/** Date of the last password change; 0 if unknown. */
+	krb5_timestamp _last_pwd_change;
+	/** Maximum ticket lifetime in seconds; 0 if unlimited. */
+	krb5_deltat _max_life;
+	/** Maximum renewable lifetime in seconds; 0 if unlimited. */
+	krb5_deltat _max_renewable_life;
+	/** Version number of the current keys. */
+	unsigned int _kvno;
+};
+
+
+/**
+ * \brief
+ * Forward-only sequence of all entries of a local principal database
+ * (HDB), read directly instead of through a KAdmin server.
+ * 
+ * The database is walked sequentially and opened read-only, without the
+ * master key, so key material is neither read nor decrypted. Each entry
+ * is converted into a ScannedPrincipal. Use next() or the input iterators
+ * returned by begin() and end():
+ * \code
+ * HdbScanner scanner;
+ * for (HdbScanner::iterator it = scanner.begin();
+ * 		it != scanner.end(); ++it) {
+ * 	std::cout << it->name() << std::endl;
+ * }
+ * \endcode
+ * 
+ * See scan() for converting the entries on several threads.
+ * 
+ * \note
+ * The database library decodes every entry it walks past, so the database
+ * is read by a single scanner; splitting it among several would decode
+ * each entry once per scanner. Scanners are not thread-safe. Only works
+ * on the KDC host.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class HdbScanner : public boost::noncopyable
+{
+public:
+	/**
+	 * \brief
+	 * Single-pass input iterator over the entries of an HdbScanner.
+	 * 
+	 * Incrementing any iterator advances the underlying scanner, so all
+	 * copies except the incremented one become invalid.
+	 **/
+	class iterator
+		: public boost::iterator_facade<
+			iterator,
+			const ScannedPrincipal,
+			boost::single_pass_traversal_tag
+		>
+	{
+	public:
+		/** Creates an end iterator. */
+		iterator() : _scanner(NULL), _record() {}
+		
+		/**
+		 * Creates an iterator pointing to the scanner's next entry.
+		 * 
+		 * \param	ps	The scanner to read from.
+		 **/
+		explicit iterator(HdbScanner* ps) : _scanner(ps), _record()
+			{ increment(); }
+		
+	private:
+		friend class boost::iterator_core_access;
+		
+		void increment()
+			{ if (!_scanner->next(_record)) { _scanner = NULL; } }
+		const bool equal(const iterator& other) const
+			{ return _scanner == other._scanner; }
+		const ScannedPrincipal& dereference() const { return _record; }
+		
+		/** The underlying scanner (<code>NULL</code> at the end). */
+		HdbScanner* _scanner;
+		/** The current entry. */
+		ScannedPrincipal _record;
+	};
+	
+	/**
+	 * Opens the database for scanning.
+	 * 
+	 * \param	dbname	The name of the database. If empty, the
+	 * 			<code>database</code> of the default realm in
+	 * 			the <code>[kdc]</code> section of the Kerberos
+	 * 			configuration will be used.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
+	 **/
+	explicit HdbScanner(
+		const string& dbname ="",
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
+	);
+	
+	/**
+	 * Destructor. Closes the database.
+	 **/
+	~HdbScanner();
+	
+	/**
+	 * Get the next entry of the database.
+	 * 
+	 * \param	record	Receives the next entry. Left untouched at the
+	 * 			end of the sequence.
+	 * \return	true if an entry was read; false at the end of the
+	 * 		sequence.
+	 **/
+	const bool next(ScannedPrincipal& record);
+	
+	/**
+	 * Get an iterator pointing to the next entry of the sequence.
+	 * 
+	 * \return	an input iterator reading from this scanner.
+	 **/
+	iterator begin() { return iterator(this); }
+	
+	/**
+	 * Get the end iterator.
+	 * 
+	 * \return	an iterator that compares equal to exhausted
+	 * 		iterators.
+	 **/
+	iterator end() { return iterator(); }
+	
+	/**
+	 * Get the name of the scanned database.
+	 * 
+	 * \return	the database name; empty for the library's default.
+	 **/
+	const string& dbname() const { return _dbname; }
+	
+	/**
+	 * Get the number of database entries read so far.
+	 * 
+	 * \return	the number of entries read.
+	 **/
+	const unsigned long position() const { return _position; }
+	
+	/**
+	 * Scan the whole database. The calling thread reads and decodes
+	 * the entries; they are handed in batches to <code>workers</code>
+	 * threads that convert them into ScannedPrincipals.
+	 * 
+	 * \param	dbname	The name of the database (see HdbScanner()).
+	 * \param	workers	The number of converting threads. With 1 or
+	 * 			less, the entries are converted while reading.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
+	 * \return	the entries in database order.
+	 **/
+	static shared_ptr< vector<ScannedPrincipal> > scan(
+		const string& dbname ="",
+		const unsigned int workers =1,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
+	);
+
+private:
+	/** Batches of read entries waiting for conversion (see scan()). */
+	struct ConversionQueue;
+	
+	/**
+	 * Read and decode the next database entry.
+	 * 
+	 * \param	entry	Receives the entry; the caller must free it
+	 * 			with <code>hdb_free_entry()</code>.
+	 * \return	true if an entry was read; false at the end of the
+	 * 		database.
+	 **/
+	const bool next_entry(hdb_entry_ex& entry);
+	
+	/**
+	 * Thread function of scan(): convert and free the queued entries
+	 * until the queue is closed and empty.
+	 * 
+	 * \param	pc	The Kerberos context.
+	 * \param	queue	The queue to take batches from.
+	 **/
+	static void convert_batches(krb5_context pc, ConversionQueue* queue);
+	
+	/**
+	 * Look up the database of the default realm in the Kerberos
+	 * configuration.
+	 * 
+	 * \param	pc	The Kerberos context.
+	 * \return	the database name; empty if none is configured.
+	 **/
+	static string default_dbname(krb5_context pc);
+	
+	/**
+	 * Copy the interesting fields of a database entry.
+	 * 
+	 * \param	pc	The Kerberos context.
+	 * \param	entry	The database entry.
+	 * \param	record	Receives the fields.
+	 **/
+	static void convert(
+		krb5_context pc,
+		const hdb_entry& entry,
+		ScannedPrincipal& record
+	);
+	
+	/**
+	 * Close and release the database.
+	 **/
+	void close();
+	
+	/** The Kerberos context. */
+	shared_ptr<Krb5Context> _krb5;
+	/** The opened database; NULL once closed. */
+	HDB* _db;
+	/** Name of the database. */
+	string _dbname;
+	/** Number of entries read. */
+	unsigned long _position;
+};
+
+} /* namespace kadm5 */
+
+#endif /*HDBSCANNER_HPP_*/
@@ -0,0 +1,120 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <string>
+
+// Kerberos
+#include <kadm5/admin.h>
+
+// Local
+#include "Error.hpp"
+#include "KeytabContext.hpp"
+#include "MemoryCCache.hpp"
+
+namespace kadm5
+{
+
+KeytabContext::KeytabContext(
+	const string& keytab,
+	const string& client,
+	const string& realm,
+	const string& host,
+	const int port,
+	const bool lazy,
+	shared_ptr<Krb5Context> krb5
+)	:	CCacheContext(
+			shared_ptr<MemoryCCache>(),
+			client,
+			realm,
+			host,
+			port,
+			lazy,
+			krb5
+		),
+		_keytab(keytab),
+		_client(client),
+		_realm(realm)
+{
+	if (lazy) {
+		return;
+	}
+	// The base class cannot connect since it lacks the credentials.
+	establish_handle();
+	
+	// Check connection. Keep the result; Connection caches it.
+	u_int32_t p;
+	error::throw_on_error(
+		kadm5_get_privs(*this, &p)
+	);
+	set_initial_privileges(p);
+}
+
+
+void KeytabContext::open_handle()
+{
+	// Returns the current credentials unless they are about to expire.
+	shared_ptr<MemoryCCache> pcreds =
+		MemoryCCache::from_keytab(
+			_keytab, _client, _realm, krb5()
+		);
+	if (pcreds != credentials()) {
+		use_credentials(pcreds);
+	}
+	CCacheContext::open_handle();
+}
+
+
+shared_ptr<Context> KeytabContext::clone() const
+{
+	// See CCacheContext::clone().
+	string host;
+	int port = 0;
+	{
+		boost::mutex::scoped_lock lock(handle_mutex());
+		shared_ptr<kadm5_config_params> pp = config_params();
+		host = pp->admin_server ? pp->admin_server : "";
+		port = (pp->mask & KADM5_CONFIG_KADMIND_PORT) ?
+				pp->kadmind_port : 0;
+	}
+	
+	shared_ptr<KeytabContext> pclone(
+		new KeytabContext(
+			_keytab, _client, _realm, host, port, lazy(), krb5()
+		)
+	);
+	pclone->inherit_failover(*this);
+	return pclone;
+}
+
+} /* namespace kadm5 */
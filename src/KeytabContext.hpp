@@ -0,0 +1,123 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef KEYTABCONTEXT_HPP_
+#define KEYTABCONTEXT_HPP_
+
+// STL and Boost
+#include <string>
+
+// Local
+#include "CCacheContext.hpp"
+
+namespace kadm5
+{
+
+using std::string;
+
+/**
+ * \brief
+ * Kerberos and KAdmin Context authenticating with a key from a keytab.
+ * 
+ * The key is used to fetch a KAdmin service ticket into a MemoryCCache
+ * (see MemoryCCache::from_keytab()). Other KeytabContexts for the same
+ * keytab and client, including clones, reuse that ticket until it is about
+ * to expire; so opening them needs neither the KDC nor the keytab.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class KeytabContext : public CCacheContext
+{
+public:
+	/**
+	 * Constructs a new KeytabContext from the given connection data.
+	 * 
+	 * \param	keytab	The name of the keytab holding the client's
+	 * 			key. If empty, the libraries' default keytab
+	 * 			will be used.
+	 * \param	client	The name of the Kerberos principal to
+	 * 			authenticate as. If missing, the libraries'
+	 * 			default value will be used.
+	 * \param	realm	The realm to assume if this part of a
+	 * 			Principal's name is omitted. If missing,
+	 * 			the libraries' default value will be used.
+	 * \param	host	Hostname of the KAdmin server to connect to.
+	 * 			If missing, defaults to the
+	 * 			<code>admin_server</code> parameter in the
+	 * 			Kerberos configuration.
+	 * \param	port	The KAdmin server's port number.
+	 * 			If <code>0</code>, uses the libraries' default
+	 * 			port number.
+	 * \param	lazy	If true, fetch the ticket and connect to the
+	 * 			KAdmin server on the first use of the KAdmin
+	 * 			handle instead of now.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
+	 **/
+	explicit KeytabContext(
+		const string& keytab,
+		const string& client,
+		const string& realm,
+		const string& host,
+		const int port,
+		const bool lazy =false,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
+	);
+	
+	/**
+	 * Open another connection with the shared keytab credentials,
+	 * fetching a new ticket if the current one is about to expire.
+	 * 
+	 * \return	a smart pointer to the new KeytabContext.
+	 **/
+	virtual shared_ptr<Context> clone() const;
+
+protected:
+	/**
+	 * Get the shared ticket, fetching a new one if the current ticket is
+	 * about to expire, then connect (see CCacheContext::open_handle()).
+	 **/
+	virtual void open_handle();
+
+private:
+	/** Name of the keytab. */
+	string _keytab;
+	/** The client as passed to the constructor. */
+	string _client;
+	/** The realm as passed to the constructor. */
+	string _realm;
+};
+
+} /* namespace kadm5 */
+
+#endif /*KEYTABCONTEXT_HPP_*/
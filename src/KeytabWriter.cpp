@@ -0,0 +1,257 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// System
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Kerberos
+#include <krb5.h>
+#include <krb5_err.h>
+
+// Local
+#include "Error.hpp"
+#include "KeytabWriter.hpp"
+
+
+namespace kadm5
+{
+
+/** Keytab file format version written by KeytabWriter. */
+static const unsigned char KEYTAB_VERSION[2] = { 0x05, 0x02 };
+
+
+/**
+ * Overwrite the contents of a buffer holding key material.
+ * 
+ * \param	buffer	The buffer to wipe.
+ **/
+static void wipe(vector<char>& buffer)
+{
+	if (!buffer.empty()) {
+		memset(&buffer[0], 0, buffer.size());
+	}
+}
+
+
+KeytabWriter::KeytabWriter(
+	const string& name,
+	const bool append,
+	const size_t buffer_size
+)	:	_path(name),
+		_file(NULL),
+		_buffer(buffer_size > 0 ? buffer_size : 1),
+		_entries(0)
+{
+	KADM5_DEBUG("KeytabWriter::KeytabWriter(" + name + ")\n");
+	
+	if (name.compare(0, 5, "FILE:") == 0) {
+		_path = name.substr(5);
+	}
+	else if (name.compare(0, 7, "WRFILE:") == 0) {
+		_path = name.substr(7);
+	}
+	else if (name.find(':') != string::npos && name[0] != '/') {
+		// Only file based keytabs are supported.
+		error::throw_on_error(KRB5_KT_UNKNOWN_TYPE);
+	}
+	if (_path.empty()) {
+		error::throw_on_error(KRB5_KT_BADNAME);
+	}
+	
+	int flags = append ? (O_RDWR | O_CREAT | O_APPEND) :
+				(O_WRONLY | O_CREAT | O_TRUNC);
+	int fd = open(_path.c_str(), flags, 0600);
+	if (fd < 0) {
+		error::throw_on_error(errno);
+	}
+	
+	// Keep writing to an existing keytab only if we know its format.
+	bool empty = true;
+	if (append) {
+		struct stat st;
+		unsigned char version[2];
+		if (fstat(fd, &st) != 0) {
+			int e = errno;
+			::close(fd);
+			error::throw_on_error(e);
+		}
+		if (st.st_size > 0) {
+			empty = false;
+			if (pread(fd, version, 2, 0) != 2 ||
+				memcmp(version, KEYTAB_VERSION, 2) != 0
+			) {
+				::close(fd);
+				error::throw_on_error(KRB5_KEYTAB_BADVNO);
+			}
+		}
+	}
+	
+	_file = fdopen(fd, append ? "a" : "w");
+	if (!_file) {
+		int e = errno;
+		::close(fd);
+		error::throw_on_error(e);
+	}
+	setvbuf(_file, &_buffer[0], _IOFBF, _buffer.size());
+	
+	if (empty && fwrite(KEYTAB_VERSION, 1, 2, _file) != 2) {
+		int e = errno;
+		fclose(_file);
+		_file = NULL;
+		error::throw_on_error(e ? e : EIO);
+	}
+}
+
+
+KeytabWriter::~KeytabWriter()
+{
+	try {
+		close();
+	}
+	catch (...) {}
+}
+
+
+void KeytabWriter::add(
+	krb5_context pc,
+	krb5_const_principal pp,
+	const krb5_kvno kvno,
+	const krb5_enctype enctype,
+	const void* key,
+	const size_t length,
+	const time_t timestamp
+) {
+	if (!_file || length > 0xffff) {
+		error::throw_on_error(EINVAL);
+	}
+	
+	// Encode the entry in one block of the exact size; growing the
+	// vector would leave copies of the key in released memory.
+	size_t n = krb5_principal_get_num_comp(pc, pp);
+	const char* prealm = krb5_principal_get_realm(pc, pp);
+	size_t size = 4 + 2 + 2 + strlen(prealm) + 4 + 4 + 1 + 2 +
+			2 + length + 4;
+	for (size_t i = 0; i < n; i++) {
+		size += 2 + strlen(krb5_principal_get_comp_string(pc, pp, i));
+	}
+	
+	vector<char> record;
+	record.reserve(size);
+	put32(record, size - 4);
+	put16(record, n);
+	put_data(record, prealm, strlen(prealm));
+	for (size_t i = 0; i < n; i++) {
+		const char* pcomp = krb5_principal_get_comp_string(pc, pp, i);
+		put_data(record, pcomp, strlen(pcomp));
+	}
+	put32(record, krb5_principal_get_type(pc, pp));
+	put32(record, timestamp);
+	record.push_back(static_cast<char>(kvno & 0xff));
+	put16(record, enctype);
+	put_data(record, key, length);
+	put32(record, kvno);
+	
+	size_t written = fwrite(&record[0], 1, record.size(), _file);
+	wipe(record);
+	if (written != record.size()) {
+		error::throw_on_error(errno ? errno : EIO);
+	}
+	_entries++;
+}
+
+
+void KeytabWriter::flush()
+{
+	if (_file && fflush(_file) != 0) {
+		error::throw_on_error(errno ? errno : EIO);
+	}
+}
+
+
+void KeytabWriter::close()
+{
+	if (!_file) {
+		return;
+	}
+	KADM5_DEBUG("KeytabWriter::close(): " + _path + "\n");
+	
+	int ret = fclose(_file);
+	int e = errno;
+	_file = NULL;
+	wipe(_buffer);
+	
+	if (ret != 0) {
+		error::throw_on_error(e ? e : EIO);
+	}
+}
+
+
+void KeytabWriter::put16(vector<char>& record, const u_int32_t value)
+{
+	record.push_back((value >> 8) & 0xff);
+	record.push_back(value & 0xff);
+}
+
+
+void KeytabWriter::put32(vector<char>& record, const u_int32_t value)
+{
+	record.push_back((value >> 24) & 0xff);
+	record.push_back((value >> 16) & 0xff);
+	record.push_back((value >> 8) & 0xff);
+	record.push_back(value & 0xff);
+}
+
+
+void KeytabWriter::put_data(
+	vector<char>& record,
+	const void* data,
+	const size_t length
+) {
+	if (length > 0xffff) {
+		error::throw_on_error(EINVAL);
+	}
+	put16(record, length);
+	const char* p = static_cast<const char*>(data);
+	record.insert(record.end(), p, p + length);
+}
+
+
+} /* namespace kadm5 */
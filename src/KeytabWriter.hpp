@@ -0,0 +1,185 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef KEYTABWRITER_HPP_
+#define KEYTABWRITER_HPP_
+
+// STL and Boost
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+// Kerberos
+#include <krb5.h>
+
+namespace kadm5
+{
+
+using std::string;
+using std::vector;
+
+/**
+ * \brief
+ * Buffered writer for keytab files in the <code>FILE:</code> format
+ * (version 0x502) understood by both Heimdal and MIT Kerberos.
+ * 
+ * Adding entries through <code>krb5_kt_add_entry</code> opens, scans and
+ * locks the keytab for every single key. A KeytabWriter instead keeps the
+ * file open and appends the encoded entries to a private buffer that is
+ * flushed in large blocks, so exporting the keys of hundreds of principals
+ * costs a handful of <code>write</code> calls. The buffer is wiped before it
+ * is released.
+ * 
+ * \note
+ * Other programs must not modify the keytab while a KeytabWriter has it
+ * open.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class KeytabWriter : public boost::noncopyable
+{
+public:
+	/**
+	 * Open a keytab file for writing. New files are created with mode
+	 * <code>0600</code>.
+	 * 
+	 * \param	name	The keytab's name; either a plain path or one
+	 * 			prefixed with <code>FILE:</code> or
+	 * 			<code>WRFILE:</code>.
+	 * \param	append	If true, add the entries to an existing
+	 * 			keytab; otherwise, replace its contents.
+	 * \param	buffer_size	Size of the write buffer in bytes.
+	 **/
+	explicit KeytabWriter(
+		const string& name,
+		const bool append =false,
+		const size_t buffer_size =65536
+	);
+	
+	/**
+	 * Flush pending entries and close the file. Errors are ignored;
+	 * call close() to notice them.
+	 **/
+	~KeytabWriter();
+	
+	/**
+	 * Add a key to the keytab.
+	 * 
+	 * \param	pc	The Kerberos context the principal belongs to.
+	 * \param	pp	The principal whose key to add.
+	 * \param	kvno	The key's version number.
+	 * \param	enctype	The key's encryption type.
+	 * \param	key	The raw key.
+	 * \param	length	The key's length in bytes.
+	 * \param	timestamp	The time the key was written.
+	 **/
+	void add(
+		krb5_context pc,
+		krb5_const_principal pp,
+		const krb5_kvno kvno,
+		const krb5_enctype enctype,
+		const void* key,
+		const size_t length,
+		const time_t timestamp
+	);
+	
+	/**
+	 * Write all buffered entries to the file.
+	 **/
+	void flush();
+	
+	/**
+	 * Flush pending entries and close the file. Further calls to add()
+	 * will throw.
+	 **/
+	void close();
+	
+	/**
+	 * Get the keytab file's path.
+	 * 
+	 * \return	the path without any <code>FILE:</code> prefix.
+	 **/
+	const string path() const { return _path; }
+	
+	/**
+	 * Get the number of entries added by this writer.
+	 * 
+	 * \return	the number of keys added so far.
+	 **/
+	const size_t entries() const { return _entries; }
+
+private:
+	/**
+	 * Append a big-endian 16-bit value to the given record.
+	 * 
+	 * \param	record	The record being encoded.
+	 * \param	value	The value to append.
+	 **/
+	static void put16(vector<char>& record, const u_int32_t value);
+	
+	/**
+	 * Append a big-endian 32-bit value to the given record.
+	 * 
+	 * \param	record	The record being encoded.
+	 * \param	value	The value to append.
+	 **/
+	static void put32(vector<char>& record, const u_int32_t value);
+	
+	/**
+	 * Append a counted octet string (16-bit length followed by the
+	 * data) to the given record.
+	 * 
+	 * \param	record	The record being encoded.
+	 * \param	data	The octets to append.
+	 * \param	length	The number of octets.
+	 **/
+	static void put_data(
+		vector<char>& record,
+		const void* data,
+		const size_t length
+	);
+	
+	/** The keytab file's path. */
+	string _path;
+	/** The open keytab file; NULL after close(). */
+	FILE* _file;
+	/** Buffer used by _file, wiped on close(). */
+	vector<char> _buffer;
+	/** Number of entries added. */
+	size_t _entries;
+};
+
+} /* namespace kadm5 */
+
+#endif /*KEYTABWRITER_HPP_*/
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+// Kerberos
+#include <krb5.h>
+
+// Local
+#include "Error.hpp"
+#include "Krb5Context.hpp"
+
+namespace kadm5
+{
+
+/** The process-wide instance returned by Krb5Context::shared(). */
+static shared_ptr<Krb5Context> shared_context;
+/** Guards shared_context. */
+static boost::mutex shared_context_mutex;
+
+
+shared_ptr<Krb5Context> Krb5Context::create()
+{
+	return shared_ptr<Krb5Context>( new Krb5Context );
+}
+
+
+shared_ptr<Krb5Context> Krb5Context::shared()
+{
+	boost::mutex::scoped_lock lock(shared_context_mutex);
+	if (!shared_context) {
+		shared_context = create();
+	}
+	return shared_context;
+}
+
+
+Krb5Context::Krb5Context()
+	:	_context(NULL)
+{
+	KADM5_DEBUG("Krb5Context(): Initializing Kerberos context\n");
+	error::throw_on_error( krb5_init_context(&_context) );
+	
+	// The library determines the default credential cache name on first
+	// use and stores it in the context; do that now, before the context
+	// may be shared between threads.
+	krb5_cc_default_name(_context);
+}
+
+
+Krb5Context::~Krb5Context()
+{
+	KADM5_DEBUG("~Krb5Context(): Freeing Kerberos context\n");
+	krb5_free_context(_context);
+}
+
+
+void Krb5Context::reload_config()
+{
+	KADM5_DEBUG("Krb5Context::reload_config()\n");
+	
+	char** pfiles = NULL;
+	error::throw_on_error( krb5_get_default_config_files(&pfiles) );
+	krb5_error_code ret = krb5_set_config_files(_context, pfiles);
+	krb5_free_config_files(pfiles);
+	error::throw_on_error(ret);
+	
+	krb5_cc_default_name(_context);
+}
+
+} /* namespace kadm5 */
@@ -0,0 +1,122 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef KRB5CONTEXT_HPP_
+#define KRB5CONTEXT_HPP_
+
+// STL and Boost
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+
+/**
+ * \brief
+ * RAII holder for a Kerberos library context (<code>krb5_context</code>)
+ * that several Context objects may share.
+ * 
+ * Initializing a <code>krb5_context</code> parses the configuration files
+ * and loads plugins. Contexts therefore share a process-wide instance
+ * (see shared()) unless they are given their own one (see create()). Each
+ * of them holds a smart pointer to its Krb5Context; it is freed together
+ * with the last reference.
+ * 
+ * \note
+ * Heimdal serializes access to the mutable parts of a
+ * <code>krb5_context</code> (error messages, credential cache and keytab
+ * type registries) internally. The Contexts sharing one only read its
+ * settings: they keep their realm in their KAdmin parameters instead of
+ * changing the default realm, and the lazily determined default credential
+ * cache name is fixed on construction. Hence, Contexts sharing a
+ * Krb5Context may be used from different threads, as long as each Context
+ * itself is only used by one thread at a time. The exception is
+ * reload_config().
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class Krb5Context : public boost::noncopyable
+{
+public:
+	/**
+	 * Factory function that initializes a new, unshared Kerberos
+	 * context.
+	 * 
+	 * \return	a smart pointer to the new Krb5Context.
+	 **/
+	static shared_ptr<Krb5Context> create();
+	
+	/**
+	 * Get the process-wide Kerberos context, initializing it on the
+	 * first call.
+	 * 
+	 * \return	a smart pointer to the shared Krb5Context.
+	 **/
+	static shared_ptr<Krb5Context> shared();
+	
+	/**
+	 * Frees the Kerberos context.
+	 **/
+	~Krb5Context();
+	
+	// Implicit type conversion for library functions
+	operator krb5_context_data*() const { return _context; }
+	
+	/**
+	 * Re-read the Kerberos configuration files.
+	 * 
+	 * \note
+	 * This changes the settings of every Context using this
+	 * Krb5Context. None of them may be used by other threads during the
+	 * call.
+	 **/
+	void reload_config();
+
+private:
+	/**
+	 * Initialize the Kerberos context. Use the factory functions.
+	 **/
+	Krb5Context();
+	
+	/** The Kerberos context. */
+	krb5_context _context;
+};
+
+} /* namespace kadm5 */
+
+#endif /*KRB5CONTEXT_HPP_*/
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <string>
+#include <vector>
+
+// Kerberos
+#include <kadm5/admin.h>
+
+// Local
+#include "Error.hpp"
+#include "LocalContext.hpp"
+
+/*
+ * Entry point of the server-side KAdmin library. Heimdal declares it in its
+ * private headers only, which cannot be included on their own.
+ */
+extern "C" kadm5_ret_t kadm5_s_init_with_password_ctx(
+	krb5_context context,
+	const char* client_name,
+	const char* password,
+	const char* service_name,
+	kadm5_config_params* realm_params,
+	unsigned long struct_version,
+	unsigned long api_version,
+	void** server_handle
+);
+
+namespace kadm5
+{
+
+LocalContext::LocalContext(
+	const string& dbname,
+	const string& realm,
+	const string& client,
+	const bool lazy,
+	shared_ptr<Krb5Context> krb5
+)	:	Context(
+			client.empty() ? KADM5_ADMIN_SERVICE : client,
+			realm,
+			"",
+			0,
+			krb5
+		),
+		_dbname(dbname),
+		_client(client),
+		_realm(realm),
+		_lazy(lazy)
+{
+	KADM5_DEBUG("LocalContext::LocalContext(): Constructing...\n");
+	
+	if (!_dbname.empty()) {
+		shared_ptr<kadm5_config_params> pp = config_params();
+		pp->dbname = new char[_dbname.length() + 1];
+		_dbname.copy(pp->dbname, string::npos);
+		pp->dbname[_dbname.length()] = 0;
+		pp->mask |= KADM5_CONFIG_DBNAME;
+	}
+	
+	// There is no server to fail over to.
+	set_admin_servers(std::vector<string>());
+	
+	if (_lazy) {
+		return;
+	}
+	establish_handle();
+	
+	// Keep the privileges from the ACL; Connection caches them.
+	u_int32_t p;
+	error::throw_on_error(
+		kadm5_get_privs(*this, &p)
+	);
+	set_initial_privileges(p);
+}
+
+
+void LocalContext::open_handle()
+{
+	KADM5_DEBUG(
+		"LocalContext(): Opening database '" + _dbname + "'\n"
+	);
+	
+	void* ph = NULL;
+	error::throw_on_error(
+		kadm5_s_init_with_password_ctx(
+			*this,
+			client().c_str(),
+			NULL,
+			KADM5_ADMIN_SERVICE,
+			config_params().get(),
+			KADM5_STRUCT_VERSION,
+			KADM5_API_VERSION_2,
+			&ph
+		)
+	);
+	set_kadm_handle( shared_ptr<void>(ph, kadm5_destroy) );
+}
+
+
+shared_ptr<Context> LocalContext::clone() const
+{
+	return shared_ptr<Context>(
+		new LocalContext(_dbname, _realm, _client, _lazy, krb5())
+	);
+}
+
+} /* namespace kadm5 */
@@ -0,0 +1,131 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef LOCALCONTEXT_HPP_
+#define LOCALCONTEXT_HPP_
+
+// STL and Boost
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "Context.hpp"
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+
+/**
+ * \brief
+ * Kerberos and KAdmin Context that opens the principal database directly
+ * instead of connecting to a KAdmin server.
+ * 
+ * The operations run in-process through the server-side KAdmin library
+ * (<code>libkadm5srv</code>), like <code>kadmin --local</code> does, so
+ * they need neither RPC nor authentication. This only works on the
+ * (master) KDC host and requires read and write access to the database
+ * and its master key.
+ * 
+ * \note
+ * The database is locked for each operation only, so LocalContexts may
+ * be used alongside a running kadmind.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class LocalContext : public Context
+{
+public:
+	/**
+	 * Constructs a new LocalContext for the given database.
+	 * 
+	 * \param	dbname	The name of the principal database. If empty,
+	 * 			the <code>database</code> of the realm in the
+	 * 			<code>[kdc]</code> section of the Kerberos
+	 * 			configuration will be used.
+	 * \param	realm	The realm to assume if this part of a
+	 * 			Principal's name is omitted. If missing,
+	 * 			the libraries' default value will be used.
+	 * \param	client	The name recorded as modifier of changed
+	 * 			principals and checked against the ACL. If
+	 * 			missing, <code>kadmin/admin</code>, which has
+	 * 			all privileges, will be used.
+	 * \param	lazy	If true, open the database on the first use
+	 * 			of the KAdmin handle instead of now.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
+	 **/
+	explicit LocalContext(
+		const string& dbname,
+		const string& realm,
+		const string& client,
+		const bool lazy =false,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
+	);
+	
+	/**
+	 * Open the same database once more.
+	 * 
+	 * \return	a smart pointer to the new LocalContext.
+	 **/
+	virtual shared_ptr<Context> clone() const;
+	
+	/**
+	 * Get the name of the principal database.
+	 * 
+	 * \return	the database name; empty if the configured one is
+	 * 		used.
+	 **/
+	const string& dbname() const { return _dbname; }
+
+protected:
+	/**
+	 * Open the database via the server-side KAdmin library.
+	 **/
+	virtual void open_handle();
+
+private:
+	/** Name of the database as passed to the constructor. */
+	string _dbname;
+	/** The client as passed to the constructor. */
+	string _client;
+	/** The realm as passed to the constructor. */
+	string _realm;
+	/** Whether the database is opened on first use. */
+	bool _lazy;
+};
+
+} /* namespace kadm5 */
+
+#endif /*LOCALCONTEXT_HPP_*/
@@ -0,0 +1,264 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+// Local
+#include "Context.hpp"
+#include "Error.hpp"
+#include "MemoryCCache.hpp"
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+
+/**
+ * Get the name of the principal to authenticate as, in the given realm
+ * unless the name has one. The realm is not made the Kerberos context's
+ * default since that may be shared.
+ **/
+static string client_name(
+	krb5_context pc,
+	const string& client,
+	const string& realm
+) {
+	if (client.empty()) {
+		return default_admin_client(pc);
+	}
+	if (realm.empty() || client.find("@") != string::npos) {
+		return client;
+	}
+	return client + "@" + realm;
+}
+
+
+shared_ptr<MemoryCCache> MemoryCCache::from_password(
+	const char* password,
+	const string& client,
+	const string& realm,
+	shared_ptr<Krb5Context> krb5
+) {
+	if (!password || !*password) {
+		throw bad_pw(KADM5_BAD_PASSWORD);
+	}
+	
+	shared_ptr<MemoryCCache> pret( new MemoryCCache(krb5) );
+	krb5_context pc = *pret->_krb5;
+	
+	string name = client_name(pc, client, realm);
+	krb5_principal ptmp = NULL;
+	error::throw_on_error( krb5_parse_name(pc, name.c_str(), &ptmp) );
+	shared_ptr<krb5_principal_data> pclient(
+		ptmp, boost::bind(krb5_free_principal, pc, _1)
+	);
+	
+	// Ask for the KAdmin service ticket directly (as kadmin does), so
+	// no ticket granting ticket is kept around.
+	krb5_creds creds;
+	memset(&creds, 0, sizeof(krb5_creds));
+	error::throw_on_error(
+		krb5_get_init_creds_password(
+			pc,
+			&creds,
+			pclient.get(),
+			password,
+			NULL,
+			NULL,
+			0,
+			KADM5_ADMIN_SERVICE,
+			NULL
+		)
+	);
+	
+	try {
+		pret->store(&creds);
+	}
+	catch (...) {
+		krb5_free_cred_contents(pc, &creds);
+		throw;
+	}
+	krb5_free_cred_contents(pc, &creds);
+	
+	return pret;
+}
+
+
+/** Shared keytab credentials by keytab, client and realm. */
+typedef std::map< string, shared_ptr<MemoryCCache> > KeytabCCacheMap;
+static KeytabCCacheMap keytab_ccaches;
+/** Guards keytab_ccaches. */
+static boost::mutex keytab_ccaches_mutex;
+
+
+shared_ptr<MemoryCCache> MemoryCCache::from_keytab(
+	const string& keytab,
+	const string& client,
+	const string& realm,
+	shared_ptr<Krb5Context> krb5,
+	const int min_lifetime
+) {
+	string key = keytab + "\n" + client + "\n" + realm;
+	
+	// Hold the lock while fetching, so that concurrently connecting
+	// pool members wait for one AS exchange instead of each doing one.
+	boost::mutex::scoped_lock lock(keytab_ccaches_mutex);
+	KeytabCCacheMap::iterator it = keytab_ccaches.find(key);
+	if (it != keytab_ccaches.end()) {
+		if (it->second->end_time() - time(NULL) > min_lifetime) {
+			KADM5_DEBUG(
+				"MemoryCCache: Reusing credentials in '" +
+				it->second->name() + "'\n"
+			);
+			return it->second;
+		}
+		keytab_ccaches.erase(it);
+	}
+	
+	shared_ptr<MemoryCCache> pret( new MemoryCCache(krb5) );
+	krb5_context pc = *pret->_krb5;
+	
+	string name = client_name(pc, client, realm);
+	krb5_principal ptmp = NULL;
+	error::throw_on_error( krb5_parse_name(pc, name.c_str(), &ptmp) );
+	shared_ptr<krb5_principal_data> pclient(
+		ptmp, boost::bind(krb5_free_principal, pc, _1)
+	);
+	
+	krb5_keytab pkt = NULL;
+	if (keytab.empty()) {
+		error::throw_on_error( krb5_kt_default(pc, &pkt) );
+	}
+	else {
+		error::throw_on_error( krb5_kt_resolve(pc, keytab.c_str(), &pkt) );
+	}
+	shared_ptr<krb5_keytab_data> pkeytab(
+		pkt, boost::bind(krb5_kt_close, pc, _1)
+	);
+	
+	// See from_password().
+	krb5_creds creds;
+	memset(&creds, 0, sizeof(krb5_creds));
+	error::throw_on_error(
+		krb5_get_init_creds_keytab(
+			pc,
+			&creds,
+			pclient.get(),
+			pkeytab.get(),
+			0,
+			KADM5_ADMIN_SERVICE,
+			NULL
+		)
+	);
+	
+	try {
+		pret->store(&creds);
+	}
+	catch (...) {
+		krb5_free_cred_contents(pc, &creds);
+		throw;
+	}
+	krb5_free_cred_contents(pc, &creds);
+	
+	keytab_ccaches[key] = pret;
+	return pret;
+}
+
+
+void MemoryCCache::forget_keytab_credentials()
+{
+	boost::mutex::scoped_lock lock(keytab_ccaches_mutex);
+	keytab_ccaches.clear();
+}
+
+
+MemoryCCache::MemoryCCache(shared_ptr<Krb5Context> krb5)
+	:	_krb5( krb5 ? krb5 : Krb5Context::shared() ),
+		_ccache(NULL),
+		_end_time(0)
+{
+	KADM5_DEBUG("MemoryCCache(): Constructing...\n");
+}
+
+
+MemoryCCache::~MemoryCCache()
+{
+	if (_ccache) {
+		KADM5_DEBUG("~MemoryCCache(): Destroying credential cache\n");
+		krb5_cc_destroy(*_krb5, _ccache);
+		_ccache = NULL;
+	}
+}
+
+
+void MemoryCCache::store(krb5_creds* creds)
+{
+	krb5_context pc = *_krb5;
+	
+	error::throw_on_error(
+		krb5_cc_new_unique(pc, "MEMORY", NULL, &_ccache)
+	);
+	error::throw_on_error(
+		krb5_cc_initialize(pc, _ccache, creds->client)
+	);
+	error::throw_on_error(
+		krb5_cc_store_cred(pc, _ccache, creds)
+	);
+	
+	char* ptmp = NULL;
+	error::throw_on_error( krb5_cc_get_full_name(pc, _ccache, &ptmp) );
+	shared_ptr<char> pname(ptmp, free);
+	_name = pname.get();
+	
+	error::throw_on_error( krb5_unparse_name(pc, creds->client, &ptmp) );
+	shared_ptr<char> pclient(ptmp, free);
+	_client = pclient.get();
+	
+	_end_time = creds->times.endtime;
+	KADM5_DEBUG("MemoryCCache: Stored credentials in '" + _name + "'\n");
+}
+
+} /* namespace kadm5 */
@@ -0,0 +1,196 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef MEMORYCCACHE_HPP_
+#define MEMORYCCACHE_HPP_
+
+// STL and Boost
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+
+// Local
+#include "Krb5Context.hpp"
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+
+/**
+ * \brief
+ * RAII holder for an in-memory (<code>MEMORY:</code>) credential cache that
+ * contains a ticket for the KAdmin service.
+ * 
+ * Memory credential caches are visible process-wide under their name().
+ * Hence, several Context objects may connect with the same credentials
+ * without asking the KDC (or the user) again. Each of them should hold a
+ * smart pointer to the MemoryCCache; the cache is destroyed together with
+ * the last reference.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class MemoryCCache : public boost::noncopyable
+{
+public:
+	/**
+	 * Factory function that fetches a KAdmin service ticket with the
+	 * given password and stores it in a fresh memory credential cache.
+	 * 
+	 * \param	password	The client's password as a NUL-terminated
+	 * 			string, e.g., from a SecureBuffer.
+	 * \param	client	The name of the Kerberos principal to
+	 * 			authenticate as. If empty, defaults to the
+	 * 			administrative principal belonging to the
+	 * 			libraries' default principal (see
+	 * 			default_admin_client()).
+	 * \param	realm	The realm to assume if <code>client</code>
+	 * 			does not name one. If empty, the default realm
+	 * 			will be used.
+	 * \param	krb5	The Kerberos context to use, usually the one
+	 * 			of the connecting Context. If empty, the
+	 * 			process-wide one will be used.
+	 * \return	a smart pointer to the filled credential cache.
+	 **/
+	static shared_ptr<MemoryCCache> from_password(
+		const char* password,
+		const string& client,
+		const string& realm,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
+	);
+	
+	/**
+	 * Factory function that fetches a KAdmin service ticket with a key
+	 * from the given keytab and stores it in a memory credential cache.
+	 * 
+	 * The caches are shared process-wide: as long as the ticket of an
+	 * earlier call with the same arguments is valid for at least
+	 * <code>min_lifetime</code> more seconds, that cache is returned
+	 * again without contacting the KDC or reading the keytab. Hence,
+	 * reconnects and the members of a ConnectionPool reuse one ticket.
+	 * 
+	 * \param	keytab	The name of the keytab. If empty, the
+	 * 			libraries' default keytab will be used.
+	 * \param	client	The name of the Kerberos principal to
+	 * 			authenticate as. If empty, defaults to the
+	 * 			administrative principal belonging to the
+	 * 			libraries' default principal (see
+	 * 			default_admin_client()).
+	 * \param	realm	The realm to assume if <code>client</code>
+	 * 			does not name one. If empty, the default realm
+	 * 			will be used.
+	 * \param	krb5	The Kerberos context to use if a new ticket
+	 * 			is needed. If empty, the process-wide one will
+	 * 			be used.
+	 * \param	min_lifetime	The minimum remaining lifetime in
+	 * 			seconds for a shared ticket to be reused.
+	 * \return	a smart pointer to the filled credential cache.
+	 **/
+	static shared_ptr<MemoryCCache> from_keytab(
+		const string& keytab,
+		const string& client,
+		const string& realm,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>(),
+		const int min_lifetime =300
+	);
+	
+	/**
+	 * Drop all shared keytab credentials (see from_keytab()), e.g.,
+	 * after the keys were changed. Caches still used by a Context stay
+	 * valid until it is destroyed.
+	 **/
+	static void forget_keytab_credentials();
+	
+	/**
+	 * Destroys the credential cache.
+	 **/
+	virtual ~MemoryCCache();
+	
+	/**
+	 * Get the cache's full name (of form <code>MEMORY:ID</code>). Use it
+	 * to resolve the cache in other Kerberos contexts.
+	 * 
+	 * \return	the credential cache's name.
+	 **/
+	const string& name() const { return _name; }
+	
+	/**
+	 * Get the name of the principal the credentials belong to.
+	 * 
+	 * \return	the client principal's name.
+	 **/
+	const string& client() const { return _client; }
+	
+	/**
+	 * Get the time at which the stored ticket expires.
+	 * 
+	 * \return	the ticket's end time in seconds since the epoch.
+	 **/
+	const krb5_timestamp end_time() const { return _end_time; }
+
+private:
+	/**
+	 * Create an empty holder.
+	 * 
+	 * \param	krb5	The Kerberos context for cache management. If
+	 * 			empty, the process-wide one will be used.
+	 **/
+	explicit MemoryCCache(shared_ptr<Krb5Context> krb5);
+	
+	/**
+	 * Helper function to create the memory cache and store the given
+	 * credentials in it.
+	 * 
+	 * \param	creds	The credentials to store.
+	 **/
+	void store(krb5_creds* creds);
+	
+	/** Kerberos context for cache management. */
+	shared_ptr<Krb5Context> _krb5;
+	/** The memory credential cache. */
+	krb5_ccache _ccache;
+	/** Full name of the credential cache. */
+	string _name;
+	/** Name of the principal the credentials belong to. */
+	string _client;
+	/** Expiration time of the stored ticket. */
+	krb5_timestamp _end_time;
+};
+
+} /* namespace kadm5 */
+
+#endif /*MEMORYCCACHE_HPP_*/
@@ -0,0 +1,107 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <stdexcept>
+#include <boost/bind.hpp>
+
+// Kerberos
+#include <kadm5/admin.h>
+
+// Local
+#include "NameList.hpp"
+#include "Context.hpp"
+#include "Error.hpp"
+
+namespace kadm5
+{
+
+NameList::NameList(shared_ptr<const Context> handle, const string& filter)
+	:	_handle(handle),
+		_names(NULL),
+		_count(0)
+{
+	kadm5_ret_t ret = _handle->execute(
+				boost::bind(
+					kadm5_get_principals,
+					_1,
+					filter.c_str(),
+					&_names,
+					&_count
+				),
+				true
+			);
+	if (ret) {
+		// The destructor does not run if the constructor throws.
+		free_names();
+		error::throw_on_error(ret);
+	}
+}
+
+
+NameList::~NameList()
+{
+	free_names();
+}
+
+
+void NameList::free_names()
+{
+	// Must neither connect nor throw; see Context::current_handle().
+	void* ph = _handle->current_handle();
+	if (_names && ph) {
+		kadm5_free_name_list(ph, _names, &_count);
+	}
+	_names = NULL;
+	_count = 0;
+}
+
+
+const string NameList::str(const size_t i) const
+{
+	if (i >= size()) {
+		throw std::out_of_range("NameList::str()");
+	}
+	return string(_names[i]);
+}
+
+
+shared_ptr< vector<string> > NameList::strings() const
+{
+	// Treat the char** pointers as iterators.
+	return shared_ptr< vector<string> >(
+		new vector<string>(begin(), end())
+	);
+}
+
+} /* namespace kadm5 */
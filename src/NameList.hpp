@@ -0,0 +1,165 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef NAMELIST_HPP_
+#define NAMELIST_HPP_
+
+// STL and Boost
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+class Context;
+
+/**
+ * \brief
+ * The names of all principals matching a search string, fetched with a
+ * single request and kept in the buffer the KAdmin library returned.
+ * 
+ * The names are not copied: operator[]() and the iterators return
+ * pointers straight into the library's buffer, which stays valid as long
+ * as the NameList. The buffer is released exactly once, on destruction.
+ * Use str() or strings() to get owned copies.
+ * \code
+ * shared_ptr<NameList> pl = conn.list_names("host*");
+ * for (NameList::const_iterator it = pl->begin(); it != pl->end(); ++it) {
+ * 	std::cout << *it << std::endl;
+ * }
+ * \endcode
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class NameList : public boost::noncopyable
+{
+public:
+	/** Random access iterator over the names. */
+	typedef const char* const* const_iterator;
+	
+	/**
+	 * Fetches the names matching the given search string.
+	 * 
+	 * \param	handle	The Context used to access the KAdmin server.
+	 * 			Kept for releasing the names.
+	 * \param	filter	The search string against which the principal
+	 * 			names are matched.
+	 **/
+	NameList(shared_ptr<const Context> handle, const string& filter);
+	
+	/**
+	 * Destructor. Releases the names.
+	 **/
+	~NameList();
+	
+	/**
+	 * Get the number of names.
+	 * 
+	 * \return	the number of names.
+	 **/
+	const size_t size() const { return _count; }
+	
+	/**
+	 * Check whether no name matched.
+	 * 
+	 * \return	true if the list is empty.
+	 **/
+	const bool empty() const { return _count == 0; }
+	
+	/**
+	 * Get a name without copying it.
+	 * 
+	 * \param	i	The name's position; less than size().
+	 * \return	the NUL-terminated name, valid as long as the NameList.
+	 **/
+	const char* operator[](const size_t i) const { return _names[i]; }
+	
+	/**
+	 * Get an owned copy of a name.
+	 * 
+	 * \param	i	The name's position. Throws
+	 * 			<code>std::out_of_range</code> if it is not less
+	 * 			than size().
+	 * \return	the name.
+	 **/
+	const string str(const size_t i) const;
+	
+	/**
+	 * Get an iterator to the first name.
+	 * 
+	 * \return	the iterator.
+	 **/
+	const_iterator begin() const { return _names; }
+	
+	/**
+	 * Get an iterator past the last name.
+	 * 
+	 * \return	the iterator.
+	 **/
+	const_iterator end() const { return _names + _count; }
+	
+	/**
+	 * Copy all names into owned strings.
+	 * 
+	 * \return	a list of the names.
+	 **/
+	shared_ptr< vector<string> > strings() const;
+
+private:
+	/**
+	 * Helper function for the constructor and destructor: free the
+	 * names with the Context's current KAdmin handle, if any.
+	 **/
+	void free_names();
+	
+	/** The Context the names were fetched with. */
+	shared_ptr<const Context> _handle;
+	/** The names as returned by the KAdmin library. */
+	char** _names;
+	/** The number of names. */
+	int _count;
+};
+
+} /* namespace kadm5 */
+
+#endif /*NAMELIST_HPP_*/
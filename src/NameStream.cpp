@@ -0,0 +1,292 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <boost/bind.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+// Local
+#include "NameStream.hpp"
+#include "Context.hpp"
+#include "Error.hpp"
+#include "NameList.hpp"
+
+namespace kadm5
+{
+
+/**
+ * Characters that commonly follow a name prefix; each gets a partition of
+ * its own. The pattern for all others is built from PARTITION_RANGES.
+ **/
+static const char PARTITION_CHARS[] =
+	"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char PARTITION_RANGES[] = "a-zA-Z0-9";
+
+
+NameStream::NameStream(
+	shared_ptr<const Context> context,
+	const string& filter,
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	const size_t chunk_size
+#else
+	// Partitioned listing fetches whole partitions at once.
+	const size_t /* chunk_size */
+#endif
+) :
+	_context(context),
+	_globs( partition(filter) ),
+	_chunk()
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	,
+	_handle(),
+	_producer(),
+	_mutex(),
+	_readable(),
+	_writable(),
+	_queue(),
+	_capacity( std::max<size_t>(chunk_size, 1) ),
+	_received(0),
+	_finished(false),
+	_cancelled(false),
+	_result(0)
+#endif
+{
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	// The producer thread needs a connection of its own so the Context
+	// stays usable while the names are read.
+	try {
+		_handle = _context->clone();
+	}
+	catch (const error&) {
+		KADM5_DEBUG("NameStream(): No second connection; partitioning.\n");
+	}
+	
+	if (_handle) {
+		_producer.reset(
+			new boost::thread(
+				boost::bind(&NameStream::produce, this, filter)
+			)
+		);
+	}
+#endif
+}
+
+
+NameStream::~NameStream()
+{
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	if (_producer) {
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			_cancelled = true;
+		}
+		_writable.notify_all();
+		_producer->join();
+	}
+#endif
+}
+
+
+const bool NameStream::next(string& name)
+{
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	if (_producer) {
+		boost::unique_lock<boost::mutex> lock(_mutex);
+		while (_queue.empty() && !_finished) {
+			_readable.wait(lock);
+		}
+		if (!_queue.empty()) {
+			name.swap(_queue.front());
+			_queue.pop_front();
+			lock.unlock();
+			_writable.notify_one();
+			return true;
+		}
+		lock.unlock();
+		
+		// Either done, or continue with the partitions.
+		finish_producer();
+	}
+#endif
+	if (_chunk.empty() && !fetch_chunk()) {
+		return false;
+	}
+	
+	name.swap(_chunk.back());
+	_chunk.pop_back();
+	return true;
+}
+
+
+vector<string> NameStream::partition(const string& filter)
+{
+	vector<string> globs;
+	
+	// Only a literal prefix followed by a single '*' can be split
+	// without changing the results.
+	string prefix( filter, 0, filter.empty() ? 0 : filter.size() - 1 );
+	if (	filter.empty() ||
+		(filter[filter.size() - 1] != '*') ||
+		(prefix.find_first_of("*?[\\") != string::npos)
+	) {
+		globs.push_back(filter);
+		return globs;
+	}
+	
+	// Reverse order, so fetch_chunk() can pop the next one off the back.
+	globs.push_back(prefix + "[!" + PARTITION_RANGES + "]*");
+	const string chars(PARTITION_CHARS);
+	for (
+		string::const_reverse_iterator it = chars.rbegin();
+		it != chars.rend();
+		it++
+	) {
+		globs.push_back(prefix + *it + "*");
+	}
+	// All above require at least one more character. The server also
+	// matches each glob with "@REALM" appended, so the first one already
+	// covers the prefix itself unless that names a realm.
+	if (prefix.find('@') != string::npos) {
+		globs.push_back(prefix);
+	}
+	
+	return globs;
+}
+
+
+const bool NameStream::fetch_chunk()
+{
+	while (!_globs.empty()) {
+		NameList names(_context, _globs.back());
+		_globs.pop_back();
+		
+		// Reverse order, so next() can pop names off the back.
+		_chunk.assign(
+			std::reverse_iterator<NameList::const_iterator>(
+				names.end()
+			),
+			std::reverse_iterator<NameList::const_iterator>(
+				names.begin()
+			)
+		);
+		
+		if (!_chunk.empty()) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+void NameStream::produce(const string filter)
+{
+	kadm5_ret_t ret = kadm5_iter_principals(
+				*_handle,
+				filter.c_str(),
+				receive,
+				this
+			);
+	
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		// Keep a failure recorded by receive().
+		if (!_result) {
+			_result = ret;
+		}
+		_finished = true;
+	}
+	_readable.notify_all();
+}
+
+
+int NameStream::receive(void* data, const char* name)
+{
+	NameStream* ps = static_cast<NameStream*>(data);
+	
+	// Called from the library: exceptions must not escape.
+	boost::unique_lock<boost::mutex> lock(ps->_mutex);
+	while ((ps->_queue.size() >= ps->_capacity) && !ps->_cancelled) {
+		ps->_writable.wait(lock);
+	}
+	if (ps->_cancelled) {
+		return 1;
+	}
+	
+	try {
+		ps->_queue.push_back(name);
+	}
+	catch (const std::bad_alloc&) {
+		ps->_result = ENOMEM;
+		return 1;
+	}
+	ps->_received++;
+	lock.unlock();
+	
+	ps->_readable.notify_one();
+	return 0;
+}
+
+
+void NameStream::finish_producer()
+{
+	_producer->join();
+	_producer.reset();
+	_handle.reset();
+	
+	if (_result == 0) {
+		_globs.clear();
+		return;
+	}
+	
+	// Older servers do not support iteration.
+	if (_received == 0) {
+		KADM5_DEBUG("NameStream: Iteration failed; partitioning.\n");
+		return;
+	}
+	
+	// Do not start over after reporting the error.
+	_globs.clear();
+	error::throw_on_error(_result);
+}
+#endif
+
+
+} /* namespace kadm5 */
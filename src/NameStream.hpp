@@ -0,0 +1,261 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef NAMESTREAM_HPP_
+#define NAMESTREAM_HPP_
+
+// STL and Boost
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	#include <boost/thread/condition_variable.hpp>
+	#include <boost/thread/mutex.hpp>
+	#include <boost/thread/thread.hpp>
+#endif
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+class Context;
+
+/**
+ * \brief
+ * Forward-only sequence of the names of all principals matching a search
+ * string. The names are fetched from the KAdmin server in chunks while the
+ * sequence is read, so memory usage does not grow with the size of the
+ * realm.
+ * 
+ * Use next() or the input iterators returned by begin() and end():
+ * \code
+ * shared_ptr<NameStream> ps = conn.stream_principals("host*");
+ * for (NameStream::iterator it = ps->begin(); it != ps->end(); ++it) {
+ * 	std::cout << *it << std::endl;
+ * }
+ * \endcode
+ * 
+ * If the library was built with <code>HAVE_KADM5_ITER_PRINCIPALS</code>
+ * (Heimdal 7.8 or later), the names are read through the server's
+ * iteration support on a separate connection. Otherwise, or if the server
+ * does not support iteration, search strings of the form
+ * <code>prefix*</code> are split into one request per possible character
+ * following the prefix (e.g. <code>host/a*</code>, <code>host/b*</code>,
+ * ...), so a chunk holds only a fraction of all names. Other search strings
+ * are fetched in a single request.
+ * 
+ * \note
+ * The names are not sorted. A NameStream uses the Context it was created
+ * with (except for server-side iteration); do not read from it in one
+ * thread while using that Context in another.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class NameStream : public boost::noncopyable
+{
+public:
+	/**
+	 * \brief
+	 * Single-pass input iterator over the names of a NameStream.
+	 * 
+	 * Incrementing any iterator advances the underlying stream, so all
+	 * copies except the incremented one become invalid.
+	 **/
+	class iterator
+		: public boost::iterator_facade<
+			iterator,
+			const string,
+			boost::single_pass_traversal_tag
+		>
+	{
+	public:
+		/** Creates an end iterator. */
+		iterator() : _stream(NULL), _name() {}
+		
+		/**
+		 * Creates an iterator pointing to the stream's next name.
+		 * 
+		 * \param	ps	The stream to read from.
+		 **/
+		explicit iterator(NameStream* ps) : _stream(ps), _name()
+			{ increment(); }
+		
+	private:
+		friend class boost::iterator_core_access;
+		
+		void increment()
+			{ if (!_stream->next(_name)) { _stream = NULL; } }
+		const bool equal(const iterator& other) const
+			{ return _stream == other._stream; }
+		const string& dereference() const { return _name; }
+		
+		/** The underlying stream (<code>NULL</code> at the end). */
+		NameStream* _stream;
+		/** The current name. */
+		string _name;
+	};
+	
+	/**
+	 * Prepares a stream of the principal names matching the filter. The
+	 * first chunk is fetched on the first call to next().
+	 * 
+	 * \param	context	The Context used to access the KAdmin server.
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \param	chunk_size	The maximum number of names buffered
+	 * 			by server-side iteration.
+	 **/
+	NameStream(
+		shared_ptr<const Context> context,
+		const string& filter,
+		const size_t chunk_size =1024
+	);
+	
+	/**
+	 * Destructor. Aborts any server-side iteration still in progress.
+	 **/
+	~NameStream();
+	
+	/**
+	 * Get the next name of the sequence.
+	 * 
+	 * \param	name	Receives the next name. Left untouched at the
+	 * 			end of the sequence.
+	 * \return	true if a name was read; false at the end of the
+	 * 		sequence.
+	 **/
+	const bool next(string& name);
+	
+	/**
+	 * Get an iterator pointing to the next name of the sequence.
+	 * 
+	 * \return	an input iterator reading from this stream.
+	 **/
+	iterator begin() { return iterator(this); }
+	
+	/**
+	 * Get the end iterator.
+	 * 
+	 * \return	an iterator that compares equal to exhausted
+	 * 		iterators.
+	 **/
+	iterator end() { return iterator(); }
+
+private:
+	/**
+	 * Compute the search strings whose results together form the
+	 * results of the given filter (see the class description).
+	 * 
+	 * \param	filter	The search string to partition.
+	 * \return	the search strings of the partitions.
+	 **/
+	static vector<string> partition(const string& filter);
+	
+	/**
+	 * Fetch the names matching the next search string of _globs into
+	 * _chunk.
+	 * 
+	 * \return	false if all search strings have been processed.
+	 **/
+	const bool fetch_chunk();
+	
+	/** The Context used to access the KAdmin server. */
+	shared_ptr<const Context> _context;
+	/** Search strings still to be fetched (in reverse order). */
+	vector<string> _globs;
+	/** Names of the current chunk not read yet (in reverse order). */
+	vector<string> _chunk;
+
+#ifdef HAVE_KADM5_ITER_PRINCIPALS
+	/**
+	 * Thread function: runs <code>kadm5_iter_principals</code> on
+	 * _handle and stores the result code in _result.
+	 **/
+	void produce(const string filter);
+	
+	/**
+	 * Callback for <code>kadm5_iter_principals</code>: queues a name,
+	 * waiting while the queue is full.
+	 * 
+	 * \param	data	The receiving NameStream.
+	 * \param	name	The principal name.
+	 * \return	non-zero to abort the iteration.
+	 **/
+	static int receive(void* data, const char* name);
+	
+	/**
+	 * Wait for the producer thread and decide how to continue: with
+	 * the partitioned search strings if the server does not support
+	 * iteration and nothing was received; otherwise throw if the
+	 * iteration failed.
+	 **/
+	void finish_producer();
+	
+	/** Separate connection used by the producer thread. */
+	shared_ptr<Context> _handle;
+	/** Thread reading names from the server. */
+	shared_ptr<boost::thread> _producer;
+	/** Protects the members below. */
+	boost::mutex _mutex;
+	/** Signalled when names were queued or the producer finished. */
+	boost::condition_variable _readable;
+	/** Signalled when names were taken from the queue. */
+	boost::condition_variable _writable;
+	/** Names received but not read yet. */
+	std::deque<string> _queue;
+	/** Maximum size of _queue. */
+	size_t _capacity;
+	/** Number of names received so far. */
+	size_t _received;
+	/** Flag set by the producer when the iteration has ended. */
+	bool _finished;
+	/** Flag set to ask the producer to stop early. */
+	bool _cancelled;
+	/** Result code of the iteration (valid if _finished). */
+	kadm5_ret_t _result;
+#endif
+};
+
+} /* namespace kadm5 */
+
+#endif /*NAMESTREAM_HPP_*/
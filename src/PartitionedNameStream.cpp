@@ -0,0 +1,272 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <boost/bind.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+// Local
+#include "Context.hpp"
+#include "Error.hpp"
+#include "PartitionedNameStream.hpp"
+
+namespace kadm5
+{
+
+/**
+ * Characters that get a partition of their own (as in NameStream). The
+ * pattern for all others is built from PARTITION_RANGES.
+ **/
+static const char PARTITION_CHARS[] =
+	"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char PARTITION_RANGES[] = "a-zA-Z0-9";
+
+
+const bool PartitionedNameStream::HotPrefixes::contains(
+	const string& prefix
+) const {
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _prefixes.find(prefix) != _prefixes.end();
+}
+
+
+void PartitionedNameStream::HotPrefixes::insert(const string& prefix)
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	_prefixes.insert(prefix);
+}
+
+
+PartitionedNameStream::PartitionedNameStream(
+	const vector< shared_ptr<const Context> >& handles,
+	const string& filter,
+	shared_ptr<HotPrefixes> hot,
+	const size_t split_threshold
+) :
+	_hot(hot),
+	_split_threshold(split_threshold),
+	_partitions(),
+	_next_partition(0),
+	_first_pending(0),
+	_ready(),
+	_mutex(),
+	_fetched(),
+	_cancelled(false),
+	_result(0),
+	_threads()
+{
+	if (handles.empty()) {
+		error::throw_on_error(EINVAL);
+	}
+	
+	partition(filter, _hot.get(), _partitions);
+	std::stable_sort(_partitions.begin(), _partitions.end());
+	KADM5_DEBUG("PartitionedNameStream(): Partitioned '" + filter + "'\n");
+	
+	for (size_t i = 0; i < handles.size(); i++) {
+		_threads.create_thread(
+			boost::bind(&PartitionedNameStream::fetch, this, handles[i])
+		);
+	}
+}
+
+
+PartitionedNameStream::~PartitionedNameStream()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		_cancelled = true;
+	}
+	_threads.join_all();
+}
+
+
+const bool PartitionedNameStream::next(string& name)
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	for (;;) {
+		error::throw_on_error(_result);
+		
+		// Names up to the lower bound of the first pending partition
+		// cannot be preceded by names still to be fetched.
+		const bool complete = _first_pending >= _partitions.size();
+		if (!_ready.empty() && (complete ||
+			*_ready.begin() <= _partitions[_first_pending].key)
+		) {
+			name = *_ready.begin();
+			_ready.erase(_ready.begin());
+			return true;
+		}
+		if (complete) {
+			return false;
+		}
+		_fetched.wait(lock);
+	}
+}
+
+
+void PartitionedNameStream::partition(
+	const string& filter,
+	const HotPrefixes* hot,
+	vector<Partition>& partitions
+) {
+	// Only a literal prefix followed by a single '*' can be split
+	// without changing the results (see NameStream::partition()).
+	string prefix( filter, 0, filter.empty() ? 0 : filter.size() - 1 );
+	if (	filter.empty() ||
+		(filter[filter.size() - 1] != '*') ||
+		(prefix.find_first_of("*?[\\") != string::npos)
+	) {
+		Partition p = { filter, "", "", false };
+		partitions.push_back(p);
+		return;
+	}
+	
+	// All partitions below require at least one more character.
+	if (!prefix.empty()) {
+		Partition p = { prefix, prefix, "", false };
+		partitions.push_back(p);
+	}
+	partition_prefix(prefix, hot, partitions);
+}
+
+
+void PartitionedNameStream::partition_prefix(
+	const string& prefix,
+	const HotPrefixes* hot,
+	vector<Partition>& partitions
+) {
+	Partition others = {
+		prefix + "[!" + PARTITION_RANGES + "]*", prefix, "", false
+	};
+	partitions.push_back(others);
+	
+	const string chars(PARTITION_CHARS);
+	for (size_t i = 0; i < chars.size(); i++) {
+		const string longer = prefix + chars[i];
+		if (hot && hot->contains(longer)) {
+			Partition exact = { longer, longer, "", false };
+			partitions.push_back(exact);
+			partition_prefix(longer, hot, partitions);
+		}
+		else {
+			Partition p = { longer + "*", longer, longer, false };
+			partitions.push_back(p);
+		}
+	}
+}
+
+
+void PartitionedNameStream::fetch(shared_ptr<const Context> handle)
+{
+	for (;;) {
+		size_t i = 0;
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			if (_cancelled || _result ||
+				_next_partition >= _partitions.size()
+			) {
+				return;
+			}
+			i = _next_partition++;
+		}
+		// Partitions are never moved once the threads run.
+		const Partition& p = _partitions[i];
+		
+		kadm5_ret_t ret = 0;
+		char** list = NULL;
+		int count = 0;
+		try {
+			ret = handle->execute(
+				boost::bind(
+					kadm5_get_principals,
+					_1,
+					p.glob.c_str(),
+					&list,
+					&count
+				),
+				true
+			);
+			
+			if (!ret) {
+				if (_hot && !p.prefix.empty() &&
+					static_cast<size_t>(count) > _split_threshold
+				) {
+					_hot->insert(p.prefix);
+				}
+				
+				boost::lock_guard<boost::mutex> lock(_mutex);
+				_ready.insert(list, list + count);
+				_partitions[i].done = true;
+				while (_first_pending < _partitions.size() &&
+					_partitions[_first_pending].done
+				) {
+					_first_pending++;
+				}
+			}
+		}
+		catch (const error& e) {
+			ret = e.error_code() ? e.error_code() : KADM5_FAILURE;
+		}
+		catch (const std::bad_alloc&) {
+			ret = ENOMEM;
+		}
+		catch (...) {
+			ret = KADM5_FAILURE;
+		}
+		// Like ~NameList(), never reconnect just to free the names.
+		void* ph = handle->current_handle();
+		if (list && ph) {
+			kadm5_free_name_list(ph, list, &count);
+		}
+		
+		if (ret) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			if (!_result) {
+				_result = ret;
+			}
+		}
+		_fetched.notify_all();
+		if (ret) {
+			return;
+		}
+	}
+}
+
+} /* namespace kadm5 */
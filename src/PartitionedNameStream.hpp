@@ -0,0 +1,302 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef PARTITIONEDNAMESTREAM_HPP_
+#define PARTITIONEDNAMESTREAM_HPP_
+
+// STL and Boost
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+class Context;
+
+/**
+ * \brief
+ * Sorted, duplicate-free sequence of the names of all principals matching a
+ * search string, fetched concurrently over several connections.
+ * 
+ * A search string of the form <code>prefix*</code> is split into disjoint
+ * partitions by the character following the prefix (<code>prefix</code>,
+ * <code>prefixa*</code>, <code>prefixb*</code>, ..., and one pattern for
+ * all other characters), as NameStream does. Each connection fetches one
+ * partition after the other, so the server sends many small replies
+ * instead of one huge one. Partitions that turned out to match more than
+ * a threshold of names (e.g. <code>h*</code> in a realm of
+ * <code>host/</code> principals) are remembered in a HotPrefixes object;
+ * later streams sharing it split them one character further.
+ * 
+ * The names are returned in ascending (byte) order. A name is returned
+ * as soon as all partitions that could hold smaller names are complete,
+ * so reading starts before the whole listing is done.
+ * 
+ * \note
+ * Names are buffered until read; unlike NameStream, memory usage grows
+ * with the number of names. The connections are used by the stream's
+ * threads until it is exhausted or destroyed.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class PartitionedNameStream : public boost::noncopyable
+{
+public:
+	/**
+	 * \brief
+	 * Name prefixes known to match many principals, shared between
+	 * streams.
+	 **/
+	class HotPrefixes : public boost::noncopyable
+	{
+	public:
+		/**
+		 * Check whether a prefix is known to be hot.
+		 * 
+		 * \param	prefix	The prefix.
+		 * \return	true if the prefix should be split.
+		 **/
+		const bool contains(const string& prefix) const;
+		
+		/**
+		 * Remember a prefix as hot.
+		 * 
+		 * \param	prefix	The prefix.
+		 **/
+		void insert(const string& prefix);
+		
+	private:
+		/** Protects _prefixes. */
+		mutable boost::mutex _mutex;
+		/** The hot prefixes. */
+		std::set<string> _prefixes;
+	};
+	
+	/**
+	 * \brief
+	 * Single-pass input iterator over the names of a
+	 * PartitionedNameStream.
+	 * 
+	 * Incrementing any iterator advances the underlying stream, so all
+	 * copies except the incremented one become invalid.
+	 **/
+	class iterator
+		: public boost::iterator_facade<
+			iterator,
+			const string,
+			boost::single_pass_traversal_tag
+		>
+	{
+	public:
+		/** Creates an end iterator. */
+		iterator() : _stream(NULL), _name() {}
+		
+		/**
+		 * Creates an iterator pointing to the stream's next name.
+		 * 
+		 * \param	ps	The stream to read from.
+		 **/
+		explicit iterator(PartitionedNameStream* ps)
+			: _stream(ps), _name()
+			{ increment(); }
+		
+	private:
+		friend class boost::iterator_core_access;
+		
+		void increment()
+			{ if (!_stream->next(_name)) { _stream = NULL; } }
+		const bool equal(const iterator& other) const
+			{ return _stream == other._stream; }
+		const string& dereference() const { return _name; }
+		
+		/** The underlying stream (<code>NULL</code> at the end). */
+		PartitionedNameStream* _stream;
+		/** The current name. */
+		string _name;
+	};
+	
+	/**
+	 * Starts fetching the principal names matching the filter, one
+	 * thread per connection.
+	 * 
+	 * \param	handles	The connections to use; at least one.
+	 * \param	filter	The search string against which the Principal
+	 * 			names are matched.
+	 * \param	hot	Prefixes to split further; updated with the
+	 * 			partitions that exceed split_threshold. May be
+	 * 			empty.
+	 * \param	split_threshold	Number of names above which a
+	 * 			partition's prefix is considered hot.
+	 **/
+	PartitionedNameStream(
+		const vector< shared_ptr<const Context> >& handles,
+		const string& filter,
+		shared_ptr<HotPrefixes> hot =shared_ptr<HotPrefixes>(),
+		const size_t split_threshold =4096
+	);
+	
+	/**
+	 * Destructor. Waits for partitions in progress and skips the rest.
+	 **/
+	~PartitionedNameStream();
+	
+	/**
+	 * Get the next name in ascending order. Waits until it is known.
+	 * 
+	 * \param	name	Receives the next name. Left untouched at the
+	 * 			end of the sequence.
+	 * \return	true if a name was read; false at the end of the
+	 * 		sequence.
+	 **/
+	const bool next(string& name);
+	
+	/**
+	 * Get an iterator pointing to the next name of the sequence.
+	 * 
+	 * \return	an input iterator reading from this stream.
+	 **/
+	iterator begin() { return iterator(this); }
+	
+	/**
+	 * Get the end iterator.
+	 * 
+	 * \return	an iterator that compares equal to exhausted
+	 * 		iterators.
+	 **/
+	iterator end() { return iterator(); }
+	
+	/**
+	 * Get the number of partitions the search string was split into.
+	 * 
+	 * \return	the number of partitions.
+	 **/
+	const size_t partitions() const { return _partitions.size(); }
+
+private:
+	/**
+	 * \brief
+	 * One search string of the split filter.
+	 **/
+	struct Partition
+	{
+		/** The search string. */
+		string glob;
+		/** Lower bound of the matching names. */
+		string key;
+		/** Prefix to remember if too many names match; or empty. */
+		string prefix;
+		/** Whether the names have been fetched. */
+		bool done;
+		
+		/** Order by lower bound. */
+		bool operator<(const Partition& other) const
+			{ return key < other.key; }
+	};
+	
+	/**
+	 * Split a filter into partitions, recursing into hot prefixes.
+	 * 
+	 * \param	filter	The search string.
+	 * \param	hot	The hot prefixes; may be NULL.
+	 * \param	partitions	Receives the partitions.
+	 **/
+	static void partition(
+		const string& filter,
+		const HotPrefixes* hot,
+		vector<Partition>& partitions
+	);
+	
+	/**
+	 * Split the names starting with prefix (and at least one more
+	 * character) into partitions.
+	 * 
+	 * \param	prefix	The literal prefix.
+	 * \param	hot	The hot prefixes; may be NULL.
+	 * \param	partitions	Receives the partitions.
+	 **/
+	static void partition_prefix(
+		const string& prefix,
+		const HotPrefixes* hot,
+		vector<Partition>& partitions
+	);
+	
+	/**
+	 * Thread function: fetch partitions on the given connection until
+	 * none are left.
+	 * 
+	 * \param	handle	The connection to use.
+	 **/
+	void fetch(shared_ptr<const Context> handle);
+	
+	/** Remembered hot prefixes (may be empty). */
+	shared_ptr<HotPrefixes> _hot;
+	/** Number of names making a partition's prefix hot. */
+	size_t _split_threshold;
+	/** The partitions, ordered by their lower bounds. */
+	vector<Partition> _partitions;
+	/** Index of the next partition to fetch. */
+	size_t _next_partition;
+	/** Index of the first partition not fetched yet. */
+	size_t _first_pending;
+	/** Fetched names not read yet. */
+	std::set<string> _ready;
+	/** Protects the members above and below. */
+	boost::mutex _mutex;
+	/** Signalled when a partition was fetched. */
+	boost::condition_variable _fetched;
+	/** Flag set to make the threads stop early. */
+	bool _cancelled;
+	/** First error of a thread; 0 if none. */
+	kadm5_ret_t _result;
+	/** The fetching threads. */
+	boost::thread_group _threads;
+};
+
+} /* namespace kadm5 */
+
+#endif /*PARTITIONEDNAMESTREAM_HPP_*/
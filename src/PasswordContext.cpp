@@ -32,54 +32,154 @@
 
 
 // STL and Boost
+#include <ctime>
 #include <string>
 
 // Kerberos
 #include <kadm5/admin.h>
 
 // Local
+#include "MemoryCCache.hpp"
 #include "PasswordContext.hpp"
 #include "Error.hpp"
 
 namespace kadm5
 {
 
+/**
+ * Fetch a new ticket if the current one expires within this many seconds;
+ * a reconnect should not fail right after it succeeded.
+ **/
+static const int MIN_CREDENTIALS_LIFETIME = 300;
+
+
 PasswordContext::PasswordContext(
 	const string& password,
 	const string& client,
 	const string& realm,
 	const string& host,
-	const int port
-)	:	Context(client, realm, host, port)
+	const int port,
+	const bool lazy,
+	shared_ptr<Krb5Context> krb5
+)	:	CCacheContext(
+			shared_ptr<MemoryCCache>(),
+			client,
+			realm,
+			host,
+			port,
+			lazy,
+			krb5
+		),
+		_password( new SecureBuffer(password.length() + 1) ),
+		_client(client),
+		_realm(realm)
 {
-	if (password.empty()) {
-		throw bad_pw(KADM5_BAD_PASSWORD);
+	// The buffer comes zeroed, so the terminating NUL is in place.
+	password.copy(_password->data(), string::npos);
+	
+	if (lazy) {
+		return;
+	}
+	check_connection();
+}
+
+
+PasswordContext::PasswordContext(
+	shared_ptr<SecureBuffer> password,
+	shared_ptr<MemoryCCache> credentials,
+	const string& client,
+	const string& realm,
+	const string& host,
+	const int port,
+	const bool lazy,
+	shared_ptr<Krb5Context> krb5
+)	:	CCacheContext(
+			shared_ptr<MemoryCCache>(),
+			client,
+			realm,
+			host,
+			port,
+			lazy,
+			krb5
+		),
+		_password(password),
+		_client(client),
+		_realm(realm)
+{
+	if (credentials) {
+		use_credentials(credentials);
 	}
 	
-	// FIXME This is buggy in Heimdal. If password is correct, the
-	// the libraries will prompt for the password a second time(!).
-	// If the password was wrong, a bad_pw exception will be thrown
-	// immediately.
-	void* ph = NULL;
-	error::throw_on_error(
-		kadm5_init_with_password_ctx(
-			*this,
-			client.empty() ? NULL : client.c_str(),
-			password.c_str(),
-			KADM5_ADMIN_SERVICE,
-			config_params().get(),
-			KADM5_STRUCT_VERSION,
-			KADM5_API_VERSION_2,
-			&ph
-		)
-	);
-	set_kadm_handle( shared_ptr<void>(ph, kadm5_destroy) );
+	if (lazy) {
+		return;
+	}
+	check_connection();
+}
+
+
+void PasswordContext::check_connection()
+{
+	// The base class cannot connect since it lacks the credentials.
+	establish_handle();
 	
-	// Check connection.
+	// Check connection. Keep the result; Connection caches it.
 	u_int32_t p;
 	error::throw_on_error(
 		kadm5_get_privs(*this, &p)
 	);
+	set_initial_privileges(p);
+}
+
+
+void PasswordContext::open_handle()
+{
+	// Service tickets cannot be renewed without a ticket granting
+	// ticket; simply fetch a new one.
+	shared_ptr<MemoryCCache> pcreds = credentials();
+	if (!pcreds ||
+		pcreds->end_time() - time(NULL) <= MIN_CREDENTIALS_LIFETIME
+	) {
+		KADM5_DEBUG("PasswordContext: Fetching new credentials\n");
+		use_credentials(
+			MemoryCCache::from_password(
+				_password->data(), _client, _realm, krb5()
+			)
+		);
+	}
+	CCacheContext::open_handle();
+}
+
+
+shared_ptr<Context> PasswordContext::clone() const
+{
+	// See CCacheContext::clone(). Reconnecting also renews the
+	// credentials.
+	string host;
+	int port = 0;
+	shared_ptr<MemoryCCache> pcreds;
+	{
+		boost::mutex::scoped_lock lock(handle_mutex());
+		shared_ptr<kadm5_config_params> pp = config_params();
+		host = pp->admin_server ? pp->admin_server : "";
+		port = (pp->mask & KADM5_CONFIG_KADMIND_PORT) ?
+				pp->kadmind_port : 0;
+		pcreds = credentials();
+	}
+	
+	shared_ptr<PasswordContext> pclone(
+		new PasswordContext(
+			_password,
+			pcreds,
+			_client,
+			_realm,
+			host,
+			port,
+			lazy(),
+			krb5()
+		)
+	);
+	pclone->inherit_failover(*this);
+	return pclone;
 }
 
 } /* namespace kadm5 */
@@ -38,7 +38,8 @@
 #include <string>
 
 // Local
-#include "Context.hpp"
+#include "CCacheContext.hpp"
+#include "SecureBuffer.hpp"
 
 namespace kadm5
 {
@@ -49,9 +50,14 @@ using std::string;
  * \brief
  * Kerberos and KAdmin Context using password authentication.
  * 
+ * The password fetches a KAdmin service ticket into a MemoryCCache, which
+ * clones of this Context connect with as well. It is kept in a SecureBuffer
+ * so that a new ticket can be fetched when reconnecting or cloning after
+ * the current one expired.
+ * 
  * \author Peter Dinges <pdinges@acm.org>
  **/
-class PasswordContext : public Context
+class PasswordContext : public CCacheContext
 {
 public:
 	/**
@@ -72,14 +78,65 @@ public:
 	 * \param	port	The KAdmin server's port number.
 	 * 			If <code>0</code>, uses the libraries' default
 	 * 			port number.
+	 * \param	lazy	If true, fetch the ticket and connect to the
+	 * 			KAdmin server on the first use of the KAdmin
+	 * 			handle instead of now.
+	 * \param	krb5	The Kerberos context to use. If empty, the
+	 * 			process-wide one will be used.
 	 **/
 	explicit PasswordContext(
 		const string& password,
 		const string& client,
 		const string& realm,
 		const string& host,
-		const int port
+		const int port,
+		const bool lazy =false,
+		shared_ptr<Krb5Context> krb5 =shared_ptr<Krb5Context>()
 	);
+	
+	/**
+	 * Open another connection with the same password, reusing the
+	 * current ticket while it is valid.
+	 * 
+	 * \return	a smart pointer to the new PasswordContext.
+	 **/
+	virtual shared_ptr<Context> clone() const;
+
+protected:
+	/**
+	 * Fetch a new ticket if there is none or it is about to expire,
+	 * then connect (see CCacheContext::open_handle()).
+	 **/
+	virtual void open_handle();
+
+private:
+	/**
+	 * Constructor for clone(): share the original's password and
+	 * credentials.
+	 **/
+	explicit PasswordContext(
+		shared_ptr<SecureBuffer> password,
+		shared_ptr<MemoryCCache> credentials,
+		const string& client,
+		const string& realm,
+		const string& host,
+		const int port,
+		const bool lazy,
+		shared_ptr<Krb5Context> krb5
+	);
+	
+	/**
+	 * Helper function for the constructors: check the connection and
+	 * remember the initial privileges.
+	 **/
+	void check_connection();
+	
+	/** The password as a NUL-terminated string. */
+	shared_ptr<SecureBuffer> _password;
+	/** The client as passed to the constructor. */
+	string _client;
+	/** The realm as passed to the constructor. */
+	string _realm;
 };
 
 } /* namespace kadm5 */
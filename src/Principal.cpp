@@ -32,10 +32,10 @@
 
 
 // STL and Boost
+#include <cstdlib>
 #include <cstring>
 #include <boost/bind.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
-#include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
 
 // Kerberos
@@ -43,17 +43,41 @@
 
 // Local
 #include "Principal.hpp"
+#include "Context.hpp"
 #include "Error.hpp"
+#include "RecordCache.hpp"
 
 namespace kadm5
 {
 
 using boost::posix_time::ptime;
 using boost::posix_time::time_duration;
-using boost::shared_array;
 using boost::shared_ptr;
 using std::string;
 
+/*
+ * Deleters for a Principal's own name and record. They refer to the
+ * Context by plain pointer: Principal::_context is declared first and so
+ * outlives _id and _data, and a smart pointer copy in every deleter would
+ * cost two more reference counts per Principal.
+ */
+static void release_name(const Context* pc, krb5_principal pp)
+{
+	krb5_free_principal(*pc, pp);
+}
+
+
+static void release_entry(const Context* pc, kadm5_principal_ent_t pe)
+{
+	// Frees only the members, not the structure itself. Never connect
+	// just to free memory; without a handle, the members are left.
+	void* ph = pc->current_handle();
+	if (ph) {
+		kadm5_free_principal_ent(ph, pe);
+	}
+	delete pe;
+}
+
 
 Principal::Principal(
 	shared_ptr<Context> context,
@@ -61,20 +85,30 @@ Principal::Principal(
 	const string& password
 ) :
 	_context(context),
-	_id( parse_name(_context, id) ),
-	_data(
-		shared_ptr<kadm5_principal_ent_rec>(
-			new kadm5_principal_ent_rec,
-			boost::bind(delete_kadm5_principal_ent, _context, _1)
-		)
-	),
-	_password(NULL),
-	_loaded(false),
+	_id(),
+	_data(),
+	_password(),
+	_random_keys(false),
+	_loaded_mask(0),
 	_exists(false),
 	_modified_mask(0)
 {
 	KADM5_DEBUG("Principal(): Constructing...\n");
 
+	krb5_principal ptmp = NULL;
+	error::throw_on_error(
+		krb5_parse_name(
+			*_context,
+			_context->qualified_name(id).c_str(),
+			&ptmp
+		)
+	);
+	_id.reset(ptmp, boost::bind(release_name, _context.get(), _1));
+	
+	_data.reset(
+		new kadm5_principal_ent_rec,
+		boost::bind(release_entry, _context.get(), _1)
+	);
 	memset(_data.get(), 0, sizeof(kadm5_principal_ent_rec));	
 	_data->principal = _id.get();
 	
@@ -86,35 +120,102 @@ Principal::Principal(
 
 Principal::Principal(const Principal& p)
 	:	_context(p._context),
-		_data( copy_kadm5_principal_ent(_context, p._data.get()) ),
+		_id(),
+		_data(),
 		_password(p._password),
-		_loaded(p._loaded),
+		_random_keys(p._random_keys),
+		_loaded_mask(p._loaded_mask),
 		_exists(p._exists),
 		_modified_mask(p._modified_mask)
 {
 	KADM5_DEBUG("Principal(const Principal&)\n");
 
+	kadm5_principal_ent_t pent = new kadm5_principal_ent_rec;
+	memset(pent, 0, sizeof(kadm5_principal_ent_rec));
+	_data.reset(pent, boost::bind(release_entry, _context.get(), _1));
+	
+	// Copies everything but the name, keys and tagged data; Principal
+	// never loads the latter two.
+	copy_kadm5_principal_ent_fields(*_context, pent, p._data.get(), ~0);
+	error::throw_on_error(
+		krb5_copy_principal(
+			*_context, p._data->principal, &pent->principal
+		)
+	);
+
 	if (p._data->principal == p._id.get()) {
+		// Owned by _data; see ~Principal().
 		_id.reset(
-			_data->principal,
-			boost::bind(delete_krb5_principal, _context, _1)
+			pent->principal,
+			boost::bind(release_name, _context.get(), _1)
 		);
 	}
 	else {
 		krb5_principal ptmp = NULL;
-		krb5_copy_principal(*_context, p._id.get(), &ptmp);
+		error::throw_on_error(
+			krb5_copy_principal(*_context, p._id.get(), &ptmp)
+		);
 		_id.reset(
 			ptmp,
-			boost::bind(delete_krb5_principal, _context, _1)
+			boost::bind(release_name, _context.get(), _1)
 		);
 	}
 }
 
 
+Principal& Principal::operator=(const Principal& p)
+{
+	// Copy first so *this stays untouched if copying fails.
+	Principal tmp(p);
+	swap(tmp);
+	return *this;
+}
+
+
+#if __cplusplus >= 201103L
+Principal::Principal(Principal&& p) noexcept
+	:	_context(),
+		_id(),
+		_data(),
+		_password(),
+		_random_keys(false),
+		_loaded_mask(0),
+		_exists(false),
+		_modified_mask(0)
+{
+	// Leaves p without data; see ~Principal().
+	swap(p);
+}
+
+
+Principal& Principal::operator=(Principal&& p) noexcept
+{
+	swap(p);
+	return *this;
+}
+#endif
+
+
+void Principal::swap(Principal& p)
+{
+	// The deleters of _id and _data refer to _context, which moves
+	// along with them.
+	_context.swap(p._context);
+	_id.swap(p._id);
+	_data.swap(p._data);
+	_password.swap(p._password);
+	std::swap(_random_keys, p._random_keys);
+	std::swap(_loaded_mask, p._loaded_mask);
+	std::swap(_exists, p._exists);
+	std::swap(_modified_mask, p._modified_mask);
+}
+
+
 Principal::~Principal()
 {
-	// Prevent double-deletion if both point to the same data.
-	if (_data->principal == _id.get()) {
+	// Prevent double-deletion if both point to the same data. Moved-from
+	// Principals have no data.
+	if (_data && _data->principal == _id.get()) {
 		_data->principal = NULL;
 	}
 	wipe(_password);
@@ -130,7 +231,8 @@ const string Principal::id() const
 
 const bool Principal::exists_on_server() const
 {
-	load();
+	// Fetching the name alone suffices to check for the entry.
+	load(*_context, KADM5_PRINCIPAL);
 	return _exists;
 }
 
@@ -145,24 +247,83 @@ const bool Principal::modified() const
 
 void Principal::commit_modifications()
 {
-	if (!exists_on_server()) {
-		apply_create();
+	commit(*_context);
+}
+
+
+const Principal::CommitPlan Principal::plan_commit() const
+{
+	return plan_commit(*_context);
+}
+
+
+void Principal::commit(const Context& handle)
+{
+	CommitPlan plan = plan_commit(handle);
+	
+	if (plan.create) {
+		apply_create(handle, plan);
 	}
 	
-	if (_password.get()) {
-		apply_password();
+	if (plan.change_password) {
+		apply_password(handle);
+	}
+	
+	if (plan.randomize_keys) {
+		apply_randkey(handle);
 	}
 	
-	if (_modified_mask & KADM5_PRINCIPAL) {
-		apply_rename();
+	if (plan.rename) {
+		apply_rename(handle);
 	}
 	
-	if (_modified_mask & (~KADM5_PRINCIPAL)) {
-		apply_modify();
+	if (plan.modify_mask) {
+		apply_modify(handle);
 	}
 }
 
 
+const Principal::CommitPlan Principal::plan_commit(const Context& handle) const
+{
+	CommitPlan plan;
+	plan.probed = !(_loaded_mask & KADM5_PRINCIPAL);
+	load(handle, KADM5_PRINCIPAL);
+	plan.create = !_exists;
+	plan.create_mask = 0;
+	plan.change_password = false;
+	plan.randomize_keys = _random_keys;
+	plan.rename = false;
+	
+	if (plan.create) {
+		// The new name and the password are part of the creation.
+		plan.create_mask = (_modified_mask | KADM5_PRINCIPAL) &
+					(~forbidden_create_flags);
+		// Only attributes that may not be set on creation need
+		// another request.
+		plan.modify_mask = _modified_mask &
+					(~forbidden_modify_flags) &
+					(~plan.create_mask);
+		
+		// Without a password, the entry is created locked and gets
+		// random keys; the final modification unlocks it.
+		if (!_password.get()) {
+			plan.randomize_keys = true;
+		}
+		if (plan.randomize_keys) {
+			plan.create_mask |= KADM5_ATTRIBUTES;
+			plan.modify_mask |= KADM5_ATTRIBUTES;
+		}
+	}
+	else {
+		plan.change_password = (_password.get() != NULL);
+		plan.rename = ((_modified_mask & KADM5_PRINCIPAL) != 0);
+		plan.modify_mask = _modified_mask & (~forbidden_modify_flags);
+	}
+	
+	return plan;
+}
+
+
 const string Principal::name() const
 {
 	return unparse_name(_context, _data->principal);
@@ -174,7 +335,11 @@ void Principal::set_name(const string& name)
 	// Provide best exception safety here
 	krb5_principal pnew = NULL;
 	error::throw_on_error(
-		krb5_parse_name(*_context, name.c_str(), &pnew)
+		krb5_parse_name(
+			*_context,
+			_context->qualified_name(name).c_str(),
+			&pnew
+		)
 	);
 	
 	krb5_principal ptmp = _data->principal;
@@ -189,24 +354,33 @@ void Principal::set_name(const string& name)
 
 void Principal::set_password(const string& password)
 {
-	shared_array<char> tmp( new char[password.length() + 1] );
-	password.copy(tmp.get(), string::npos);
-	tmp[password.length()] = 0;
-
-	_password.swap(tmp);
-	wipe(tmp);
+	// The buffer comes zeroed, so the terminating NUL is in place.
+	shared_ptr<SecureBuffer> tmp(
+		new SecureBuffer(password.length() + 1)
+	);
+	password.copy(tmp->data(), string::npos);
+	adopt_password(tmp);
 }
 
 
 void Principal::randomize_password(const vector<CharClass>& ccl)
 {
-	set_password(random_password(ccl));
+	// Never let the password pass through a string.
+	shared_ptr<SecureBuffer> tmp( random_secure_password(ccl) );
+	adopt_password(tmp);
+}
+
+
+void Principal::randomize_keys()
+{
+	wipe(_password);
+	_random_keys = true;
 }
 
 
 const ptime Principal::expire_time() const
 {
-	load();
+	require(KADM5_PRINC_EXPIRE_TIME);
 	if (_data->princ_expire_time > 0) {
 		return boost::posix_time::from_time_t(_data->princ_expire_time);
 	}
@@ -237,7 +411,7 @@ void Principal::set_expire_time(const ptime& t)
 
 const ptime Principal::last_password_change() const
 {
-	load();
+	require(KADM5_LAST_PWD_CHANGE);
 	if (_data->last_pwd_change > 0) {
 		return boost::posix_time::from_time_t(_data->last_pwd_change);
 	}
@@ -249,7 +423,7 @@ const ptime Principal::last_password_change() const
 
 const ptime Principal::password_expiration() const
 {
-	load();
+	require(KADM5_PW_EXPIRATION);
 	if (_data->pw_expiration > 0) {
 		return boost::posix_time::from_time_t(_data->pw_expiration);
 	}
@@ -280,7 +454,7 @@ void Principal::set_password_expiration(const ptime& t)
 
 const time_duration Principal::max_lifetime() const
 {
-	load();
+	require(KADM5_MAX_LIFE);
 	if (_data->max_life > 0) {
 		return boost::posix_time::seconds(_data->max_life);
 	}
@@ -309,7 +483,7 @@ void Principal::set_max_lifetime(const time_duration& d)
 
 const time_duration Principal::max_renewable_lifetime() const
 {
-	load();
+	require(KADM5_MAX_RLIFE);
 	if (_data->max_renewable_life > 0) {
 		return boost::posix_time::seconds(_data->max_renewable_life);
 	}
@@ -338,7 +512,7 @@ void Principal::set_max_renewable_lifetime(const time_duration& d)
 
 shared_ptr<Principal> Principal::modifier() const
 {
-	load();
+	require(KADM5_MOD_NAME);
 	return shared_ptr<Principal>(
 		new Principal(
 			_context,
@@ -352,7 +526,7 @@ shared_ptr<Principal> Principal::modifier() const
 
 const ptime Principal::modify_time() const
 {
-	load();
+	require(KADM5_MOD_TIME);
 	if (_data->mod_date > 0) {
 		return boost::posix_time::from_time_t(_data->mod_date);
 	}
@@ -364,7 +538,7 @@ const ptime Principal::modify_time() const
 
 const ptime Principal::last_success() const
 {
-	load();
+	require(KADM5_LAST_SUCCESS);
 	if (_data->last_success > 0) {
 		return boost::posix_time::from_time_t(_data->last_success);
 	}
@@ -376,7 +550,7 @@ const ptime Principal::last_success() const
 
 const ptime Principal::last_failed() const
 {
-	load();
+	require(KADM5_LAST_FAILED);
 	if (_data->last_failed > 0) {
 		return boost::posix_time::from_time_t(_data->last_failed);
 	}
@@ -386,129 +560,296 @@ const ptime Principal::last_failed() const
 }
 
 
-void Principal::load() const
+void Principal::load(const u_int32_t fields) const
 {
-	if (_loaded) {
+	load(*_context, fields);
+}
+
+
+void Principal::load(const Context& handle, const u_int32_t fields) const
+{
+	// Never overwrite changed attributes, and don't fetch twice.
+	u_int32_t missing = fields & ~(_loaded_mask | _modified_mask);
+	if ((_loaded_mask & KADM5_PRINCIPAL) && !missing) {
 		return;
 	}
 
-	// Load everything except the modified entries.
-	// Exception: We _must_ load the principal entry so back it up
-	// and restore afterwards.
-	krb5_principal ptmp = NULL;
-	krb5_principal pbackup = _data->principal;
-	_data->principal = NULL;
+	// Creating a Principal usually checks that it does not exist yet;
+	// in that case there is no need to ask the server again.
+	if ((_loaded_mask & KADM5_PRINCIPAL) && !_exists) {
+		load_defaults(handle, missing);
+		return;
+	}
 
 	try {
-		error::throw_on_error(
-			kadm5_get_principal(
-				*_context,
-				_id.get(),
-				_data.get(),
-				(~_modified_mask) | KADM5_PRINCIPAL
-			)
-		);
-		KADM5_DEBUG("Principal::load(): Fetched data from server.\n");
-
-		_exists = true;
+		load_existing(handle, missing);
 	}
 	catch (unknown_principal) {
-		KADM5_DEBUG("Principal::load(): Fetching default values.\n");
+		load_defaults(handle, missing);
+	}
+}
 
-		// Load defaults then (== get default principal)
-		// pbackup always points to the right krb5_principal, even
-		// if name and realm were changed.
-		
-		// krb5_princ_realm() returns a pointer inside pbackup, so
-		// omit deletion.
-		krb5_realm* prealm = krb5_princ_realm(*_context, pbackup);
 
+void Principal::load_defaults(
+	const Context& handle,
+	const u_int32_t fields
+) const
+{
+	// Only checking for existence needs no template.
+	if (!(fields & ~KADM5_PRINCIPAL)) {
+		_loaded_mask |= KADM5_PRINCIPAL;
+		_exists = false;
+		return;
+	}
+	
+	KADM5_DEBUG("Principal::load_defaults(): Copying template values.\n");
+
+	// _data->principal always points to the right krb5_principal,
+	// even if name and realm were changed.
+	
+	// krb5_princ_realm() returns a pointer inside the principal,
+	// so omit deletion.
+	krb5_realm* prealm = krb5_princ_realm(handle, _data->principal);
+	shared_ptr<const kadm5_principal_ent_rec> ptemplate(
+		handle.default_template(*prealm)
+	);
+	
+	// Copy into a scratch structure first so _data remains untouched
+	// if copying fails. Use the handle's Kerberos context throughout;
+	// the Principal's own one might be busy in another thread.
+	kadm5_principal_ent_rec ent;
+	memset(&ent, 0, sizeof(kadm5_principal_ent_rec));
+	try {
+		copy_kadm5_principal_ent_fields(handle, &ent, ptemplate.get(), fields);
+	}
+	catch (...) {
+		kadm5_free_principal_ent(handle, &ent);
+		throw;
+	}
+	
+	swap_kadm5_principal_ent_fields(_data.get(), &ent, fields);
+	kadm5_free_principal_ent(handle, &ent);
+	
+	_loaded_mask |= fields | KADM5_PRINCIPAL;
+	_exists = false;
+}
+
+
+void Principal::load_existing(
+	const Context& handle,
+	const u_int32_t fields
+) const
+{
+	fetch(handle, _id.get(), fields & ~_modified_mask);
+	KADM5_DEBUG("Principal::load_existing(): Fetched data from server.\n");
+
+	_exists = true;
+}
+
+
+void Principal::require(const u_int32_t field) const
+{
+	// Changed attributes need not be loaded at all. For the others,
+	// fetch everything still missing in one go; most callers access
+	// several attributes.
+	if (!((_loaded_mask | _modified_mask) & field)) {
+		load(*_context, default_fields);
+	}
+}
+
+
+const bool Principal::probe() const
+{
+	kadm5_principal_ent_rec ent;
+	memset(&ent, 0, sizeof(kadm5_principal_ent_rec));
+	
+	kadm5_ret_t ret = _context->execute(
+				boost::bind(
+					kadm5_get_principal,
+					_1,
+					_id.get(),
+					&ent,
+					KADM5_PRINCIPAL
+				),
+				true
+			);
+	if (ret == KADM5_UNK_PRINC) {
+		// Remember the result so load() uses the template right away.
+		_exists = false;
+		_loaded_mask |= KADM5_PRINCIPAL;
+		return false;
+	}
+	error::throw_on_error(ret);
+	
+	// Frees only the members, not the (stack allocated) structure.
+	kadm5_free_principal_ent(*_context, &ent);
+	_exists = true;
+	_loaded_mask |= KADM5_PRINCIPAL;
+	return true;
+}
+
+
+void Principal::fetch(
+	const Context& handle,
+	krb5_principal pid,
+	const u_int32_t fields
+) const
+{
+	// Fetch into a scratch structure since the libraries overwrite
+	// all members; then move over the requested ones. This also keeps
+	// _data->principal (which may hold a new name) intact.
+	kadm5_principal_ent_rec ent;
+	memset(&ent, 0, sizeof(kadm5_principal_ent_rec));
+	
+	shared_ptr<RecordCache> pcache = handle.record_cache();
+	if (!pcache || !pcache->lookup(pid, &ent, fields)) {
 		error::throw_on_error(
-			krb5_make_principal(
-				*_context,
-				&ptmp,
-				*prealm,
-				"default",
-				NULL
+			handle.execute(
+				boost::bind(
+					kadm5_get_principal,
+					_1,
+					pid,
+					&ent,
+					fields | KADM5_PRINCIPAL
+				),
+				true
 			)
 		);
-		shared_ptr<krb5_principal_data> pdefault(
-			ptmp, boost::bind(delete_krb5_principal, _context, _1)
-		);
 		
-		error::throw_on_error(
-			kadm5_get_principal(
-				*_context,
-				pdefault.get(),
-				_data.get(),
-				(~_modified_mask) | KADM5_PRINCIPAL
-			)
-		);
+		if (pcache) {
+			try {
+				pcache->store(pid, &ent, fields);
+			}
+			catch (...) {
+				kadm5_free_principal_ent(handle, &ent);
+				throw;
+			}
+		}
 	}
 	
-	ptmp = _data->principal;
-	_data->principal = pbackup;
-	_loaded = true;
+	// The scratch structure receives the replaced members and frees
+	// them afterwards (together with its principal).
+	swap_kadm5_principal_ent_fields(_data.get(), &ent, fields);
+	kadm5_free_principal_ent(handle, &ent);
 	
-	delete_krb5_principal(_context, ptmp);
+	_loaded_mask |= fields | KADM5_PRINCIPAL;
 }
 
 
-void Principal::apply_create()
+void Principal::apply_create(const Context& handle, const CommitPlan& plan)
 {
 	KADM5_DEBUG("Principal::apply_create()\n");
 
-	if (!_password.get()) {
+	krb5_flags attributes = _data->attributes;
+	if (plan.randomize_keys) {
+		// Creation requires a password. Use a throw-away one and keep
+		// the entry locked until it has its random keys. The final
+		// attributes are the changed or the default ones.
+		load(handle, KADM5_ATTRIBUTES);
+		attributes = _data->attributes;
+		_data->attributes |= KRB5_KDB_DISALLOW_ALL_TIX;
+		
 		randomize_password();
+		_random_keys = true;
 	}
 	
-	error::throw_on_error(
-		kadm5_create_principal(
-			*_context,
-			_data.get(),
-			(_modified_mask | KADM5_PRINCIPAL) &
-				(~forbidden_create_flags),
-			_password.get()
-		)
-	);
+	kadm5_ret_t ret = handle.execute(
+				boost::bind(
+					kadm5_create_principal,
+					_1,
+					_data.get(),
+					plan.create_mask,
+					_password->data()
+				),
+				false
+			);
+	_data->attributes = attributes;
+	error::throw_on_error(ret);
 	
-	// _id and _data->principal might point to the same object but reset()
-	// handles this, so nothing is destroyed accidentaly.
-	_id.reset(
-		_data->principal, boost::bind(delete_krb5_principal, _context, _1)
-	);
+	adopt_name();
+	invalidate_cached(handle, _id.get());
 	
-	_modified_mask = 0;
+	_modified_mask &= ~(plan.create_mask | KADM5_PRINCIPAL);
+	if (plan.randomize_keys) {
+		// Unlock the entry once its keys were replaced.
+		_modified_mask |= KADM5_ATTRIBUTES;
+	}
 	_exists = true;
-	// As we don't know the default values for omitted fields.
-	_loaded = false;
+	// As we don't know the default values for omitted fields (but
+	// existence is known now).
+	_loaded_mask = KADM5_PRINCIPAL;
 	
 	wipe(_password);
 }
 
 
-void Principal::apply_rename()
+void Principal::apply_randkey(const Context& handle)
+{
+	KADM5_DEBUG("Principal::apply_randkey()\n");
+
+	krb5_keyblock* pkeys = NULL;
+	int n_keys = 0;
+	error::throw_on_error(
+		handle.execute(
+			boost::bind(
+				kadm5_randkey_principal,
+				_1,
+				_id.get(),
+				&pkeys,
+				&n_keys
+			),
+			false
+		)
+	);
+	
+	// The new keys are of no use here; erase them right away.
+	for (int i = 0; i < n_keys; i++) {
+		krb5_free_keyblock_contents(handle, &pkeys[i]);
+	}
+	free(pkeys);
+	
+	invalidate_cached(handle, _id.get());
+	_random_keys = false;
+}
+
+
+void Principal::apply_rename(const Context& handle)
 {
 	KADM5_DEBUG("Principal::apply_rename()\n");
 
 	error::throw_on_error(
-		kadm5_rename_principal(
-			*_context,
-			_id.get(),
-			_data->principal
+		handle.execute(
+			boost::bind(
+				kadm5_rename_principal,
+				_1,
+				_id.get(),
+				_data->principal
+			),
+			false
 		)
 	);
+	invalidate_cached(handle, _id.get());
+	invalidate_cached(handle, _data->principal);
 	
 	_modified_mask &= ~KADM5_PRINCIPAL;
-	// _id and _data->principal might point to the same object but reset()
-	// handles this, so nothing is destroyed accidentaly.
-	_id.reset(
-		_data->principal, boost::bind(delete_krb5_principal, _context, _1)
-	);
+	adopt_name();
+}
+
+
+void Principal::adopt_name()
+{
+	// Unless they already are the same object: reset() would free the
+	// name through the old deleter while _data still points to it.
+	if (_id.get() != _data->principal) {
+		_id.reset(
+			_data->principal,
+			boost::bind(release_name, _context.get(), _1)
+		);
+	}
 }
 
 
-void Principal::apply_modify() const
+void Principal::apply_modify(const Context& handle) const
 {
 	KADM5_DEBUG("Principal::apply_modify()\n");
 
@@ -517,31 +858,42 @@ void Principal::apply_modify() const
 	_data->principal = _id.get();
 	
 	error::throw_on_error(
-		kadm5_modify_principal(
-			*_context,
-			_data.get(),
-			_modified_mask & (~forbidden_modify_flags)
+		handle.execute(
+			boost::bind(
+				kadm5_modify_principal,
+				_1,
+				_data.get(),
+				_modified_mask & (~forbidden_modify_flags)
+			),
+			true
 		)
 	);
 	
 	_data->principal = ptmp;
 	_modified_mask &= forbidden_modify_flags;
+	invalidate_cached(handle, _id.get());
 }
 
 
-void Principal::apply_password() const
+void Principal::apply_password(const Context& handle) const
 {
 	if (_password.get()) {
 		KADM5_DEBUG(
 			"Principal::apply_password(): Changing password.\n"
 		);
 		error::throw_on_error(
-			kadm5_chpass_principal(
-				*_context,
-				_id.get(),
-				_password.get()
+			handle.execute(
+				boost::bind(
+					kadm5_chpass_principal,
+					_1,
+					_id.get(),
+					_password->data()
+				),
+				false
 			)
 		);
+		// The key version and password dates have changed.
+		invalidate_cached(handle, _id.get());
 		
 		// Wipe password immediately from memory.
 		wipe(_password);
@@ -549,15 +901,49 @@ void Principal::apply_password() const
 }
 
 
-void Principal::wipe(shared_array<char>& cstr) const
+void Principal::mark_existing() const
+{
+	_exists = true;
+	_loaded_mask |= KADM5_PRINCIPAL;
+}
+
+
+void Principal::mark_absent() const
+{
+	_exists = false;
+	_loaded_mask |= KADM5_PRINCIPAL;
+}
+
+
+void Principal::invalidate_cached(
+	const Context& handle,
+	krb5_const_principal pp
+) const
+{
+	shared_ptr<RecordCache> pcache = handle.record_cache();
+	if (pcache) {
+		pcache->invalidate(pp);
+	}
+}
+
+
+void Principal::adopt_password(shared_ptr<SecureBuffer>& password)
+{
+	_password.swap(password);
+	wipe(password);
+	_random_keys = false;
+}
+
+
+void Principal::wipe(shared_ptr<SecureBuffer>& buffer) const
 {
-	if (cstr.get() && cstr.unique()) {
+	if (buffer.get() && buffer.unique()) {
 		KADM5_DEBUG(
 			"Principal::wipe(): Wiping password from memory.\n"
 		);
-		memset(cstr.get(), 0, strlen(cstr.get()));
 	}
-	cstr.reset();
+	// The last reference wipes the buffer on destruction.
+	buffer.reset();
 }
 
 }
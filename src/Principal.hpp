@@ -35,24 +35,30 @@
 #define PRINCIPAL_H_
 
 // STL and Boost
+#include <algorithm>
 #include <string>
+#include <vector>
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
 
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
 // Local
 #include "RandomPassword.hpp"
-#include "Connection.hpp"
+#include "SecureBuffer.hpp"
 
 namespace kadm5
 {
 	
 using boost::posix_time::ptime;
 using boost::posix_time::time_duration;
-using boost::shared_array;
 using boost::shared_ptr;
 using std::string;
+using std::vector;
 
+class Connection;
 class Context;
 
 /**
@@ -87,6 +93,82 @@ class Context;
 class Principal
 {
 public:
+	/**
+	 * Bit-masks naming the attributes that may be loaded selectively with
+	 * load(const u_int32_t) or Connection::get_principals(). Combine
+	 * them with <code>|</code>.
+	 **/
+	enum Field {
+		field_expire_time = KADM5_PRINC_EXPIRE_TIME,
+		field_password_expiration = KADM5_PW_EXPIRATION,
+		field_last_password_change = KADM5_LAST_PWD_CHANGE,
+		field_max_lifetime = KADM5_MAX_LIFE,
+		field_max_renewable_lifetime = KADM5_MAX_RLIFE,
+		field_modifier = KADM5_MOD_NAME,
+		field_modify_time = KADM5_MOD_TIME,
+		field_last_success = KADM5_LAST_SUCCESS,
+		field_last_failed = KADM5_LAST_FAILED
+	};
+	
+	/**
+	 * \brief
+	 * The KAdmin requests commit_modifications() issues for the current
+	 * changes, in this order. See plan_commit().
+	 **/
+	struct CommitPlan
+	{
+		/**
+		 * Flag: it was not known whether the Principal exists, so
+		 * planning asked the server.
+		 **/
+		bool probed;
+		/**
+		 * Flag: create the entry. The name, the password and all
+		 * attributes in create_mask are set along with it.
+		 **/
+		bool create;
+		/** Attributes set by the create request. */
+		u_int32_t create_mask;
+		/** Flag: change the password of the existing entry. */
+		bool change_password;
+		/**
+		 * Flag: let the server generate new random keys (after
+		 * creating the entry, if necessary).
+		 **/
+		bool randomize_keys;
+		/** Flag: rename the existing entry. */
+		bool rename;
+		/**
+		 * Attributes set by a modify request; <code>0</code> if none
+		 * is needed.
+		 **/
+		u_int32_t modify_mask;
+		
+		/**
+		 * Get the number of requests the plan sends to the server,
+		 * not counting the existence check.
+		 * 
+		 * \return	the number of KAdmin requests.
+		 **/
+		const unsigned int requests() const
+			{ return create + change_password + randomize_keys
+				+ rename + (modify_mask != 0); }
+	};
+	
+	/**
+	 * The attributes loaded when no others were requested: all except
+	 * the key data and tagged data, which no accessor uses and which
+	 * are expensive to transfer (and, for keys, to decrypt on the
+	 * server).
+	 **/
+	static const u_int32_t default_fields =
+		( KADM5_PRINC_EXPIRE_TIME | KADM5_PW_EXPIRATION
+		| KADM5_LAST_PWD_CHANGE | KADM5_ATTRIBUTES | KADM5_MAX_LIFE
+		| KADM5_MOD_TIME | KADM5_MOD_NAME | KADM5_KVNO | KADM5_MKVNO
+		| KADM5_AUX_ATTRIBUTES | KADM5_POLICY | KADM5_MAX_RLIFE
+		| KADM5_LAST_SUCCESS | KADM5_LAST_FAILED
+		| KADM5_FAIL_AUTH_COUNT );
+	
 	///@{\name Constructors and Destructors
 	/**
 	 * Constructs a new Principal belonging to the given Context.
@@ -121,12 +203,58 @@ public:
 	
 	/**
 	 * Copy constructor. Produces a deep (complete) copy of the given
-	 * Principal.
+	 * Principal. Use swap() to hand a Principal over without copying.
 	 * 
 	 * \param	p	The Principal to copy.
 	 **/
 	Principal(const Principal& p);
 	
+	/**
+	 * Assignment operator. Replaces this Principal's data by a deep copy
+	 * of the given one's; nothing changes if copying fails.
+	 * 
+	 * \param	p	The Principal to copy.
+	 * \return	a reference to this Principal.
+	 **/
+	Principal& operator=(const Principal& p);
+	
+#if __cplusplus >= 201103L
+	/**
+	 * Move constructor. Takes over the given Principal's data without
+	 * copying it; the moved-from Principal may only be destroyed or
+	 * assigned to afterwards.
+	 * 
+	 * \param	p	The Principal to move.
+	 **/
+	Principal(Principal&& p) noexcept;
+	
+	/**
+	 * Move assignment operator. Exchanges the data of both Principals
+	 * (see swap()).
+	 * 
+	 * \param	p	The Principal to move.
+	 * \return	a reference to this Principal.
+	 **/
+	Principal& operator=(Principal&& p) noexcept;
+#endif
+	
+	/**
+	 * Exchange the complete state of two Principals in constant time
+	 * without allocating or copying any attribute data. Standard
+	 * algorithms that exchange elements (e.g., <code>std::reverse</code>
+	 * or the partitioning in <code>std::sort</code>) use it through
+	 * kadm5::swap() and the <code>std::swap</code> specialization.
+	 * 
+	 * \note
+	 * Before C++11, which adds move semantics, algorithms that hold an
+	 * element aside still copy it: the insertion sort and heap sort
+	 * phases of <code>std::sort</code>, for instance, deep-copy
+	 * Principals. Sort smart pointers to avoid all copies there.
+	 * 
+	 * \param	p	The Principal to exchange data with.
+	 **/
+	void swap(Principal& p);
+	
 	/**
 	 * Cleans up on destruction (surprise! :-)).
 	 **/
@@ -155,8 +283,46 @@ public:
 	
 	/**
 	 * Commit all changes to the database.
+	 * 
+	 * The changes are sent with as few requests as possible (see
+	 * plan_commit()): a new Principal is created with its name, password
+	 * and attributes in one request; for existing ones, only the
+	 * password change, rename and modification actually needed are
+	 * sent.
 	 **/
 	void commit_modifications();
+	
+	/**
+	 * Compute the requests commit_modifications() would send, without
+	 * changing anything (dry run).
+	 * 
+	 * \note
+	 * Whether to create the Principal depends on its existence. If that
+	 * is unknown (e.g., for Principals from
+	 * Connection::create_principal() in optimistic mode), the server is
+	 * asked for the name; see CommitPlan::probed.
+	 * 
+	 * \return	the planned requests.
+	 **/
+	const CommitPlan plan_commit() const;
+	
+	/**
+	 * Fetch the given attributes from the Kerberos database (or default
+	 * values if the Principal does not exist there yet).
+	 * 
+	 * Attributes are otherwise fetched on first access. Use this method
+	 * to restrict the transferred data to the attributes actually
+	 * needed. Accessing an attribute that was not loaded later fetches
+	 * the missing attributes only.
+	 * 
+	 * \note
+	 * Attributes that were already loaded or changed are neither fetched
+	 * again nor overwritten.
+	 * 
+	 * \param	fields	Bit-mask of the attributes to load, e.g.
+	 * 			<code>field_expire_time | field_last_success</code>.
+	 **/
+	void load(const u_int32_t fields =default_fields) const;
 	///@}
 
 	
@@ -223,8 +389,21 @@ public:
 		const vector<CharClass>& ccl =CharClass::defaults()
 	);
 
-// TODO Implement.
-//	void randomize_keys();
+	/**
+	 * Let the KAdmin server give the Principal new random keys on
+	 * commit_modifications(), replacing any password set before.
+	 * 
+	 * Unlike randomize_password(), no secret is generated on the client
+	 * or sent over the network. Use this for service principals whose
+	 * keys are only needed in keytabs.
+	 * 
+	 * \note
+	 * New Principals without a password get random keys anyway. They
+	 * are created locked (<code>KRB5_KDB_DISALLOW_ALL_TIX</code>) and
+	 * unlocked after the keys were replaced, so they are never usable
+	 * with the temporary password that creation requires.
+	 **/
+	void randomize_keys();
 	
 	/**
 	 * Get the expiration date. After this date, the Principal will be
@@ -403,54 +582,204 @@ public:
 //    krb5_kvno fail_auth_count;
 	
 private:
-	// delete_principal() is part of Connection's interface for a more
-	// consistent interface. It still needs to access _id though.
-	friend void Connection::delete_principal(const string& id) const;
+	// The Principal operations in Connection's interface (e.g.,
+	// delete_principal() and get_principal()) need access to _id and
+	// the loading functions.
+	friend class Connection;
+	friend class PrincipalSet;
+	
+	/**
+	 * Fetch the requested attributes of the Principal's entry (identified
+	 * by id()) from the Kerberos database if it exists; otherwise use
+	 * default values. See load(const u_int32_t) for details.
+	 * 
+	 * This variant sends the requests over the given connection handle
+	 * instead of the Principal's own Context. This allows loading many
+	 * Principals concurrently over several handles (see
+	 * Context::clone()).
+	 * 
+	 * \note
+	 * The fetched data will be freed through the Principal's Context.
+	 * This works because the Kerberos libraries allocate all data with
+	 * plain <code>malloc()</code>, regardless of the context.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	fields	Bit-mask of the attributes to load; see
+	 * 			Principal::Field.
+	 **/
+	void load(const Context& handle, const u_int32_t fields) const;
+	
+	/**
+	 * Fetch the requested attributes of the Principal's entry (identified
+	 * by id()) from the Kerberos database. Unlike load(), this does not
+	 * fall back to default values but throws an exception if the entry
+	 * does not exist.
+	 * 
+	 * Already changed attributes will not be overwritten.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	fields	Bit-mask of the attributes to load.
+	 **/
+	void load_existing(const Context& handle, const u_int32_t fields) const;
 	
 	/**
-	 * Fetch the Principal's entry (identified by id()) from the Kerberos
-	 * database if it exists; otherwise use default values.
+	 * Fill the requested attributes with the values of the
+	 * <code>default</code> principal of the Principal's realm. The
+	 * template is taken from the handle's cache (see
+	 * Context::default_template()), so this usually needs no request
+	 * to the server.
+	 * 
+	 * \param	handle	The Context whose template cache to use.
+	 * \param	fields	Bit-mask of the attributes to fill.
+	 **/
+	void load_defaults(const Context& handle, const u_int32_t fields) const;
+	
+	/**
+	 * Helper function for the attribute accessors: make sure the given
+	 * attribute is available. If it is not, all attributes in
+	 * default_fields that are still missing are loaded along with it.
+	 * 
+	 * \param	field	The <code>KADM5_*</code> mask bit of the
+	 * 			attribute.
+	 **/
+	void require(const u_int32_t field) const;
+	
+	/**
+	 * Test whether an entry named id() exists in the Kerberos database.
+	 * Only the name is requested from the server; _data is left
+	 * untouched. The result is remembered, so a later load() of a
+	 * missing Principal uses the default values right away.
+	 * 
+	 * \return	true if the entry exists.
+	 **/
+	const bool probe() const;
+	
+	/**
+	 * Helper function to fetch the given attributes of the database
+	 * entry of <code>pid</code> into _data. The name stored in _data is
+	 * preserved, also if an exception is thrown.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	pid	The principal whose entry should be fetched.
+	 * \param	fields	Bit-mask of the attributes to fetch.
+	 **/
+	void fetch(
+		const Context& handle,
+		krb5_principal pid,
+		const u_int32_t fields
+	) const;
+	
+	/**
+	 * Commit all changes to the database over the given connection
+	 * handle. See commit_modifications() and load(const Context&, const
+	 * u_int32_t).
 	 * 
-	 * load() will check if it has been called before and do nothing in
-	 * that case. Also, it won't overwrite already changed attributes.
+	 * \param	handle	The Context whose KAdmin connection to use.
 	 **/
-	void load() const;
+	void commit(const Context& handle);
+	
+	/**
+	 * Compute the requests commit(const Context&) would send. See
+	 * plan_commit().
+	 * 
+	 * \param	handle	The Context used for the existence check.
+	 * \return	the planned requests.
+	 **/
+	const CommitPlan plan_commit(const Context& handle) const;
 	
 	/**
 	 * Helper function to add a new entry for this Principal to the Kerberos
 	 * database.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 * \param	plan	The planned requests; the creation sets the
+	 * 			attributes in CommitPlan::create_mask, other
+	 * 			modifications remain pending.
 	 **/
-	void apply_create();
+	void apply_create(const Context& handle, const CommitPlan& plan);
+	
+	/**
+	 * Remember that the Principal has an entry on the server, e.g. because
+	 * it was just listed, so committing needs no existence check.
+	 **/
+	void mark_existing() const;
+	
+	/**
+	 * Remember that the Principal has no entry on the server, so
+	 * committing creates it right away. If the name is taken after all,
+	 * the server refuses the creation with <code>KADM5_DUP</code>.
+	 **/
+	void mark_absent() const;
 	
 	/**
 	 * Helper function to perform a rename of this Principal (from id() to
 	 * name()).
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
 	 **/
-	void apply_rename();
+	void apply_rename(const Context& handle);
+	
+	/**
+	 * Helper function for apply_create() and apply_rename(): make the
+	 * name known to the server (name()) the id() of this Principal.
+	 **/
+	void adopt_name();
 	
 	/**
 	 * Helper function to perform the actual modifications of the
 	 * (already existing!) Principal database entry.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
 	 **/
-	void apply_modify() const;
+	void apply_modify(const Context& handle) const;
+	
+	/**
+	 * Helper function to let the server generate new random keys for the
+	 * Principal.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
+	 **/
+	void apply_randkey(const Context& handle);
 	
 	/**
 	 * Helper function to change the Principal's password in the database.
+	 * 
+	 * \param	handle	The Context whose KAdmin connection to use.
 	 **/
-	void apply_password() const;
+	void apply_password(const Context& handle) const;
 	
 	/**
-	 * Helper function to wipe the contents of the given <code>char</code>
-	 * array pointer from memory. The content will be set to all
-	 * <code>0</code>s first, and then the pointer will be set to NULL,
-	 * effectively deallocating held memory.
+	 * Drop the cached record of the given principal from the handle's
+	 * record cache, if enabled. Called after changing the entry on the
+	 * server.
+	 * 
+	 * \param	handle	The Context whose cache to update.
+	 * \param	pp	The principal whose record is outdated.
+	 **/
+	void invalidate_cached(
+		const Context& handle,
+		krb5_const_principal pp
+	) const;
+	
+	/**
+	 * Helper function to adopt the given buffer as the Principal's new
+	 * password. Any previous password is wiped.
+	 * 
+	 * \param	password	The buffer holding the NUL-terminated
+	 * 			password. Empty afterwards.
+	 **/
+	void adopt_password(shared_ptr<SecureBuffer>& password);
+	
+	/**
+	 * Helper function to drop a password buffer. The buffer wipes its
+	 * contents from memory once no copy of this Principal shares it
+	 * anymore (see SecureBuffer).
 	 * 
 	 * It is save to call this function with a <code>NULL</code> pointer.
 	 * 
-	 * \param	cstr	The string to wipe from memory.
-	 * 			<code>NULL</code> pointers will be ignored.
+	 * \param	buffer	The password buffer to drop.
 	 **/
-	void wipe(shared_array<char>& cstr) const;
+	void wipe(shared_ptr<SecureBuffer>& buffer) const;
 
 	
 	/* Data members */
@@ -464,12 +793,15 @@ private:
 	shared_ptr<krb5_principal_data> _id;
 	/** The structure holding all attribute data. See <kadm5/admin.h> */
 	shared_ptr<kadm5_principal_ent_rec> _data; 
-	/** The Principal's password-to-be. */
-	mutable shared_array<char> _password;	// Use char[] instead of string
-						// so we may be sure to wipe
-						// the contents from memory.
-	/** Flag to check if the data was loaded before. */
-	mutable bool _loaded;
+	/**
+	 * The Principal's password-to-be. Kept in locked memory that is
+	 * wiped on release (see SecurePool).
+	 **/
+	mutable shared_ptr<SecureBuffer> _password;
+	/** Flag to request new random keys on commit. */
+	bool _random_keys;
+	/** Bit-mask to remember which attributes were loaded. */
+	mutable u_int32_t _loaded_mask;
 	/** Flag to check if the Principal has an entry on the server. */
 	mutable bool _exists;
 	/** Bit-mask to remember which attributes were changed. */
@@ -478,16 +810,44 @@ private:
 	// See MIT Kerberos 5 kadm API documentation for a list of forbidden
 	// flags in the different operations.
 	static const u_int32_t forbidden_create_flags =
-		( KADM5_LAST_PWD_CHANGE | KADM5_MOD_TIME | KADM5_MOD_NAME \
-		| KADM5_MKVNO | KADM5_AUX_ATTRIBUTES | KADM5_POLICY_CLR \
-		| KADM5_LAST_SUCCESS | KADM5_LAST_FAILED \
+		( KADM5_LAST_PWD_CHANGE | KADM5_MOD_TIME | KADM5_MOD_NAME
+		| KADM5_MKVNO | KADM5_AUX_ATTRIBUTES | KADM5_POLICY_CLR
+		| KADM5_LAST_SUCCESS | KADM5_LAST_FAILED
 		| KADM5_FAIL_AUTH_COUNT | KADM5_KEY_DATA );
 	static const u_int32_t forbidden_modify_flags = 
-		( KADM5_PRINCIPAL | KADM5_LAST_PWD_CHANGE | KADM5_MOD_TIME \
-		| KADM5_MOD_NAME | KADM5_MKVNO | KADM5_AUX_ATTRIBUTES \
+		( KADM5_PRINCIPAL | KADM5_LAST_PWD_CHANGE | KADM5_MOD_TIME
+		| KADM5_MOD_NAME | KADM5_MKVNO | KADM5_AUX_ATTRIBUTES
 		| KADM5_LAST_SUCCESS | KADM5_LAST_FAILED | KADM5_KEY_DATA );
 };
 
+
+/**
+ * Exchange two Principals' data in constant time; see Principal::swap().
+ * 
+ * \param	a	The first Principal.
+ * \param	b	The second Principal.
+ **/
+inline void swap(Principal& a, Principal& b)
+{
+	a.swap(b);
+}
+
 } /* namespace kadm5 */
 
+
+namespace std
+{
+
+/**
+ * Let standard algorithms exchange Principals without deep copies. Before
+ * C++11, other element moves still copy; see Principal::swap().
+ **/
+template<>
+inline void swap(kadm5::Principal& a, kadm5::Principal& b)
+{
+	a.swap(b);
+}
+
+} /* namespace std */
+
 #endif /*PRINCIPAL_H_*/
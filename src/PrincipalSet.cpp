@@ -0,0 +1,377 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+#include <kadm5/kadm5_err.h>
+
+// Local
+#include "PrincipalSet.hpp"
+#include "Context.hpp"
+#include "Error.hpp"
+#include "NameList.hpp"
+#include "Principal.hpp"
+
+namespace kadm5
+{
+
+PrincipalSet::PrincipalSet(
+	shared_ptr<Context> context,
+	const vector<string>& names,
+	const u_int32_t fields,
+	const unsigned int handles
+)	:	_context(context),
+		_fields(fields | KADM5_PRINCIPAL)
+{
+	KADM5_DEBUG("PrincipalSet(): Constructing...\n");
+	
+	vector<const char*> pnames;
+	pnames.reserve(names.size());
+	for (size_t i = 0; i < names.size(); i++) {
+		pnames.push_back(names[i].c_str());
+	}
+	fetch(pnames, handles);
+}
+
+
+PrincipalSet::PrincipalSet(
+	shared_ptr<Context> context,
+	const NameList& names,
+	const u_int32_t fields,
+	const unsigned int handles
+)	:	_context(context),
+		_fields(fields | KADM5_PRINCIPAL)
+{
+	KADM5_DEBUG("PrincipalSet(): Constructing from NameList...\n");
+	
+	fetch(vector<const char*>(names.begin(), names.end()), handles);
+}
+
+
+void PrincipalSet::fetch(
+	const vector<const char*>& names,
+	const unsigned int handles
+) {
+	kadm5_principal_ent_rec empty;
+	memset(&empty, 0, sizeof(kadm5_principal_ent_rec));
+	_records.resize(names.size(), empty);
+	vector<int32_t> errors(names.size(), 0);
+	
+	size_t n = std::max<size_t>(
+		1, std::min<size_t>(handles, names.size())
+	);
+	if (n == 1) {
+		fetch_slice(_context, &names, &_records, 0, 1, _fields, &errors);
+	}
+	else {
+		// See Connection::load_all(): one connection per worker.
+		vector< shared_ptr<const Context> > workers;
+		workers.push_back(_context);
+		try {
+			while (workers.size() < n) {
+				workers.push_back(_context->clone());
+			}
+		}
+		catch (...) {
+			// Nothing was fetched yet.
+			_records.clear();
+			throw;
+		}
+		
+		boost::thread_group threads;
+		for (size_t i = 0; i < n; i++) {
+			threads.create_thread(
+				boost::bind(
+					fetch_slice,
+					workers[i],
+					&names,
+					&_records,
+					i,
+					n,
+					_fields,
+					&errors
+				)
+			);
+		}
+		threads.join_all();
+	}
+	
+	// Drop the names removed since listing them; the destructor does not
+	// run if the constructor throws, so clean up before that.
+	int32_t failure = 0;
+	size_t kept = 0;
+	size_t length = 0;
+	for (size_t i = 0; i < names.size(); i++) {
+		if (errors[i] == 0) {
+			_records[kept++] = _records[i];
+			length += strlen(names[i]) + 1;
+		}
+		else if (errors[i] != KADM5_UNK_PRINC && !failure) {
+			failure = errors[i];
+		}
+	}
+	_records.resize(kept);
+	
+	try {
+		error::throw_on_error(failure);
+		
+		_names.reserve(length);
+		_name_offsets.reserve(kept);
+		for (size_t i = 0; i < names.size(); i++) {
+			if (errors[i] == 0) {
+				_name_offsets.push_back(_names.size());
+				// Including the terminating NUL character.
+				_names.insert(
+					_names.end(),
+					names[i],
+					names[i] + strlen(names[i]) + 1
+				);
+			}
+		}
+	}
+	catch (...) {
+		free_records();
+		throw;
+	}
+}
+
+
+PrincipalSet::~PrincipalSet()
+{
+	free_records();
+	KADM5_DEBUG("~PrincipalSet(): Destructed.\n");
+}
+
+
+shared_ptr<Principal> PrincipalSet::principal(const size_t i) const
+{
+	shared_ptr<Principal> pret(
+		new Principal(_context, &_names[_name_offsets.at(i)])
+	);
+	// Fetched names exist; committing needs no check.
+	pret->mark_existing();
+	return pret;
+}
+
+
+void PrincipalSet::fetch_slice(
+	shared_ptr<const Context> handle,
+	const vector<const char*>* names,
+	vector<kadm5_principal_ent_rec>* records,
+	const size_t first,
+	const size_t step,
+	const u_int32_t fields,
+	vector<int32_t>* errors
+) {
+	for (size_t i = first; i < names->size(); i += step) {
+		krb5_principal pp = NULL;
+		try {
+			error::throw_on_error(
+				krb5_parse_name(
+					*handle,
+					handle->qualified_name(
+						(*names)[i]
+					).c_str(),
+					&pp
+				)
+			);
+			(*errors)[i] = handle->execute(
+					boost::bind(
+						kadm5_get_principal,
+						_1,
+						pp,
+						&(*records)[i],
+						fields
+					),
+					true
+				);
+		}
+		catch (const error& e) {
+			(*errors)[i] = e.error_code() ?
+					e.error_code() : KADM5_FAILURE;
+		}
+		catch (const std::bad_alloc&) {
+			(*errors)[i] = ENOMEM;
+		}
+		catch (...) {
+			(*errors)[i] = KADM5_FAILURE;
+		}
+		if (pp) {
+			krb5_free_principal(*handle, pp);
+		}
+	}
+}
+
+
+void PrincipalSet::free_records()
+{
+	// Must neither connect nor throw; see Context::current_handle().
+	void* ph = _context->current_handle();
+	for (size_t i = 0; ph && i < _records.size(); i++) {
+		// Frees only the members; the array goes in one piece.
+		kadm5_free_principal_ent(ph, &_records[i]);
+	}
+	_records.clear();
+}
+
+
+const kadm5_principal_ent_rec& PrincipalSet::Entry::record(
+	const u_int32_t field
+) const
+{
+	if (!(_set->_fields & field)) {
+		throw error(KADM5_BAD_MASK);
+	}
+	return _set->_records.at(_index);
+}
+
+
+const string PrincipalSet::Entry::name() const
+{
+	record(KADM5_PRINCIPAL);
+	return string(&_set->_names[_set->_name_offsets[_index]]);
+}
+
+
+const ptime PrincipalSet::Entry::expire_time() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_PRINC_EXPIRE_TIME);
+	if (r.princ_expire_time > 0) {
+		return boost::posix_time::from_time_t(r.princ_expire_time);
+	}
+	else {
+		return boost::posix_time::pos_infin;
+	}
+}
+
+
+const ptime PrincipalSet::Entry::password_expiration() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_PW_EXPIRATION);
+	if (r.pw_expiration > 0) {
+		return boost::posix_time::from_time_t(r.pw_expiration);
+	}
+	else {
+		return boost::posix_time::pos_infin;
+	}
+}
+
+
+const time_duration PrincipalSet::Entry::max_lifetime() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_MAX_LIFE);
+	if (r.max_life > 0) {
+		return boost::posix_time::seconds(r.max_life);
+	}
+	else {
+		return boost::posix_time::pos_infin;
+	}
+}
+
+
+const time_duration PrincipalSet::Entry::max_renewable_lifetime() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_MAX_RLIFE);
+	if (r.max_renewable_life > 0) {
+		return boost::posix_time::seconds(r.max_renewable_life);
+	}
+	else {
+		return boost::posix_time::pos_infin;
+	}
+}
+
+
+const string PrincipalSet::Entry::modifier() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_MOD_NAME);
+	return r.mod_name ? unparse_name(_set->_context, r.mod_name) : "";
+}
+
+
+const ptime PrincipalSet::Entry::modify_time() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_MOD_TIME);
+	if (r.mod_date > 0) {
+		return boost::posix_time::from_time_t(r.mod_date);
+	}
+	else {
+		return boost::posix_time::neg_infin;
+	}
+}
+
+
+const ptime PrincipalSet::Entry::last_password_change() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_LAST_PWD_CHANGE);
+	if (r.last_pwd_change > 0) {
+		return boost::posix_time::from_time_t(r.last_pwd_change);
+	}
+	else {
+		return boost::posix_time::neg_infin;
+	}
+}
+
+
+const ptime PrincipalSet::Entry::last_success() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_LAST_SUCCESS);
+	if (r.last_success > 0) {
+		return boost::posix_time::from_time_t(r.last_success);
+	}
+	else {
+		return boost::posix_time::neg_infin;
+	}
+}
+
+
+const ptime PrincipalSet::Entry::last_failed() const
+{
+	const kadm5_principal_ent_rec& r = record(KADM5_LAST_FAILED);
+	if (r.last_failed > 0) {
+		return boost::posix_time::from_time_t(r.last_failed);
+	}
+	else {
+		return boost::posix_time::neg_infin;
+	}
+}
+
+} /* namespace kadm5 */
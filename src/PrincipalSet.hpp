@@ -0,0 +1,277 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef PRINCIPALSET_HPP_
+#define PRINCIPALSET_HPP_
+
+// STL and Boost
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+namespace kadm5
+{
+
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+class Context;
+class NameList;
+class Principal;
+
+/**
+ * \brief
+ * Read-only result set of many Principals' database entries, stored
+ * together.
+ * 
+ * Unlike a list of Principal objects, the set keeps all entry records in
+ * one array and all names in one buffer, and holds a single reference to
+ * its Context. Loading <em>n</em> entries thus needs a few allocations
+ * instead of several per entry (Principal object, record, parsed name,
+ * smart pointer control blocks), and everything is released together.
+ * Only the members the KAdmin library allocates inside each record (e.g.,
+ * the principal names) remain separate.
+ * 
+ * The entries are accessed through Entry views, which offer the read
+ * accessors of Principal:
+ * \code
+ * shared_ptr<PrincipalSet> ps = conn.get_principal_set("*");
+ * for (size_t i = 0; i < ps->size(); i++) {
+ * 	std::cout << (*ps)[i].name() << ": " << (*ps)[i].expire_time()
+ * 		<< std::endl;
+ * }
+ * \endcode
+ * Use principal() to get a modifiable Principal for an entry.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class PrincipalSet : public boost::noncopyable
+{
+public:
+	/**
+	 * \brief
+	 * View of one entry of a PrincipalSet. Valid as long as the set.
+	 **/
+	class Entry
+	{
+	public:
+		/**
+		 * Creates a view of an entry.
+		 * 
+		 * \param	set	The set holding the entry.
+		 * \param	index	The entry's position.
+		 **/
+		Entry(const PrincipalSet& set, const size_t index)
+			: _set(&set), _index(index) {}
+		
+		/** \see Principal::name() */
+		const string name() const;
+		/** \see Principal::expire_time() */
+		const ptime expire_time() const;
+		/** \see Principal::password_expiration() */
+		const ptime password_expiration() const;
+		/** \see Principal::max_lifetime() */
+		const time_duration max_lifetime() const;
+		/** \see Principal::max_renewable_lifetime() */
+		const time_duration max_renewable_lifetime() const;
+		/**
+		 * Get the name of the Principal who last modified the entry.
+		 * Unlike Principal::modifier(), this returns the name only.
+		 * 
+		 * \return	the modifier's name.
+		 **/
+		const string modifier() const;
+		/** \see Principal::modify_time() */
+		const ptime modify_time() const;
+		/** \see Principal::last_password_change() */
+		const ptime last_password_change() const;
+		/** \see Principal::last_success() */
+		const ptime last_success() const;
+		/** \see Principal::last_failed() */
+		const ptime last_failed() const;
+		
+	private:
+		/**
+		 * Get the entry's record, checking that the set holds the
+		 * given attribute.
+		 * 
+		 * \param	field	The attribute to be read.
+		 * \return	the record.
+		 **/
+		const kadm5_principal_ent_rec& record(
+			const u_int32_t field
+		) const;
+		
+		/** The set holding the entry. */
+		const PrincipalSet* _set;
+		/** The entry's position in the set. */
+		size_t _index;
+	};
+	
+	/**
+	 * Fetches the entries of the given Principals. Names that do not
+	 * exist (anymore) are skipped.
+	 * 
+	 * \param	context	The Context used to access the KAdmin server.
+	 * \param	names	The names of the Principals to fetch.
+	 * \param	fields	Bit-mask of the attributes to fetch (see
+	 * 			Principal::Field). Accessing others throws.
+	 * \param	handles	The number of connections (this Context and
+	 * 			clones of it) fetching concurrently.
+	 **/
+	PrincipalSet(
+		shared_ptr<Context> context,
+		const vector<string>& names,
+		const u_int32_t fields,
+		const unsigned int handles =1
+	);
+	
+	/**
+	 * Fetches the entries of listed Principals without copying their
+	 * names first (see Connection::list_names()). Names that do not
+	 * exist (anymore) are skipped.
+	 * 
+	 * \param	context	The Context used to access the KAdmin server.
+	 * \param	names	The names of the Principals to fetch.
+	 * \param	fields	Bit-mask of the attributes to fetch (see
+	 * 			Principal::Field). Accessing others throws.
+	 * \param	handles	The number of connections (this Context and
+	 * 			clones of it) fetching concurrently.
+	 **/
+	PrincipalSet(
+		shared_ptr<Context> context,
+		const NameList& names,
+		const u_int32_t fields,
+		const unsigned int handles =1
+	);
+	
+	/**
+	 * Destructor. Releases all entries.
+	 **/
+	~PrincipalSet();
+	
+	/**
+	 * Get the number of entries.
+	 * 
+	 * \return	the number of entries.
+	 **/
+	const size_t size() const { return _records.size(); }
+	
+	/**
+	 * Get a view of an entry.
+	 * 
+	 * \param	i	The entry's position; less than size().
+	 * \return	a view of the entry.
+	 **/
+	const Entry operator[](const size_t i) const { return Entry(*this, i); }
+	
+	/**
+	 * Get the attributes fetched for all entries.
+	 * 
+	 * \return	the bit-mask of attributes (see Principal::Field).
+	 **/
+	const u_int32_t fields() const { return _fields; }
+	
+	/**
+	 * Create a modifiable Principal for an entry. Its data is loaded
+	 * anew on access.
+	 * 
+	 * \param	i	The entry's position; less than size().
+	 * \return	a smart pointer to the new Principal.
+	 **/
+	shared_ptr<Principal> principal(const size_t i) const;
+
+private:
+	friend class Entry;
+	
+	/**
+	 * Helper function for the constructors: fetch the entries and
+	 * store the names of those that exist.
+	 * 
+	 * \param	names	The names to fetch; only used during the call.
+	 * \param	handles	The number of connections fetching
+	 * 			concurrently.
+	 **/
+	void fetch(const vector<const char*>& names, const unsigned int handles);
+	
+	/**
+	 * Thread function: fetch every <code>step</code>-th entry, starting
+	 * with <code>first</code>.
+	 * 
+	 * \param	handle	The connection to use.
+	 * \param	names	The names to fetch.
+	 * \param	records	Receives the records (sized like names).
+	 * \param	first	The first index to fetch.
+	 * \param	step	The distance between the fetched indices.
+	 * \param	fields	The attributes to fetch.
+	 * \param	errors	Receives the result of each fetch.
+	 **/
+	static void fetch_slice(
+		shared_ptr<const Context> handle,
+		const vector<const char*>* names,
+		vector<kadm5_principal_ent_rec>* records,
+		const size_t first,
+		const size_t step,
+		const u_int32_t fields,
+		vector<int32_t>* errors
+	);
+	
+	/**
+	 * Release the library-allocated members of all records.
+	 **/
+	void free_records();
+	
+	/** The Context used to access the KAdmin server. */
+	shared_ptr<Context> _context;
+	/** The fetched attributes. */
+	u_int32_t _fields;
+	/** The entries' records. */
+	vector<kadm5_principal_ent_rec> _records;
+	/** The entries' names, each terminated by a NUL character. */
+	vector<char> _names;
+	/** Position of each entry's name in _names. */
+	vector<size_t> _name_offsets;
+};
+
+} /* namespace kadm5 */
+
+#endif /*PRINCIPALSET_HPP_*/
@@ -33,6 +33,7 @@
 
 
 // STL and Boost
+#include <algorithm>
 #include <boost/nondet_random.hpp>
 
 // Local
@@ -61,26 +62,37 @@ const vector<CharClass>& CharClass::defaults()
 
 const string random_password(const vector<CharClass>& ccl)
 {
-	boost::random_device rng;
-	string random_chars;
+	return string(random_secure_password(ccl)->data());
+}
+
 
+shared_ptr<SecureBuffer> random_secure_password(const vector<CharClass>& ccl)
+{
+	boost::random_device rng;
+	
+	size_t length = 0;
+	for (size_t i = 0; i < ccl.size(); i++) {
+		length += std::max(ccl[i].frequency, 0);
+	}
+	
 	// Generate a list of random characters with the specified frequencies.
-	for (int i=0; i < ccl.size(); i++) {
-		for (int j=0; j < ccl[i].frequency; j++) {
-			random_chars += ccl[i].charset[
+	SecureBuffer random_chars(length);
+	size_t n = 0;
+	for (size_t i = 0; i < ccl.size(); i++) {
+		for (int j = 0; j < ccl[i].frequency; j++) {
+			random_chars.data()[n++] = ccl[i].charset[
 						rng() % ccl[i].charset.size()
 					];
 		}
 	}
 	
-	string pw;
-	
-	// Put the random characters at random positions in the password.
-	while (random_chars.size()) {
-		string::iterator it = random_chars.begin() +
-					(rng() % random_chars.size());
-		pw += *it;
-		random_chars.erase(it);
+	// Put the random characters at random positions in the password;
+	// the zeroed buffer provides the terminating NUL.
+	shared_ptr<SecureBuffer> pw( new SecureBuffer(length + 1) );
+	for (size_t i = 0; n > 0; i++) {
+		size_t k = rng() % n;
+		pw->data()[i] = random_chars.data()[k];
+		random_chars.data()[k] = random_chars.data()[--n];
 	}
 	
 	return pw;
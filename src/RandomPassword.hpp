@@ -36,6 +36,9 @@
 
 #include <string>
 #include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "SecureBuffer.hpp"
 
 /** Default character classes used for random password generation. */
 // The { "", 0 } entry is used to determine the array end.
@@ -50,6 +53,7 @@
 namespace kadm5
 {
 
+using boost::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -90,6 +94,22 @@ const string random_password(
 	const vector<CharClass>& ccl =CharClass::defaults()
 );
 
+/**
+ * Generates a random password like random_password(), but entirely in
+ * secure memory (see SecureBuffer): neither the password nor the
+ * intermediate characters are ever stored in ordinary heap memory.
+ * 
+ * \note
+ * This operation may block if the system's entropy pool is empty.
+ * 
+ * \param	ccl	A list of character classes to use for password
+ * 			generation.
+ * \return	A buffer holding the NUL-terminated password.
+ **/
+shared_ptr<SecureBuffer> random_secure_password(
+	const vector<CharClass>& ccl =CharClass::defaults()
+);
+
 } /* namespace kadm5 */
 
 #endif /*RANDOMPASSWORD_HPP_*/
@@ -0,0 +1,200 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <boost/bind.hpp>
+
+// Local
+#include "Context.hpp"
+#include "Error.hpp"
+#include "RecordCache.hpp"
+
+namespace kadm5
+{
+
+using boost::posix_time::microsec_clock;
+
+/**
+ * Custom deletion function for the heap-allocated records held by a
+ * RecordCache.
+ **/
+static void free_record(void* ph, kadm5_principal_ent_t pp)
+{
+	if (ph) {
+		kadm5_free_principal_ent(ph, pp);
+	}
+	delete pp;
+}
+
+
+RecordCache::RecordCache(
+	const Context& owner,
+	const size_t capacity,
+	const time_duration& ttl
+) :
+	_krb_context(owner),
+	_owner(owner),
+	_capacity( std::max<size_t>(capacity, 1) ),
+	_ttl(ttl),
+	_entries(),
+	_usage(),
+	_hits(0),
+	_misses(0)
+{
+}
+
+
+const bool RecordCache::lookup(
+	krb5_const_principal pp,
+	kadm5_principal_ent_t pdst,
+	const u_int32_t fields
+) {
+	EntryMap::iterator it = _entries.find(key(pp));
+	if (it == _entries.end()) {
+		_misses++;
+		return false;
+	}
+	
+	Entry& e = it->second;
+	if (microsec_clock::universal_time() - e.stored >= _ttl) {
+		erase(it);
+		_misses++;
+		return false;
+	}
+	// The principal name is not stored, but always known to the caller.
+	if (((e.fields | KADM5_PRINCIPAL) & fields) != fields) {
+		_misses++;
+		return false;
+	}
+	
+	try {
+		copy_kadm5_principal_ent_fields(
+			_krb_context,
+			pdst,
+			e.record.get(),
+			fields
+		);
+	}
+	catch (...) {
+		// Leave the pointer members empty as promised. The owner is
+		// connected since it fetched the cached record.
+		kadm5_free_principal_ent(_owner.current_handle(), pdst);
+		memset(pdst, 0, sizeof(kadm5_principal_ent_rec));
+		throw;
+	}
+	
+	_usage.splice(_usage.begin(), _usage, e.usage);
+	_hits++;
+	return true;
+}
+
+
+void RecordCache::store(
+	krb5_const_principal pp,
+	const kadm5_principal_ent_rec* psrc,
+	const u_int32_t fields
+) {
+	string name( key(pp) );
+	
+	kadm5_principal_ent_t pent = new kadm5_principal_ent_rec;
+	memset(pent, 0, sizeof(kadm5_principal_ent_rec));
+	// Context::reconnect() clears the cache before dropping this handle.
+	shared_ptr<kadm5_principal_ent_rec> precord(
+		pent, boost::bind(free_record, _owner.current_handle(), _1)
+	);
+	// Names, keys and tagged data are never copied (and not needed).
+	const u_int32_t stored =
+		fields & ~(KADM5_PRINCIPAL | KADM5_KEY_DATA | KADM5_TL_DATA);
+	copy_kadm5_principal_ent_fields(_krb_context, pent, psrc, stored);
+	
+	EntryMap::iterator it = _entries.find(name);
+	if (it != _entries.end()) {
+		erase(it);
+	}
+	else if (_entries.size() >= _capacity) {
+		erase(_entries.find(_usage.back()));
+	}
+	
+	_usage.push_front(name);
+	try {
+		Entry& e = _entries[name];
+		e.record = precord;
+		e.fields = stored;
+		e.stored = microsec_clock::universal_time();
+		e.usage = _usage.begin();
+	}
+	catch (...) {
+		_usage.pop_front();
+		throw;
+	}
+}
+
+
+void RecordCache::invalidate(krb5_const_principal pp)
+{
+	EntryMap::iterator it = _entries.find(key(pp));
+	if (it != _entries.end()) {
+		erase(it);
+	}
+}
+
+
+void RecordCache::clear()
+{
+	_entries.clear();
+	_usage.clear();
+}
+
+
+const string RecordCache::key(krb5_const_principal pp) const
+{
+	char* tmp = NULL;
+	
+	error::throw_on_error( krb5_unparse_name(_krb_context, pp, &tmp) );
+	shared_ptr<char> name(tmp, free);
+	
+	return string(name.get());
+}
+
+
+void RecordCache::erase(EntryMap::iterator it)
+{
+	_usage.erase(it->second.usage);
+	_entries.erase(it);
+}
+
+
+} /* namespace kadm5 */
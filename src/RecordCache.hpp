@@ -0,0 +1,233 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef RECORDCACHE_HPP_
+#define RECORDCACHE_HPP_
+
+// STL and Boost
+#include <list>
+#include <map>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+namespace kadm5
+{
+
+class Context;
+
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+
+/**
+ * \brief
+ * Bounded cache of principal records fetched from the KAdmin server, keyed
+ * by the principals' full names.
+ * 
+ * Entries expire after a fixed time; when the cache is full, the least
+ * recently used entry is dropped. Each entry remembers which attributes it
+ * holds, so a lookup only succeeds if all requested attributes are cached.
+ * 
+ * A RecordCache belongs to a Context (see Context::enable_record_cache())
+ * and uses its Kerberos context and KAdmin handle to copy and free the
+ * records. The Context clears the cache when it reconnects, so records
+ * never outlive the handle they are freed with. Like the Context, it must
+ * not be used by several threads at once.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class RecordCache : public boost::noncopyable
+{
+public:
+	/**
+	 * Creates an empty cache.
+	 * 
+	 * \param	owner	The Context whose Kerberos context copies the
+	 * 			records and unparses principal names, and
+	 * 			whose KAdmin handle frees the records.
+	 * \param	capacity	The maximum number of entries.
+	 * \param	ttl	The time after which an entry expires.
+	 **/
+	RecordCache(
+		const Context& owner,
+		const size_t capacity,
+		const time_duration& ttl
+	);
+	
+	/**
+	 * Copy the requested attributes of a cached record.
+	 * 
+	 * \param	pp	The principal whose record to look up.
+	 * \param	pdst	The record to copy into. Its pointer members
+	 * 			must be empty (see
+	 * 			copy_kadm5_principal_ent_fields()). They are
+	 * 			left empty if the lookup fails.
+	 * \param	fields	<code>KADM5_*</code> bits of the requested
+	 * 			attributes.
+	 * \return	true if a valid entry held all requested attributes.
+	 **/
+	const bool lookup(
+		krb5_const_principal pp,
+		kadm5_principal_ent_t pdst,
+		const u_int32_t fields
+	);
+	
+	/**
+	 * Store a copy of the given attributes of a record, replacing any
+	 * previous entry of the principal.
+	 * 
+	 * \param	pp	The principal the record belongs to.
+	 * \param	psrc	The record to copy from.
+	 * \param	fields	<code>KADM5_*</code> bits of the attributes to
+	 * 			store.
+	 **/
+	void store(
+		krb5_const_principal pp,
+		const kadm5_principal_ent_rec* psrc,
+		const u_int32_t fields
+	);
+	
+	/**
+	 * Drop the entry of the given principal, e.g. after it was changed.
+	 * 
+	 * \param	pp	The principal whose entry to drop.
+	 **/
+	void invalidate(krb5_const_principal pp);
+	
+	/**
+	 * Drop all entries.
+	 **/
+	void clear();
+	
+	/**
+	 * Get the number of entries.
+	 * 
+	 * \return	the number of cached records (including expired ones
+	 * 		not dropped yet).
+	 **/
+	const size_t size() const { return _entries.size(); }
+	
+	/**
+	 * Get the maximum number of entries.
+	 * 
+	 * \return	the cache's capacity.
+	 **/
+	const size_t capacity() const { return _capacity; }
+	
+	/**
+	 * Get the time after which an entry expires.
+	 * 
+	 * \return	the lifetime of the entries.
+	 **/
+	const time_duration ttl() const { return _ttl; }
+	
+	/**
+	 * Get the number of successful lookups.
+	 * 
+	 * \return	the number of cache hits.
+	 **/
+	const unsigned long hits() const { return _hits; }
+	
+	/**
+	 * Get the number of failed lookups.
+	 * 
+	 * \return	the number of cache misses.
+	 **/
+	const unsigned long misses() const { return _misses; }
+
+private:
+	/** Names of the cached principals; most recently used first. */
+	typedef std::list<string> UsageList;
+	
+	/** \brief A cached record. */
+	struct Entry
+	{
+		/** The copy of the record. */
+		shared_ptr<kadm5_principal_ent_rec> record;
+		/** <code>KADM5_*</code> bits of the attributes held. */
+		u_int32_t fields;
+		/** The time the record was stored. */
+		ptime stored;
+		/** Position of the principal's name in _usage. */
+		UsageList::iterator usage;
+	};
+	
+	/** Cached records by principal name. */
+	typedef std::map<string, Entry> EntryMap;
+	
+	/**
+	 * Get the full name of a principal, used as key.
+	 * 
+	 * \param	pp	The principal.
+	 * \return	the principal's name including the realm.
+	 **/
+	const string key(krb5_const_principal pp) const;
+	
+	/**
+	 * Remove an entry.
+	 * 
+	 * \param	it	Position of the entry in _entries.
+	 **/
+	void erase(EntryMap::iterator it);
+	
+	/** Kerberos context used to copy records and unparse names. */
+	krb5_context _krb_context;
+	/**
+	 * The owning Context. Its KAdmin handle, used to free records, may
+	 * only be opened after construction (see Context::connected()).
+	 **/
+	const Context& _owner;
+	/** Maximum number of entries. */
+	const size_t _capacity;
+	/** Lifetime of the entries. */
+	const time_duration _ttl;
+	/** Cached records by principal name. */
+	EntryMap _entries;
+	/** Principal names in order of use. */
+	UsageList _usage;
+	/** Number of successful lookups. */
+	unsigned long _hits;
+	/** Number of failed lookups. */
+	unsigned long _misses;
+};
+
+} /* namespace kadm5 */
+
+#endif /*RECORDCACHE_HPP_*/
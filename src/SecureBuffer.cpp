@@ -0,0 +1,287 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <boost/thread/mutex.hpp>
+
+// System
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Local
+#include "Error.hpp"
+#include "SecureBuffer.hpp"
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+	#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace kadm5
+{
+
+/** The process-wide instance returned by SecurePool::shared(). */
+static shared_ptr<SecurePool> shared_pool;
+/** Guards shared_pool. */
+static boost::mutex shared_pool_mutex;
+
+/** Slot sizes are multiples of this, so slots stay aligned. */
+static const size_t SLOT_ALIGNMENT = 16;
+
+
+/**
+ * Round a size up to a multiple of the given unit.
+ * 
+ * \param	size	The size to round.
+ * \param	unit	The unit.
+ * \return	the rounded size.
+ **/
+static size_t round_up(const size_t size, const size_t unit)
+{
+	return ((size + unit - 1) / unit) * unit;
+}
+
+
+void secure_wipe(void* p, const size_t size)
+{
+#ifdef HAVE_EXPLICIT_BZERO
+	explicit_bzero(p, size);
+#else
+	// Stores through a volatile pointer count as observable behaviour.
+	volatile char* pv = static_cast<volatile char*>(p);
+	for (size_t i = 0; i < size; i++) {
+		pv[i] = 0;
+	}
+#endif
+}
+
+
+SecurePool::SecurePool(const size_t slot_size, const size_t region_pages)
+	:	_slot_size(0),
+		_region_size(0),
+		_page_size(sysconf(_SC_PAGESIZE)),
+		_regions(),
+		_free(),
+		_fresh(0),
+		_usage()
+{
+	_slot_size = round_up(std::max<size_t>(slot_size, 1), SLOT_ALIGNMENT);
+	
+	// Every region holds at least one slot.
+	size_t pages = std::max<size_t>(region_pages, 1);
+	_region_size = round_up(
+		std::max(pages * _page_size, _slot_size), _page_size
+	);
+}
+
+
+SecurePool::~SecurePool()
+{
+	for (size_t i = 0; i < _regions.size(); i++) {
+		unmap_guarded(_regions[i], _region_size);
+	}
+}
+
+
+shared_ptr<SecurePool> SecurePool::shared()
+{
+	boost::mutex::scoped_lock lock(shared_pool_mutex);
+	if (!shared_pool) {
+		shared_pool.reset(new SecurePool);
+	}
+	return shared_pool;
+}
+
+
+char* SecurePool::acquire(const size_t size)
+{
+	if (size > _slot_size) {
+		bool locked = false;
+		char* p = map_guarded(size, &locked);
+		
+		boost::mutex::scoped_lock lock(_mutex);
+		_usage.oversized_in_use++;
+		_usage.acquired++;
+		return p;
+	}
+	
+	boost::mutex::scoped_lock lock(_mutex);
+	if (_free.empty()) {
+		add_region();
+	}
+	
+	// Fresh slots lie below the released ones in the free list.
+	if (_free.size() > _fresh) {
+		_usage.reused++;
+	}
+	else {
+		_fresh--;
+	}
+	char* p = _free.back();
+	_free.pop_back();
+	
+	_usage.acquired++;
+	_usage.slots_in_use++;
+	_usage.peak_slots_in_use = std::max(
+		_usage.peak_slots_in_use, _usage.slots_in_use
+	);
+	return p;
+}
+
+
+void SecurePool::release(char* p, const size_t size)
+{
+	if (!p) {
+		return;
+	}
+	
+	if (size > _slot_size) {
+		unmap_guarded(p, size);
+		
+		boost::mutex::scoped_lock lock(_mutex);
+		_usage.oversized_in_use--;
+		return;
+	}
+	
+	// Wipe the whole slot; callers need not know what they wrote.
+	secure_wipe(p, _slot_size);
+	
+	boost::mutex::scoped_lock lock(_mutex);
+	_free.push_back(p);
+	_usage.slots_in_use--;
+}
+
+
+const SecurePool::Usage SecurePool::usage() const
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return _usage;
+}
+
+
+char* SecurePool::map_guarded(const size_t size, bool* locked)
+{
+	size_t usable = round_up(std::max<size_t>(size, 1), _page_size);
+	size_t total = usable + 2 * _page_size;
+	
+	void* pmap = mmap(
+			NULL,
+			total,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS,
+			-1,
+			0
+		);
+	if (pmap == MAP_FAILED) {
+		error::throw_on_error(errno ? errno : ENOMEM);
+	}
+	char* pbase = static_cast<char*>(pmap);
+	
+	// Guard pages before and after the usable memory.
+	if (	mprotect(pbase, _page_size, PROT_NONE) != 0 ||
+		mprotect(pbase + _page_size + usable, _page_size, PROT_NONE)
+			!= 0
+	) {
+		int ret = errno ? errno : ENOMEM;
+		munmap(pmap, total);
+		error::throw_on_error(ret);
+	}
+	
+	char* p = pbase + _page_size;
+	// Locking fails beyond RLIMIT_MEMLOCK; the memory still works.
+	*locked = (mlock(p, usable) == 0);
+#ifdef MADV_DONTDUMP
+	madvise(p, usable, MADV_DONTDUMP);
+#endif
+	return p;
+}
+
+
+void SecurePool::unmap_guarded(char* p, const size_t size)
+{
+	size_t usable = round_up(std::max<size_t>(size, 1), _page_size);
+	
+	secure_wipe(p, usable);
+	munlock(p, usable);
+	munmap(p - _page_size, usable + 2 * _page_size);
+}
+
+
+void SecurePool::add_region()
+{
+	bool locked = false;
+	char* p = map_guarded(_region_size, &locked);
+	try {
+		_regions.push_back(p);
+		
+		size_t n = _region_size / _slot_size;
+		_free.reserve(_free.size() + n);
+		// Hand out the lowest addresses first.
+		for (size_t i = n; i > 0; i--) {
+			_free.push_back(p + (i - 1) * _slot_size);
+		}
+		_fresh += n;
+		_usage.slots += n;
+	}
+	catch (...) {
+		if (!_regions.empty() && _regions.back() == p) {
+			_regions.pop_back();
+		}
+		unmap_guarded(p, _region_size);
+		throw;
+	}
+	
+	_usage.regions++;
+	if (!locked) {
+		_usage.unlocked_regions++;
+	}
+}
+
+
+SecureBuffer::SecureBuffer(const size_t size, shared_ptr<SecurePool> pool)
+	:	_pool(pool ? pool : SecurePool::shared()),
+		_data(NULL),
+		_size(size)
+{
+	_data = _pool->acquire(_size);
+}
+
+
+SecureBuffer::~SecureBuffer()
+{
+	_pool->release(_data, _size);
+}
+
+} /* namespace kadm5 */
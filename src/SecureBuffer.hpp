@@ -0,0 +1,274 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+#ifndef SECUREBUFFER_HPP_
+#define SECUREBUFFER_HPP_
+
+// STL and Boost
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace kadm5
+{
+
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+/**
+ * Overwrite memory with zeros in a way the compiler may not optimize away,
+ * even if the memory is never read again.
+ * 
+ * Uses <code>explicit_bzero</code> if the library was built with
+ * <code>HAVE_EXPLICIT_BZERO</code> (glibc 2.25 and later, the BSDs), and
+ * volatile stores otherwise.
+ * 
+ * \param	p	The memory to wipe.
+ * \param	size	The number of bytes to wipe.
+ **/
+void secure_wipe(void* p, const size_t size);
+
+/**
+ * \brief
+ * Pool of memory for secrets (e.g., passwords) that is locked into RAM,
+ * fenced by guard pages and wiped on release.
+ * 
+ * The pool maps regions of memory with <code>mmap</code>, each framed by
+ * two inaccessible guard pages so overruns at either end fault instead of
+ * reading or corrupting neighbouring data. The regions are locked with
+ * <code>mlock</code> so their contents never reach swap space (and, where
+ * supported, excluded from core dumps). If the process may not lock that
+ * much memory, the region is used unlocked; usage() reports this.
+ * 
+ * Regions are divided into fixed-size slots. Released slots are wiped
+ * and reused, so many short-lived secrets (e.g., in bulk password
+ * changes) need neither <code>malloc</code> nor system calls. Requests
+ * larger than a slot get a guarded mapping of their own, which is
+ * returned to the system on release.
+ * 
+ * Slots within a region are not separated by guard pages.
+ * 
+ * \note
+ * The pool is thread-safe. Use SecureBuffer rather than acquire() and
+ * release() directly.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class SecurePool : public boost::noncopyable
+{
+public:
+	/**
+	 * \brief
+	 * Usage statistics of a SecurePool.
+	 **/
+	struct Usage
+	{
+		/** Number of mapped regions. */
+		size_t regions;
+		/** Number of regions that could not be locked into RAM. */
+		size_t unlocked_regions;
+		/** Total number of slots. */
+		size_t slots;
+		/** Number of slots currently handed out. */
+		size_t slots_in_use;
+		/** Highest number of slots handed out at once. */
+		size_t peak_slots_in_use;
+		/** Number of oversized buffers currently handed out. */
+		size_t oversized_in_use;
+		/** Number of buffers handed out so far. */
+		size_t acquired;
+		/** Number of those served by a previously used slot. */
+		size_t reused;
+	};
+	
+	/** Default slot size; enough for passwords of 127 characters. */
+	static const size_t default_slot_size = 128;
+	/** Default number of pages usable for slots per region. */
+	static const size_t default_region_pages = 16;
+	
+	/**
+	 * Creates an empty pool; regions are mapped on demand.
+	 * 
+	 * \param	slot_size	The size of the slots in bytes. Rounded
+	 * 			up to a multiple of 16.
+	 * \param	region_pages	The number of pages per region usable
+	 * 			for slots (not counting the guard pages).
+	 **/
+	explicit SecurePool(
+		const size_t slot_size =default_slot_size,
+		const size_t region_pages =default_region_pages
+	);
+	
+	/**
+	 * Destructor. Wipes and unmaps all regions.
+	 **/
+	~SecurePool();
+	
+	/**
+	 * Get the process-wide pool used by default.
+	 * 
+	 * \return	a smart pointer to the shared pool.
+	 **/
+	static shared_ptr<SecurePool> shared();
+	
+	/**
+	 * Hand out zeroed memory of at least the given size.
+	 * 
+	 * \param	size	The number of bytes needed.
+	 * \return	the memory.
+	 **/
+	char* acquire(const size_t size);
+	
+	/**
+	 * Wipe memory from acquire() and take it back.
+	 * 
+	 * \param	p	The memory.
+	 * \param	size	The size it was acquired with.
+	 **/
+	void release(char* p, const size_t size);
+	
+	/**
+	 * Get the size of the slots.
+	 * 
+	 * \return	the slot size in bytes.
+	 **/
+	const size_t slot_size() const { return _slot_size; }
+	
+	/**
+	 * Get the pool's usage statistics.
+	 * 
+	 * \return	a snapshot of the statistics.
+	 **/
+	const Usage usage() const;
+
+private:
+	/**
+	 * Map memory framed by guard pages and lock it into RAM.
+	 * 
+	 * \param	size	The number of usable bytes.
+	 * \param	locked	Receives whether locking succeeded.
+	 * \return	the start of the usable memory.
+	 **/
+	char* map_guarded(const size_t size, bool* locked);
+	
+	/**
+	 * Wipe and unmap memory from map_guarded().
+	 * 
+	 * \param	p	The start of the usable memory.
+	 * \param	size	The number of usable bytes.
+	 **/
+	void unmap_guarded(char* p, const size_t size);
+	
+	/**
+	 * Map another region and add its slots to the free list. Call with
+	 * _mutex held.
+	 **/
+	void add_region();
+	
+	/** Size of the slots in bytes. */
+	size_t _slot_size;
+	/** Usable bytes per region. */
+	size_t _region_size;
+	/** The system's page size. */
+	size_t _page_size;
+	/** Start of each region's usable memory. */
+	vector<char*> _regions;
+	/** Slots ready for use; the most recently released last. */
+	vector<char*> _free;
+	/** Number of never used slots, at the bottom of _free. */
+	size_t _fresh;
+	/** Usage statistics. */
+	Usage _usage;
+	/** Guards all members. */
+	mutable boost::mutex _mutex;
+};
+
+
+/**
+ * \brief
+ * Fixed-size buffer for a secret, allocated from a SecurePool.
+ * 
+ * The buffer starts out zeroed and is wiped when destroyed. It cannot be
+ * copied; share it through smart pointers instead.
+ * 
+ * \author Peter Dinges <pdinges@acm.org>
+ **/
+class SecureBuffer : public boost::noncopyable
+{
+public:
+	/**
+	 * Allocates a zeroed buffer.
+	 * 
+	 * \param	size	The size of the buffer in bytes.
+	 * \param	pool	The pool to allocate from. Uses
+	 * 			SecurePool::shared() if empty.
+	 **/
+	explicit SecureBuffer(
+		const size_t size,
+		shared_ptr<SecurePool> pool =shared_ptr<SecurePool>()
+	);
+	
+	/**
+	 * Wipes the buffer and returns its memory to the pool.
+	 **/
+	~SecureBuffer();
+	
+	/**
+	 * Get the buffer's memory.
+	 * 
+	 * \return	the start of the buffer.
+	 **/
+	char* data() const { return _data; }
+	
+	/**
+	 * Get the buffer's size.
+	 * 
+	 * \return	the size in bytes.
+	 **/
+	const size_t size() const { return _size; }
+
+private:
+	/** The pool the memory came from. */
+	shared_ptr<SecurePool> _pool;
+	/** The buffer's memory. */
+	char* _data;
+	/** The buffer's size. */
+	size_t _size;
+};
+
+} /* namespace kadm5 */
+
+#endif /*SECUREBUFFER_HPP_*/
@@ -0,0 +1,120 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+/*
+ * Measures how long opening a Connection takes with a password (one AS
+ * exchange per Connection) and with a keytab (one AS exchange, then the
+ * shared in-memory ticket is reused).
+ * 
+ * Usage: ConnectionSetupBench [iterations]
+ */
+
+// STL and Boost
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../Connection.hpp"
+#include "../Error.hpp"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+
+static const string CLIENT = "user/admin";
+static const string PASSWORD = "admin";
+static const string KEYTAB = "FILE:./data/admin.keytab";
+
+
+/**
+ * Open and close the given number of Connections.
+ * 
+ * \param	keytab	If true, use from_keytab(); otherwise
+ * 			from_password().
+ * \param	n	The number of Connections to open.
+ * \return	the total time taken.
+ **/
+static time_duration run(const bool keytab, const int n)
+{
+	ptime start = microsec_clock::universal_time();
+	for (int i = 0; i < n; i++) {
+		shared_ptr<kadm5::Connection> pc = keytab ?
+			kadm5::Connection::from_keytab(KEYTAB, CLIENT) :
+			kadm5::Connection::from_password(PASSWORD, CLIENT);
+	}
+	return microsec_clock::universal_time() - start;
+}
+
+
+/**
+ * Print the total and per-Connection setup time.
+ * 
+ * \param	name	The name of the measured Context type.
+ * \param	t	The total time taken.
+ * \param	n	The number of Connections opened.
+ **/
+static void report(const string& name, const time_duration& t, const int n)
+{
+	std::cout << name << ": " << n << " connections in "
+		<< t.total_milliseconds() << " ms ("
+		<< t.total_microseconds() / n << " us each)" << std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 50;
+	if (n <= 0) {
+		n = 50;
+	}
+	
+	try {
+		// Warm up (and fetch the shared keytab ticket once).
+		run(false, 1);
+		run(true, 1);
+		
+		report("PasswordContext", run(false, n), n);
+		report("KeytabContext  ", run(true, n), n);
+	}
+	catch (const kadm5::error& e) {
+		std::cerr << "kadm5 error " << e.error_code() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
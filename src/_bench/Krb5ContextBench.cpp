@@ -0,0 +1,139 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+/*
+ * Measures the per-Context setup cost with a private Kerberos context for
+ * each Context and with one shared Krb5Context: once for lazy Contexts
+ * (no KAdmin handshake, so only the local setup is timed) and once for
+ * connected ones.
+ * 
+ * Usage: Krb5ContextBench [iterations]
+ */
+
+// STL and Boost
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../CCacheContext.hpp"
+#include "../Error.hpp"
+#include "../Krb5Context.hpp"
+#include "../MemoryCCache.hpp"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+
+static const string CLIENT = "user/admin";
+static const string PASSWORD = "admin";
+
+
+/**
+ * Create and destroy the given number of Contexts using the credentials
+ * in the given cache.
+ * 
+ * \param	ccname	The credential cache to use.
+ * \param	shared	If true, all Contexts use the process-wide
+ * 			Krb5Context; otherwise each gets its own one.
+ * \param	lazy	If true, the Contexts do not connect.
+ * \param	n	The number of Contexts to create.
+ * \return	the total time taken.
+ **/
+static time_duration run(
+	const string& ccname,
+	const bool shared,
+	const bool lazy,
+	const int n
+) {
+	ptime start = microsec_clock::universal_time();
+	for (int i = 0; i < n; i++) {
+		kadm5::CCacheContext c(
+			ccname, "", "", 0, lazy,
+			shared ? kadm5::Krb5Context::shared() :
+				kadm5::Krb5Context::create()
+		);
+	}
+	return microsec_clock::universal_time() - start;
+}
+
+
+/**
+ * Print the total and per-Context setup time.
+ * 
+ * \param	name	The name of the measured variant.
+ * \param	t	The total time taken.
+ * \param	n	The number of Contexts created.
+ **/
+static void report(const string& name, const time_duration& t, const int n)
+{
+	std::cout << name << ": " << n << " contexts in "
+		<< t.total_milliseconds() << " ms ("
+		<< t.total_microseconds() / n << " us each)" << std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 200;
+	if (n <= 0) {
+		n = 200;
+	}
+	
+	try {
+		shared_ptr<kadm5::MemoryCCache> pcc =
+			kadm5::MemoryCCache::from_password(PASSWORD.c_str(), CLIENT, "");
+		
+		// Warm up (and initialize the shared context).
+		run(pcc->name(), true, false, 1);
+		
+		report("lazy, private context     ",
+			run(pcc->name(), false, true, n), n);
+		report("lazy, shared context      ",
+			run(pcc->name(), true, true, n), n);
+		report("connected, private context",
+			run(pcc->name(), false, false, n), n);
+		report("connected, shared context ",
+			run(pcc->name(), true, false, n), n);
+	}
+	catch (const kadm5::error& e) {
+		std::cerr << "kadm5 error " << e.error_code() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
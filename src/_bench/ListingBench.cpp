@@ -0,0 +1,188 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+/*
+ * Compares listing all principals with a single request
+ * (Connection::list_principals()) against the partitioned listing over
+ * several connections (Connection::stream_principals_partitioned()): time
+ * until the first name is available and total time. The partitioned
+ * listing runs twice, the second time with the hot prefixes learned by the
+ * first.
+ * 
+ * The realm is populated with the given number of bench/N and
+ * host/benchN.test.local principals first (once; they are kept).
+ * 
+ * Usage: ListingBench [principals] [handles]
+ */
+
+// STL and Boost
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../Connection.hpp"
+#include "../Error.hpp"
+#include "../PartitionedNameStream.hpp"
+#include "../Principal.hpp"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+static const string CLIENT = "user/admin";
+static const string PASSWORD = "admin";
+
+
+/**
+ * Create the bench principals that do not exist yet.
+ * 
+ * \param	conn	The Connection to use.
+ * \param	n	The number of principals per name pattern.
+ **/
+static void populate(const kadm5::Connection& conn, const int n)
+{
+	if (conn.list_principals("bench/*")->size() >= (size_t) n) {
+		return;
+	}
+	
+	vector< shared_ptr<kadm5::Principal> > batch;
+	for (int i = 0; i < n; i++) {
+		std::ostringstream user, host;
+		user << "bench/" << i;
+		host << "host/bench" << i << ".test.local";
+		
+		const string names[] = { user.str(), host.str() };
+		for (int j = 0; j < 2; j++) {
+			shared_ptr<kadm5::Principal> pp = conn.create_principal(
+				names[j], "", kadm5::Connection::create_optimistic
+			);
+			pp->randomize_keys();
+			batch.push_back(pp);
+		}
+	}
+	// Already existing ones fail; that is fine.
+	conn.commit_batch(batch, 8);
+}
+
+
+/**
+ * Print the time to the first name and the total time of a listing.
+ * 
+ * \param	name	The name of the measured variant.
+ * \param	first	The time until the first name was available.
+ * \param	total	The total time taken.
+ * \param	count	The number of names listed.
+ **/
+static void report(
+	const string& name,
+	const time_duration& first,
+	const time_duration& total,
+	const size_t count
+) {
+	std::cout << name << ": " << count << " names, first after "
+		<< first.total_milliseconds() << " ms, all after "
+		<< total.total_milliseconds() << " ms" << std::endl;
+}
+
+
+/**
+ * Measure the partitioned listing and report it.
+ * 
+ * \param	name	The name of the measured variant.
+ * \param	conn	The Connection to use.
+ * \param	handles	The number of connections to list with.
+ **/
+static void run_partitioned(
+	const string& name,
+	const kadm5::Connection& conn,
+	const unsigned int handles
+) {
+	ptime start = microsec_clock::universal_time();
+	shared_ptr<kadm5::PartitionedNameStream> ps =
+		conn.stream_principals_partitioned("*", handles);
+	
+	string s;
+	size_t count = 0;
+	time_duration first;
+	while (ps->next(s)) {
+		if (count++ == 0) {
+			first = microsec_clock::universal_time() - start;
+		}
+	}
+	report(name, first, microsec_clock::universal_time() - start, count);
+}
+
+
+int main(int argc, char** argv)
+{
+	// Enough for the b* and h* partitions to become hot.
+	int n = (argc > 1) ? atoi(argv[1]) : 5000;
+	if (n <= 0) {
+		n = 5000;
+	}
+	int handles = (argc > 2) ? atoi(argv[2]) : 4;
+	if (handles <= 0) {
+		handles = 4;
+	}
+	
+	try {
+		shared_ptr<kadm5::Connection> pconn =
+			kadm5::Connection::from_password(PASSWORD, CLIENT);
+		populate(*pconn, n);
+		
+		ptime start = microsec_clock::universal_time();
+		shared_ptr< vector<string> > pnames =
+			pconn->list_principals("*");
+		time_duration t = microsec_clock::universal_time() - start;
+		// The single reply holds all names at once.
+		report("single request          ", t, t, pnames->size());
+		
+		run_partitioned("partitioned, cold       ", *pconn, handles);
+		run_partitioned("partitioned, hot split  ", *pconn, handles);
+		run_partitioned("partitioned, 1 handle   ", *pconn, 1);
+	}
+	catch (const kadm5::error& e) {
+		std::cerr << "kadm5 error " << e.error_code() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,222 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+/*
+ * Lists all principals repeatedly, once copying the names into strings
+ * (Connection::list_principals()) and once keeping them in the library's
+ * buffer (Connection::list_names()). Reports the growth of the resident
+ * set size over all repetitions, which stays flat unless listings leak,
+ * and the number of C++ heap allocations (operator new) and the time per
+ * listing.
+ * 
+ * The realm is populated with the given number of bench/N principals
+ * first (once; they are kept). Reading the resident set size needs
+ * /proc (Linux).
+ * 
+ * Usage: NameListBench [principals] [repetitions]
+ */
+
+// STL and Boost
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../Connection.hpp"
+#include "../Error.hpp"
+#include "../NameList.hpp"
+#include "../Principal.hpp"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+static const string CLIENT = "user/admin";
+static const string PASSWORD = "admin";
+
+/** Number of operator new calls so far; the bench is single-threaded. */
+static unsigned long allocations = 0;
+
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+
+/**
+ * Get the process' resident set size.
+ * 
+ * \return	the resident set size in KiB, or 0 if unknown.
+ **/
+static long resident_kib()
+{
+	std::ifstream statm("/proc/self/statm");
+	long size = 0, resident = 0;
+	if (!(statm >> size >> resident)) {
+		return 0;
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+
+/**
+ * Create the bench principals that do not exist yet.
+ * 
+ * \param	conn	The Connection to use.
+ * \param	n	The number of principals.
+ **/
+static void populate(const kadm5::Connection& conn, const int n)
+{
+	if (conn.list_names("bench/*")->size() >= (size_t) n) {
+		return;
+	}
+	
+	vector< shared_ptr<kadm5::Principal> > batch;
+	for (int i = 0; i < n; i++) {
+		std::ostringstream name;
+		name << "bench/" << i;
+		shared_ptr<kadm5::Principal> pp = conn.create_principal(
+			name.str(), "", kadm5::Connection::create_optimistic
+		);
+		pp->randomize_keys();
+		batch.push_back(pp);
+	}
+	// Already existing ones fail; that is fine.
+	conn.commit_batch(batch, 8);
+}
+
+
+/**
+ * Print the results of a variant.
+ * 
+ * \param	name	The name of the measured variant.
+ * \param	count	The number of names per listing.
+ * \param	growth	The resident set growth in KiB.
+ * \param	allocs	The number of allocations.
+ * \param	t	The time taken.
+ * \param	repeat	The number of listings.
+ **/
+static void report(
+	const string& name,
+	const size_t count,
+	const long growth,
+	const unsigned long allocs,
+	const time_duration& t,
+	const int repeat
+) {
+	std::cout << name << ": " << count << " names, RSS +" << growth
+		<< " KiB, " << allocs / repeat << " allocations and "
+		<< t.total_microseconds() / repeat << " us per listing"
+		<< std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 5000;
+	if (n <= 0) {
+		n = 5000;
+	}
+	int repeat = (argc > 2) ? atoi(argv[2]) : 200;
+	if (repeat <= 0) {
+		repeat = 200;
+	}
+	
+	try {
+		shared_ptr<kadm5::Connection> pconn =
+			kadm5::Connection::from_password(PASSWORD, CLIENT);
+		populate(*pconn, n);
+		
+		// Warm up so the allocator's pools exist before measuring.
+		size_t count = pconn->list_principals("*")->size();
+		pconn->list_names("*");
+		
+		long rss = resident_kib();
+		unsigned long before = allocations;
+		ptime start = microsec_clock::universal_time();
+		for (int i = 0; i < repeat; i++) {
+			pconn->list_principals("*");
+		}
+		report(
+			"list_principals",
+			count,
+			resident_kib() - rss,
+			allocations - before,
+			microsec_clock::universal_time() - start,
+			repeat
+		);
+		
+		rss = resident_kib();
+		before = allocations;
+		start = microsec_clock::universal_time();
+		for (int i = 0; i < repeat; i++) {
+			pconn->list_names("*");
+		}
+		report(
+			"list_names     ",
+			count,
+			resident_kib() - rss,
+			allocations - before,
+			microsec_clock::universal_time() - start,
+			repeat
+		);
+	}
+	catch (const kadm5::error& e) {
+		std::cerr << "kadm5 error " << e.error_code() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
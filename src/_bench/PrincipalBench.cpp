@@ -0,0 +1,351 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+/*
+ * Measures building and sorting (by name) large vectors of Principals:
+ * held by shared_ptr, held by value and sorted with the copying
+ * standard swap (as before Principal::swap() existed), and held by value
+ * and sorted with Principal::swap(). Reports the number of C++ heap
+ * allocations (operator new), the number of deep Principal copies and the
+ * time of each step; allocations by the Kerberos libraries (malloc) are not
+ * counted. Before C++11, std::sort copies the elements it holds aside
+ * (e.g., in its insertion sort phase) even with Principal::swap(); from
+ * C++11 on, it moves them with Principal's move constructor.
+ * 
+ * No KAdmin connection is opened; the Principals are only created
+ * locally.
+ * 
+ * Usage: PrincipalBench [principals]
+ */
+
+// STL and Boost
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../CCacheContext.hpp"
+#include "../Error.hpp"
+#include "../Principal.hpp"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+/** Number of operator new calls so far; the bench is single-threaded. */
+static unsigned long allocations = 0;
+/** Number of Principal copy constructions and assignments so far. */
+static unsigned long copies = 0;
+
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+
+/**
+ * Principal held by value, but exchanged by copying like any type
+ * without a swap() of its own. Counts its copies.
+ **/
+struct CopiedPrincipal
+{
+	explicit CopiedPrincipal(const kadm5::Principal& p) : principal(p) {}
+	
+	CopiedPrincipal(const CopiedPrincipal& p) : principal(p.principal)
+	{
+		copies++;
+	}
+	
+	CopiedPrincipal& operator=(const CopiedPrincipal& p)
+	{
+		principal = p.principal;
+		copies++;
+		return *this;
+	}
+	
+	kadm5::Principal principal;
+};
+
+
+/**
+ * Principal held by value and exchanged with Principal::swap(). Counts
+ * the copies that remain.
+ **/
+struct SwappedPrincipal
+{
+	explicit SwappedPrincipal(const kadm5::Principal& p) : principal(p) {}
+	
+	SwappedPrincipal(const SwappedPrincipal& p) : principal(p.principal)
+	{
+		copies++;
+	}
+	
+	SwappedPrincipal& operator=(const SwappedPrincipal& p)
+	{
+		principal = p.principal;
+		copies++;
+		return *this;
+	}
+	
+#if __cplusplus >= 201103L
+	SwappedPrincipal(SwappedPrincipal&& p) noexcept
+		: principal(std::move(p.principal)) {}
+	
+	SwappedPrincipal& operator=(SwappedPrincipal&& p) noexcept
+	{
+		principal = std::move(p.principal);
+		return *this;
+	}
+#endif
+	
+	kadm5::Principal principal;
+};
+
+
+inline void swap(SwappedPrincipal& a, SwappedPrincipal& b)
+{
+	a.principal.swap(b.principal);
+}
+
+
+namespace std
+{
+
+template<>
+inline void swap(SwappedPrincipal& a, SwappedPrincipal& b)
+{
+	a.principal.swap(b.principal);
+}
+
+} /* namespace std */
+
+
+/** Orders shared Principals by name. */
+static bool by_shared_name(
+	const shared_ptr<kadm5::Principal>& a,
+	const shared_ptr<kadm5::Principal>& b
+) {
+	return a->name() < b->name();
+}
+
+
+/** Orders copied Principals by name. */
+static bool by_copied_name(const CopiedPrincipal& a, const CopiedPrincipal& b)
+{
+	return a.principal.name() < b.principal.name();
+}
+
+
+/** Orders swapped Principals by name. */
+static bool by_swapped_name(
+	const SwappedPrincipal& a,
+	const SwappedPrincipal& b
+) {
+	return a.principal.name() < b.principal.name();
+}
+
+
+/**
+ * Print the allocations, Principal copies and time of a step.
+ * 
+ * \param	name	The name of the measured step.
+ * \param	allocs	The number of allocations.
+ * \param	copied	The number of Principal copies.
+ * \param	t	The time taken.
+ **/
+static void report(
+	const string& name,
+	const unsigned long allocs,
+	const unsigned long copied,
+	const time_duration& t
+) {
+	std::cout << name << ": " << allocs << " allocations, "
+		<< copied << " copies, "
+		<< t.total_milliseconds() << " ms" << std::endl;
+}
+
+
+/**
+ * Generate shuffled names so sorting has work to do.
+ * 
+ * \param	n	The number of names.
+ * \return	the names.
+ **/
+static vector<string> make_names(const int n)
+{
+	vector<string> names;
+	names.reserve(n);
+	for (int i = 0; i < n; i++) {
+		std::ostringstream name;
+		name << "bench/" << i;
+		names.push_back(name.str());
+	}
+	// Shuffle with a fixed seed; std::random_shuffle is gone in C++17,
+	// and std::shuffle does not exist in C++03.
+	boost::mt19937 generator(1);
+	for (size_t i = names.size(); i > 1; i--) {
+		std::swap(names[i - 1], names[generator() % i]);
+	}
+	return names;
+}
+
+
+int main(int argc, char** argv)
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 100000;
+	if (n <= 0) {
+		n = 100000;
+	}
+	
+	try {
+		// Principals need a Kerberos context only; don't connect.
+		shared_ptr<kadm5::Context> pc(
+			new kadm5::CCacheContext(
+				"MEMORY:principal-bench", "", "", 0, true
+			)
+		);
+		vector<string> names = make_names(n);
+		
+		{
+			unsigned long before = allocations;
+			ptime start = microsec_clock::universal_time();
+			vector< shared_ptr<kadm5::Principal> > v;
+			v.reserve(n);
+			for (int i = 0; i < n; i++) {
+				v.push_back(
+					shared_ptr<kadm5::Principal>(
+						new kadm5::Principal(pc, names[i])
+					)
+				);
+			}
+			report(
+				"shared_ptr: build",
+				allocations - before,
+				0,
+				microsec_clock::universal_time() - start
+			);
+			
+			before = allocations;
+			start = microsec_clock::universal_time();
+			std::sort(v.begin(), v.end(), by_shared_name);
+			report(
+				"shared_ptr: sort ",
+				allocations - before,
+				0,
+				microsec_clock::universal_time() - start
+			);
+		}
+		
+		{
+			// Built like the by-value vector below; only sorting
+			// differs.
+			vector<CopiedPrincipal> v;
+			v.reserve(n);
+			for (int i = 0; i < n; i++) {
+				kadm5::Principal p(pc, names[i]);
+				v.push_back(CopiedPrincipal(p));
+			}
+			
+			unsigned long before = allocations;
+			unsigned long copied = copies;
+			ptime start = microsec_clock::universal_time();
+			std::sort(v.begin(), v.end(), by_copied_name);
+			report(
+				"copying:    sort ",
+				allocations - before,
+				copies - copied,
+				microsec_clock::universal_time() - start
+			);
+		}
+		
+		{
+			unsigned long before = allocations;
+			unsigned long copied = copies;
+			ptime start = microsec_clock::universal_time();
+			// Before C++11, push_back() copies each Principal
+			// once; then it moves them.
+			vector<SwappedPrincipal> v;
+			v.reserve(n);
+			for (int i = 0; i < n; i++) {
+				kadm5::Principal p(pc, names[i]);
+				v.push_back(SwappedPrincipal(p));
+			}
+			report(
+				"by value:   build",
+				allocations - before,
+				copies - copied,
+				microsec_clock::universal_time() - start
+			);
+			
+			before = allocations;
+			copied = copies;
+			start = microsec_clock::universal_time();
+			std::sort(v.begin(), v.end(), by_swapped_name);
+			report(
+				"by value:   sort ",
+				allocations - before,
+				copies - copied,
+				microsec_clock::universal_time() - start
+			);
+		}
+	}
+	catch (const kadm5::error& e) {
+		std::cerr << "kadm5 error " << e.error_code() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
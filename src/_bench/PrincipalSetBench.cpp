@@ -0,0 +1,211 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+/*
+ * Compares reading many entries as Principal objects
+ * (Connection::get_principals() with prefetching) against reading them
+ * into a PrincipalSet (Connection::get_principal_set()): number of C++
+ * heap allocations (operator new) and time for loading, reading one
+ * attribute of every entry, and releasing the result. Allocations made by
+ * the Kerberos libraries with malloc() are not counted.
+ * 
+ * The realm is populated with the given number of bench/N principals
+ * first (once; they are kept).
+ * 
+ * Usage: PrincipalSetBench [principals]
+ */
+
+// STL and Boost
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../Connection.hpp"
+#include "../Error.hpp"
+#include "../Principal.hpp"
+#include "../PrincipalSet.hpp"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using boost::posix_time::time_duration;
+using boost::shared_ptr;
+using std::string;
+using std::vector;
+
+static const string CLIENT = "user/admin";
+static const string PASSWORD = "admin";
+static const u_int32_t FIELDS =
+	KADM5_PRINCIPAL | KADM5_PRINC_EXPIRE_TIME | KADM5_MOD_TIME;
+
+/** Number of operator new calls so far; the bench is single-threaded. */
+static unsigned long allocations = 0;
+
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+
+/**
+ * Create the bench principals that do not exist yet.
+ * 
+ * \param	conn	The Connection to use.
+ * \param	n	The number of principals.
+ **/
+static void populate(const kadm5::Connection& conn, const int n)
+{
+	if (conn.list_principals("bench/*")->size() >= (size_t) n) {
+		return;
+	}
+	
+	vector< shared_ptr<kadm5::Principal> > batch;
+	for (int i = 0; i < n; i++) {
+		std::ostringstream name;
+		name << "bench/" << i;
+		shared_ptr<kadm5::Principal> pp = conn.create_principal(
+			name.str(), "", kadm5::Connection::create_optimistic
+		);
+		pp->randomize_keys();
+		batch.push_back(pp);
+	}
+	// Already existing ones fail; that is fine.
+	conn.commit_batch(batch, 8);
+}
+
+
+/**
+ * Print the allocations and times of a variant.
+ * 
+ * \param	name	The name of the measured variant.
+ * \param	count	The number of entries read.
+ * \param	allocs	The number of allocations while loading and reading.
+ * \param	load	The time taken to load and read the entries.
+ * \param	release	The time taken to release the result.
+ **/
+static void report(
+	const string& name,
+	const size_t count,
+	const unsigned long allocs,
+	const time_duration& load,
+	const time_duration& release
+) {
+	std::cout << name << ": " << count << " entries, " << allocs
+		<< " allocations (" << (count ? allocs / count : 0)
+		<< " per entry), load " << load.total_milliseconds()
+		<< " ms, release " << release.total_microseconds() << " us"
+		<< std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 5000;
+	if (n <= 0) {
+		n = 5000;
+	}
+	
+	try {
+		shared_ptr<kadm5::Connection> pconn =
+			kadm5::Connection::from_password(PASSWORD, CLIENT);
+		populate(*pconn, n);
+		
+		// Warm up: fetch the privileges and the realm's template.
+		pconn->get_principals("bench/1", 1, FIELDS);
+		
+		{
+			unsigned long before = allocations;
+			ptime start = microsec_clock::universal_time();
+			shared_ptr< vector< shared_ptr<kadm5::Principal> > > pv =
+				pconn->get_principals("bench/*", 1, FIELDS);
+			for (size_t i = 0; i < pv->size(); i++) {
+				(*pv)[i]->expire_time();
+			}
+			ptime loaded = microsec_clock::universal_time();
+			unsigned long allocs = allocations - before;
+			size_t count = pv->size();
+			pv.reset();
+			report(
+				"Principal objects",
+				count,
+				allocs,
+				loaded - start,
+				microsec_clock::universal_time() - loaded
+			);
+		}
+		
+		{
+			unsigned long before = allocations;
+			ptime start = microsec_clock::universal_time();
+			shared_ptr<kadm5::PrincipalSet> ps =
+				pconn->get_principal_set("bench/*", FIELDS);
+			for (size_t i = 0; i < ps->size(); i++) {
+				(*ps)[i].expire_time();
+			}
+			ptime loaded = microsec_clock::universal_time();
+			unsigned long allocs = allocations - before;
+			size_t count = ps->size();
+			ps.reset();
+			report(
+				"PrincipalSet     ",
+				count,
+				allocs,
+				loaded - start,
+				microsec_clock::universal_time() - loaded
+			);
+		}
+	}
+	catch (const kadm5::error& e) {
+		std::cerr << "kadm5 error " << e.error_code() << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
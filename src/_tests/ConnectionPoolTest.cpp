@@ -0,0 +1,152 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../ConnectionPool.hpp"
+#include "../Error.hpp"
+#include "../LocalContext.hpp"
+#include "ConnectionPoolTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::ConnectionPoolTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+using boost::posix_time::millisec;
+using boost::posix_time::seconds;
+
+/**
+ * LocalContext whose database can be closed for good, so the pool's
+ * health check fails. Its clones work normally.
+ **/
+class BreakableContext : public LocalContext
+{
+public:
+	BreakableContext() : LocalContext("", "", ""), _broken(false) {}
+	
+	void break_connection()
+	{
+		_broken = true;
+		set_kadm_handle( shared_ptr<void>() );
+	}
+
+protected:
+	virtual void open_handle()
+	{
+		if (_broken) {
+			throw not_initialized(KADM5_NOT_INIT);
+		}
+		LocalContext::open_handle();
+	}
+
+private:
+	bool _broken;
+};
+
+
+static shared_ptr<ConnectionPool> local_pool(const size_t size)
+{
+	// Works on ./data/test.db directly; needs no kadmind.
+	return ConnectionPool::from_context(
+		size, shared_ptr<Context>( new LocalContext("", "", "") )
+	);
+}
+
+
+void ConnectionPoolTest::testRelease()
+{
+	shared_ptr<ConnectionPool> pool = local_pool(1);
+	Connection* pleased = NULL;
+	{
+		shared_ptr<Connection> conn = pool->acquire();
+		pleased = conn.get();
+		CPPUNIT_ASSERT_MESSAGE(
+			"Leased Connection is not counted as in use.",
+			pool->statistics().in_use == 1
+		);
+	}
+	CPPUNIT_ASSERT_MESSAGE(
+		"Released Connection is still counted as in use.",
+		pool->statistics().in_use == 0
+	);
+	
+	shared_ptr<Connection> again = pool->acquire(seconds(0));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Released Connection was not handed out again.",
+		again.get() == pleased && pool->statistics().open == 1
+	);
+}
+
+
+void ConnectionPoolTest::testTimeout()
+{
+	shared_ptr<ConnectionPool> pool = local_pool(1);
+	shared_ptr<Connection> conn = pool->acquire();
+	
+	CPPUNIT_ASSERT_THROW(
+		pool->acquire(millisec(50)),
+		pool_exhausted
+	);
+	ConnectionPool::Statistics s = pool->statistics();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Timed out acquire() is missing from the statistics.",
+		s.timeouts == 1 && s.waits == 1 &&
+		s.max_wait > seconds(0) && s.max_wait == s.total_wait
+	);
+}
+
+
+void ConnectionPoolTest::testReplace()
+{
+	shared_ptr<BreakableContext> pc( new BreakableContext );
+	shared_ptr<ConnectionPool> pool = ConnectionPool::from_context(1, pc);
+	// Check every Connection before handing it out.
+	pool->set_check_interval(seconds(0));
+	
+	pc->break_connection();
+	shared_ptr<Connection> conn = pool->acquire();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Broken Connection was not replaced.",
+		pool->statistics().replacements == 1 && conn->may_list()
+	);
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
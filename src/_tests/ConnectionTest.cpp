@@ -0,0 +1,173 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../Connection.hpp"
+#include "../Error.hpp"
+#include "../Principal.hpp"
+#include "ConnectionTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::ConnectionTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+// Part of data/test.db; see Makefile.
+static const char* TAKEN = "host/a.test.local";
+// Not part of data/test.db; removed again after each test.
+static const char* BATCHED[] = {
+	"test/batch-1.test.local",
+	"test/batch-2.test.local"
+};
+
+
+void ConnectionTest::tearDown()
+{
+	// Keep the known population of data/test.db.
+	shared_ptr<Connection> pc = Connection::from_local();
+	for (size_t i = 0; i < sizeof(BATCHED) / sizeof(BATCHED[0]); i++) {
+		try {
+			pc->delete_principal(BATCHED[i]);
+		}
+		catch (const error&) {
+			// Not created.
+		}
+	}
+}
+
+
+void ConnectionTest::testCreateChecked()
+{
+	// Works on ./data/test.db directly; needs no kadmind.
+	shared_ptr<Connection> pc = Connection::from_local();
+	CPPUNIT_ASSERT_THROW(
+		pc->create_principal(TAKEN, "secret"),
+		already_exists
+	);
+}
+
+
+void ConnectionTest::testCreateOptimistic()
+{
+	shared_ptr<Connection> pc = Connection::from_local();
+	shared_ptr<Principal> pp = pc->create_principal(
+		TAKEN, "secret", Connection::create_optimistic
+	);
+	
+	// Must not fall back to changing the existing entry's password.
+	CPPUNIT_ASSERT_THROW(
+		pp->commit_modifications(),
+		already_exists
+	);
+}
+
+
+void ConnectionTest::testCommitBatch()
+{
+	shared_ptr<Connection> pc = Connection::from_local();
+	vector< shared_ptr<Principal> > batch;
+	batch.push_back( pc->create_principal(BATCHED[0], "secret") );
+	// Fails on commit since the name is taken.
+	batch.push_back(
+		pc->create_principal(
+			TAKEN, "secret", Connection::create_optimistic
+		)
+	);
+	batch.push_back( pc->create_principal(BATCHED[1], "secret") );
+	
+	shared_ptr<Connection::BatchResult> pr = pc->commit_batch(batch, 1);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Batch did not record one result per Principal.",
+		pr->errors.size() == batch.size() &&
+		pr->committed + pr->failed == batch.size()
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Taken name was not reported as failure.",
+		pr->errors[1] == KADM5_DUP && pr->failed == 1
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"A failure stopped the rest of the batch.",
+		pr->errors[0] == 0 && pr->errors[2] == 0 &&
+		pr->committed == 2 &&
+		batch[2]->exists_on_server() &&
+		pc->get_principal(BATCHED[1])->exists_on_server()
+	);
+}
+
+void ConnectionTest::testValueFactories()
+{
+	shared_ptr<Connection> pc = Connection::from_local();
+	const string name = pc->get_principal(TAKEN)->name();
+	
+	Principal exact = pc->get_principal_value(TAKEN);
+	Principal matched = pc->get_principal_value("host/a.test.*");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Principal fetched by value differs.",
+		exact.name() == name && matched.name() == name &&
+		exact.exists_on_server() && matched.exists_on_server()
+	);
+	
+	Principal created = pc->create_principal_value(BATCHED[0], "secret");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Principal created by value exists already.",
+		!created.exists_on_server()
+	);
+	CPPUNIT_ASSERT_THROW(
+		pc->create_principal_value(TAKEN, "secret"),
+		already_exists
+	);
+	
+#if __cplusplus >= 201103L
+	Principal moved( std::move(exact) );
+	exact = std::move(matched);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Moving lost the Principal's data.",
+		moved.name() == name && exact.name() == name &&
+		moved.exists_on_server() && exact.exists_on_server()
+	);
+#endif
+}
+
+
+} /* namespace _test */
+} /* namespace kadm5 */
@@ -33,6 +33,8 @@
 
 // System libs for tests
 #include <stdlib.h>
+#include <string>
+#include <vector>
 
 // Kerberos
 #include <krb5.h>
@@ -68,6 +70,58 @@ public:
 };
 
 
+/**
+ * \brief
+ * Helper class simulating KAdmin servers: connecting to host "down"
+ * fails, connecting to any other host succeeds with a dummy handle.
+ **/
+class FailoverContext : public kadm5::Context
+{
+public:
+	explicit FailoverContext(const std::vector<string>& servers)
+		:	Context("", "", "", 0), connects(0)
+	{
+		set_admin_servers(servers);
+		set_retry_policy(2, boost::posix_time::time_duration());
+		establish_handle();
+	}
+	
+	int connects;
+
+protected:
+	void open_handle()
+	{
+		connects++;
+		if (host() == "down") {
+			throw error(KADM5_RPC_ERROR);
+		}
+		set_kadm_handle( shared_ptr<void>(this, no_delete) );
+	}
+	
+	static void no_delete(void*) {}
+};
+
+
+/**
+ * \brief
+ * Library call stand-in that fails with a connection error the first
+ * given number of times.
+ **/
+struct FlakyCall
+{
+	FlakyCall(int& calls, const int failures)
+		: calls(calls), failures(failures) {}
+	
+	kadm5_ret_t operator()(void*) const
+	{
+		return (calls++ < failures) ? KADM5_RPC_ERROR : 0;
+	}
+	
+	int& calls;
+	const int failures;
+};
+
+
 
 
 void ContextTest::testTypeConversion()
@@ -214,5 +268,97 @@ void ContextTest::testPort()
 	);
 }
 
+
+void ContextTest::testLazyHandle()
+{
+	// Plain Contexts have no KAdmin handle and cannot open one.
+	ContextExpose c("", "", "", 0);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Context without KAdmin handle claims to be connected.",
+		!c.connected()
+	);
+	CPPUNIT_ASSERT_THROW(
+		static_cast<void*>(c),
+		kadm5::not_initialized
+	);
+}
+
+
+void ContextTest::testAdminServers()
+{
+	ContextExpose c("", "", "", 0);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Admin servers are not the ones from ./data/krb5.conf.",
+		c.admin_servers().size() == 1 &&
+		c.admin_servers()[0] == "127.0.0.1:16749"
+	);
+	
+	ContextExpose c2("", "", "custom.kadmin.server", 0);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Given host is not the only admin server.",
+		c2.admin_servers().size() == 1 &&
+		c2.admin_servers()[0] == "custom.kadmin.server"
+	);
+}
+
+
+void ContextTest::testFailover()
+{
+	std::vector<string> servers;
+	servers.push_back("down:1");
+	servers.push_back("up:2");
+	servers.push_back("other:3");
+	
+	FailoverContext c(servers);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Context did not skip the unreachable admin server.",
+		c.connected() && c.host() == "up" && c.port() == 2 &&
+		c.connects == 2
+	);
+	
+	// The failed server is tried last once its latency is known.
+	c.set_endpoint_order(kadm5::Context::endpoints_by_latency);
+	c.reconnect();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Reconnect by latency tried the failed server first.",
+		c.host() == "other" && c.connects == 3
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Reconnect was not counted.",
+		c.reconnects() == 1
+	);
+}
+
+
+void ContextTest::testExecuteRetry()
+{
+	std::vector<string> servers;
+	servers.push_back("up:1");
+	FailoverContext c(servers);
+	
+	int calls = 0;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Idempotent call was not retried after connection errors.",
+		c.execute(FlakyCall(calls, 2), true) == 0 &&
+		calls == 3 && c.reconnects() == 2
+	);
+	
+	// Non-idempotent calls only reconnect.
+	calls = 0;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Non-idempotent call was retried or did not reconnect.",
+		c.execute(FlakyCall(calls, 1), false) == KADM5_RPC_ERROR &&
+		calls == 1 && c.reconnects() == 3
+	);
+	
+	// Give up after the configured number of retries.
+	calls = 0;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Call was retried more often than the retry policy allows.",
+		c.execute(FlakyCall(calls, 10), true) == KADM5_RPC_ERROR &&
+		calls == 3
+	);
+}
+
 } /* namespace _test */
 } /* namespace kadm5 */
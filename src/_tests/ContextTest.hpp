@@ -54,6 +54,10 @@ class ContextTest : public  CPPUNIT_NS::TestFixture
 	CPPUNIT_TEST( testClient );
 	CPPUNIT_TEST( testHost );
 	CPPUNIT_TEST( testPort );
+	CPPUNIT_TEST( testLazyHandle );
+	CPPUNIT_TEST( testAdminServers );
+	CPPUNIT_TEST( testFailover );
+	CPPUNIT_TEST( testExecuteRetry );
 	CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -62,6 +66,10 @@ protected:
 	void testClient();
 	void testHost();
 	void testPort();
+	void testLazyHandle();
+	void testAdminServers();
+	void testFailover();
+	void testExecuteRetry();
 };
 
 } /* namespace _test */
@@ -0,0 +1,113 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <string>
+#include <vector>
+
+// Local
+#include "../HdbScanner.hpp"
+#include "HdbScannerTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::HdbScannerTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+/**
+ * Collect the names of a scanner's entries, in database order.
+ **/
+static vector<string> scan_names(HdbScanner& scanner)
+{
+	vector<string> names;
+	for (HdbScanner::iterator it = scanner.begin();
+			it != scanner.end(); ++it) {
+		names.push_back(it->name());
+	}
+	return names;
+}
+
+
+void HdbScannerTest::testScan()
+{
+	// Uses the database of ./data/krb5.conf, i.e., ./data/test.db.
+	HdbScanner scanner;
+	ScannedPrincipal record;
+	bool found = false;
+	while (scanner.next(record)) {
+		if (record.name() == "host/a.test.local@TEST.LOCAL") {
+			found = true;
+			break;
+		}
+	}
+	CPPUNIT_ASSERT_MESSAGE(
+		"Scan did not find host/a.test.local of data/test.db.",
+		found
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Scanned entry has no keys or modification date.",
+		record.key_version() > 0 &&
+		!record.modify_time().is_special() &&
+		!record.modifier().empty()
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Scanned entry has an expiry date although none was set.",
+		record.expire_time().is_pos_infinity()
+	);
+}
+
+
+void HdbScannerTest::testParallelScan()
+{
+	HdbScanner whole;
+	vector<string> all = scan_names(whole);
+	
+	shared_ptr< vector<ScannedPrincipal> > precords =
+		HdbScanner::scan("", 4);
+	vector<string> names;
+	for (size_t i = 0; i < precords->size(); i++) {
+		names.push_back((*precords)[i].name());
+	}
+	CPPUNIT_ASSERT_MESSAGE(
+		"Parallel scan differs from sequential scan.",
+		names == all
+	);
+}
+
+
+} /* namespace _test */
+} /* namespace kadm5 */
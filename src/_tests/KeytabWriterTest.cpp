@@ -0,0 +1,151 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// System libs for tests
+#include <string.h>
+#include <unistd.h>
+
+// Kerberos
+#include <krb5.h>
+
+// Local
+#include "../Error.hpp"
+#include "../KeytabWriter.hpp"
+#include "KeytabWriterTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::KeytabWriterTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+static const char* KEYTAB = "./data/test.keytab";
+static const char KEY[] = "0123456789abcdef";
+
+
+void KeytabWriterTest::setUp()
+{
+	krb5_init_context(&_context);
+	krb5_parse_name(_context, "host/a.test.local@TEST.LOCAL", &_principal);
+	unlink(KEYTAB);
+}
+
+
+void KeytabWriterTest::tearDown()
+{
+	unlink(KEYTAB);
+	krb5_free_principal(_context, _principal);
+	krb5_free_context(_context);
+}
+
+
+int KeytabWriterTest::count_entries(const string& name)
+{
+	krb5_keytab kt;
+	krb5_kt_cursor cursor;
+	krb5_keytab_entry entry;
+	int n = 0;
+	
+	krb5_kt_resolve(_context, name.c_str(), &kt);
+	if (krb5_kt_start_seq_get(_context, kt, &cursor) == 0) {
+		while (krb5_kt_next_entry(_context, kt, &entry, &cursor) == 0) {
+			CPPUNIT_ASSERT_MESSAGE(
+				"Keytab entry has the wrong principal.",
+				krb5_principal_compare(
+					_context, entry.principal, _principal
+				)
+			);
+			CPPUNIT_ASSERT_MESSAGE(
+				"Keytab entry has the wrong key.",
+				entry.keyblock.keyvalue.length == 16 &&
+				memcmp(entry.keyblock.keyvalue.data, KEY, 16) == 0
+			);
+			krb5_kt_free_entry(_context, &entry);
+			n++;
+		}
+		krb5_kt_end_seq_get(_context, kt, &cursor);
+	}
+	krb5_kt_close(_context, kt);
+	
+	return n;
+}
+
+
+void KeytabWriterTest::testWrite()
+{
+	KeytabWriter w(string("FILE:") + KEYTAB);
+	w.add(_context, _principal, 2, 17, KEY, 16, 0);
+	w.add(_context, _principal, 2, 18, KEY, 16, 0);
+	w.close();
+	
+	CPPUNIT_ASSERT_MESSAGE(
+		"Writer miscounts its entries.",
+		w.entries() == 2
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Kerberos library does not read back the written entries.",
+		count_entries(string("FILE:") + KEYTAB) == 2
+	);
+}
+
+
+void KeytabWriterTest::testAppend()
+{
+	{
+		KeytabWriter w(KEYTAB);
+		w.add(_context, _principal, 2, 17, KEY, 16, 0);
+	}
+	{
+		KeytabWriter w(KEYTAB, true);
+		w.add(_context, _principal, 3, 17, KEY, 16, 0);
+	}
+	CPPUNIT_ASSERT_MESSAGE(
+		"Appending replaced the existing entries.",
+		count_entries(string("FILE:") + KEYTAB) == 2
+	);
+}
+
+
+void KeytabWriterTest::testBadName()
+{
+	CPPUNIT_ASSERT_THROW(
+		KeytabWriter w("MEMORY:test"),
+		kadm5::error
+	);
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
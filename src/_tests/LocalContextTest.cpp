@@ -0,0 +1,126 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// Kerberos
+#include <kadm5/admin.h>
+
+// Local
+#include "../Error.hpp"
+#include "../LocalContext.hpp"
+#include "LocalContextTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::LocalContextTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+/**
+ * Count the principals matching the given expression.
+ **/
+static int count_principals(const Context& c, const char* expression)
+{
+	char** list = NULL;
+	int count = 0;
+	error::throw_on_error(
+		kadm5_get_principals(c, expression, &list, &count)
+	);
+	int ret = count;
+	kadm5_free_name_list(c, list, &count);
+	return ret;
+}
+
+
+void LocalContextTest::testOpen()
+{
+	// Uses the database of ./data/krb5.conf, i.e., ./data/test.db.
+	LocalContext c("", "", "");
+	CPPUNIT_ASSERT_MESSAGE(
+		"LocalContext did not open the database.",
+		c.connected()
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Default client is not kadmin/admin.",
+		c.client() == "kadmin/admin@TEST.LOCAL"
+	);
+	
+	u_int32_t p = 0;
+	CPPUNIT_ASSERT_MESSAGE(
+		"LocalContext lacks privileges of kadmin --local.",
+		c.initial_privileges(p) &&
+		(p & (KADM5_PRIV_GET | KADM5_PRIV_LIST)) ==
+			(KADM5_PRIV_GET | KADM5_PRIV_LIST)
+	);
+}
+
+
+void LocalContextTest::testListPrincipals()
+{
+	LocalContext c("", "", "");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Database does not hold the host principals of data/test.db.",
+		count_principals(c, "host/*") == 3
+	);
+}
+
+
+void LocalContextTest::testLazy()
+{
+	LocalContext c("", "", "", true);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Lazy LocalContext opened the database right away.",
+		!c.connected()
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Lazy LocalContext did not open the database on first use.",
+		count_principals(c, "user/admin") == 1 && c.connected()
+	);
+}
+
+
+void LocalContextTest::testClone()
+{
+	LocalContext c("", "", "");
+	shared_ptr<Context> pclone = c.clone();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Clone of LocalContext does not see the same database.",
+		count_principals(*pclone, "host/*") == 3 &&
+		pclone->realm() == c.realm()
+	);
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
@@ -0,0 +1,93 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../Connection.hpp"
+#include "../NameList.hpp"
+#include "../NameStream.hpp"
+#include "NameStreamTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::NameStreamTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+/**
+ * Filters covering the partitioned cases: everything, a plain prefix, a
+ * complete name as prefix and a prefix naming the realm.
+ **/
+static const char* FILTERS[] = {
+	"*",
+	"host*",
+	"host/a.test.local*",
+	"host/a.test.local@TEST.LOCAL*",
+	"user/admin"
+};
+
+
+void NameStreamTest::testMatchesList()
+{
+	shared_ptr<Connection> pc = Connection::from_local();
+	
+	for (size_t i = 0; i < sizeof(FILTERS) / sizeof(FILTERS[0]); i++) {
+		vector<string> listed( *pc->list_names(FILTERS[i])->strings() );
+		std::sort(listed.begin(), listed.end());
+		
+		shared_ptr<NameStream> ps = pc->stream_principals(FILTERS[i]);
+		vector<string> streamed;
+		string name;
+		while (ps->next(name)) {
+			streamed.push_back(name);
+		}
+		std::sort(streamed.begin(), streamed.end());
+		
+		CPPUNIT_ASSERT_MESSAGE(
+			string("Stream differs from list for filter ") +
+				FILTERS[i],
+			!listed.empty() && streamed == listed
+		);
+	}
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
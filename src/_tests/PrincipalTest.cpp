@@ -0,0 +1,148 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <cstring>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+// Local
+#include "../Error.hpp"
+#include "../LocalContext.hpp"
+#include "../Principal.hpp"
+#include "PrincipalTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::PrincipalTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+// Not part of data/test.db; removed again after each test.
+static const char* CREATED = "test/created.test.local";
+
+
+/**
+ * Fetch the database entry of the given principal.
+ **/
+static kadm5_ret_t fetch(
+	const Context& c,
+	const char* name,
+	kadm5_principal_ent_rec& ent,
+	const u_int32_t fields
+) {
+	krb5_principal pp = NULL;
+	error::throw_on_error( krb5_parse_name(c, name, &pp) );
+	memset(&ent, 0, sizeof(kadm5_principal_ent_rec));
+	kadm5_ret_t ret = kadm5_get_principal(c, pp, &ent, fields);
+	krb5_free_principal(c, pp);
+	return ret;
+}
+
+
+void PrincipalTest::tearDown()
+{
+	// Keep the known population of data/test.db.
+	LocalContext c("", "", "");
+	krb5_principal pp = NULL;
+	error::throw_on_error( krb5_parse_name(c, CREATED, &pp) );
+	kadm5_delete_principal(c, pp);
+	krb5_free_principal(c, pp);
+}
+
+
+void PrincipalTest::testCreate()
+{
+	shared_ptr<Context> pc( new LocalContext("", "", "") );
+	{
+		Principal p(pc, CREATED, "secret");
+		p.commit_modifications();
+		CPPUNIT_ASSERT_MESSAGE(
+			"Committed Principal does not know it exists.",
+			p.exists_on_server() && !p.modified()
+		);
+		CPPUNIT_ASSERT_MESSAGE(
+			"Committed Principal lost its name.",
+			p.id() == p.name() && p.name() == pc->qualified_name(CREATED)
+		);
+	}
+	
+	kadm5_principal_ent_rec ent;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Committed Principal is missing from the database.",
+		fetch(*pc, CREATED, ent, KADM5_PRINCIPAL) == 0
+	);
+	kadm5_free_principal_ent(*pc, &ent);
+}
+
+
+void PrincipalTest::testCreateRandomKeys()
+{
+	shared_ptr<Context> pc( new LocalContext("", "", "") );
+	{
+		Principal p(pc, CREATED);
+		p.randomize_keys();
+		p.commit_modifications();
+		CPPUNIT_ASSERT_MESSAGE(
+			"Committed Principal does not know it exists.",
+			p.exists_on_server() && !p.modified()
+		);
+	}
+	
+	kadm5_principal_ent_rec ent;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Principal with random keys is missing from the database.",
+		fetch(*pc, CREATED, ent, KADM5_ATTRIBUTES | KADM5_KVNO) == 0
+	);
+	krb5_flags attributes = ent.attributes;
+	krb5_kvno kvno = ent.kvno;
+	kadm5_free_principal_ent(*pc, &ent);
+	
+	CPPUNIT_ASSERT_MESSAGE(
+		"Principal with random keys was left locked.",
+		!(attributes & KRB5_KDB_DISALLOW_ALL_TIX)
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Principal did not get its random keys.",
+		kvno > 0
+	);
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
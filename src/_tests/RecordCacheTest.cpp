@@ -0,0 +1,227 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// STL and Boost
+#include <cstring>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+// Kerberos
+#include <krb5.h>
+#include <kadm5/admin.h>
+
+// Local
+#include "../Error.hpp"
+#include "../LocalContext.hpp"
+#include "../RecordCache.hpp"
+#include "RecordCacheTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::RecordCacheTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+using boost::posix_time::minutes;
+
+/**
+ * Parse the given principal name with the Context's Kerberos context.
+ **/
+static shared_ptr<krb5_principal_data> principal(
+	const Context& c,
+	const char* name
+) {
+	krb5_principal ptmp = NULL;
+	error::throw_on_error( krb5_parse_name(c, name, &ptmp) );
+	return shared_ptr<krb5_principal_data>(
+		ptmp, boost::bind(krb5_free_principal, (krb5_context) c, _1)
+	);
+}
+
+
+/**
+ * Store a record holding the maximum ticket life and attributes of a
+ * principal.
+ **/
+static void store(
+	RecordCache& cache,
+	const shared_ptr<krb5_principal_data>& pp,
+	const krb5_deltat max_life
+) {
+	kadm5_principal_ent_rec rec;
+	memset(&rec, 0, sizeof(kadm5_principal_ent_rec));
+	rec.max_life = max_life;
+	rec.attributes = KRB5_KDB_DISALLOW_ALL_TIX;
+	cache.store(pp.get(), &rec, KADM5_MAX_LIFE | KADM5_ATTRIBUTES);
+}
+
+
+/**
+ * Look up the given attributes of a principal.
+ **/
+static bool lookup(
+	const Context& c,
+	RecordCache& cache,
+	const shared_ptr<krb5_principal_data>& pp,
+	const u_int32_t fields,
+	kadm5_principal_ent_rec* prec =NULL
+) {
+	kadm5_principal_ent_rec rec;
+	memset(&rec, 0, sizeof(kadm5_principal_ent_rec));
+	bool ret = cache.lookup(pp.get(), &rec, fields);
+	if (prec) {
+		*prec = rec;
+	}
+	else {
+		kadm5_free_principal_ent(c, &rec);
+	}
+	return ret;
+}
+
+
+void RecordCacheTest::testFieldSubset()
+{
+	LocalContext c("", "", "");
+	RecordCache cache(c, 8, minutes(5));
+	shared_ptr<krb5_principal_data> pa = principal(c, "host/a.test.local");
+	store(cache, pa, 3600);
+	
+	kadm5_principal_ent_rec rec;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Lookup of a stored attribute failed.",
+		lookup(c, cache, pa, KADM5_MAX_LIFE, &rec) &&
+		rec.max_life == 3600
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Lookup including the always known name failed.",
+		lookup(c, cache, pa, KADM5_PRINCIPAL | KADM5_ATTRIBUTES)
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Lookup of an attribute that was not stored succeeded.",
+		!lookup(c, cache, pa, KADM5_MAX_LIFE | KADM5_PW_EXPIRATION)
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Lookups were not counted.",
+		cache.hits() == 2 && cache.misses() == 1
+	);
+}
+
+
+void RecordCacheTest::testEviction()
+{
+	LocalContext c("", "", "");
+	RecordCache cache(c, 2, minutes(5));
+	shared_ptr<krb5_principal_data> pa = principal(c, "host/a.test.local");
+	shared_ptr<krb5_principal_data> pb = principal(c, "host/b.test.local");
+	shared_ptr<krb5_principal_data> pc = principal(c, "host/c.test.local");
+	
+	store(cache, pa, 1);
+	store(cache, pb, 2);
+	// Makes b the least recently used entry.
+	lookup(c, cache, pa, KADM5_MAX_LIFE);
+	store(cache, pc, 3);
+	
+	CPPUNIT_ASSERT_MESSAGE(
+		"Cache grew beyond its capacity.",
+		cache.size() == 2
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Least recently used entry was not evicted.",
+		!lookup(c, cache, pb, KADM5_MAX_LIFE)
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Recently used entries were evicted.",
+		lookup(c, cache, pa, KADM5_MAX_LIFE) &&
+		lookup(c, cache, pc, KADM5_MAX_LIFE)
+	);
+	
+	store(cache, pa, 4);
+	kadm5_principal_ent_rec rec;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Storing an entry again did not replace it.",
+		cache.size() == 2 &&
+		lookup(c, cache, pa, KADM5_MAX_LIFE, &rec) &&
+		rec.max_life == 4
+	);
+}
+
+
+void RecordCacheTest::testExpiry()
+{
+	LocalContext c("", "", "");
+	RecordCache cache(c, 8, minutes(0));
+	shared_ptr<krb5_principal_data> pa = principal(c, "host/a.test.local");
+	store(cache, pa, 3600);
+	
+	CPPUNIT_ASSERT_MESSAGE(
+		"Expired entry was returned.",
+		!lookup(c, cache, pa, KADM5_MAX_LIFE)
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Expired entry was not dropped on lookup.",
+		cache.size() == 0
+	);
+}
+
+
+void RecordCacheTest::testInvalidate()
+{
+	LocalContext c("", "", "");
+	RecordCache cache(c, 8, minutes(5));
+	shared_ptr<krb5_principal_data> pa = principal(c, "host/a.test.local");
+	shared_ptr<krb5_principal_data> pb = principal(c, "host/b.test.local");
+	store(cache, pa, 1);
+	store(cache, pb, 2);
+	
+	cache.invalidate(pa.get());
+	CPPUNIT_ASSERT_MESSAGE(
+		"Invalidated entry was returned.",
+		!lookup(c, cache, pa, KADM5_MAX_LIFE)
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Invalidating dropped other entries.",
+		cache.size() == 1 && lookup(c, cache, pb, KADM5_MAX_LIFE)
+	);
+	
+	cache.clear();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Clearing left entries behind.",
+		cache.size() == 0 && !lookup(c, cache, pb, KADM5_MAX_LIFE)
+	);
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
@@ -0,0 +1,190 @@
+/******************************************************************************
+ *                                                                            *
+ *  Copyright (c) 2006 Peter Dinges <pdinges@acm.org>                           *
+ *  All rights reserved.                                                      *
+ *                                                                            *
+ *  Redistribution and use in source and binary forms, with or without        *
+ *  modification, are permitted provided that the following conditions        *
+ *  are met:                                                                  *
+ *                                                                            *
+ *  1. Redistributions of source code must retain the above copyright         *
+ *     notice, this list of conditions and the following disclaimer.          *
+ *                                                                            *
+ *  2. Redistributions in binary form must reproduce the above copyright      *
+ *     notice, this list of conditions and the following disclaimer in the    *
+ *     documentation and/or other materials provided with the distribution.   *
+ *                                                                            *
+ *  3. The name of the author may not be used to endorse or promote products  *
+ *     derived from this software without specific prior written permission.  *
+ *                                                                            *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR      *
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES *
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.   *
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,          *
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT  *
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, *
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF  *
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.         *
+ *                                                                            *
+ *****************************************************************************/
+
+
+// System libs for tests
+#include <string.h>
+#include <unistd.h>
+
+// STL and Boost
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+// Local
+#include "../SecureBuffer.hpp"
+#include "SecureBufferTest.hpp"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION (kadm5::_test::SecureBufferTest);
+
+
+namespace kadm5
+{
+namespace _test
+{
+
+static const char SECRET[] = "0123456789abcdef";
+
+
+void SecureBufferTest::testZeroed()
+{
+	shared_ptr<SecurePool> pool( new SecurePool(64, 1) );
+	SecureBuffer b(48, pool);
+	
+	bool zeroed = true;
+	for (size_t i = 0; i < b.size(); i++) {
+		zeroed = zeroed && (b.data()[i] == 0);
+	}
+	CPPUNIT_ASSERT_MESSAGE("New buffer is not zeroed.", zeroed);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Pool uses the wrong slot size.",
+		pool->slot_size() == 64
+	);
+}
+
+
+void SecureBufferTest::testReuse()
+{
+	shared_ptr<SecurePool> pool( new SecurePool(64, 1) );
+	
+	char* p = NULL;
+	{
+		SecureBuffer b(sizeof(SECRET), pool);
+		p = b.data();
+		CPPUNIT_ASSERT_MESSAGE(
+			"Slot not counted as in use.",
+			pool->usage().slots_in_use == 1
+		);
+	}
+	CPPUNIT_ASSERT_MESSAGE(
+		"Released slot still counted as in use.",
+		pool->usage().slots_in_use == 0
+	);
+	
+	SecureBuffer b(sizeof(SECRET), pool);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Released slot is not reused first.",
+		b.data() == p
+	);
+	SecurePool::Usage u = pool->usage();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Reuse not counted.",
+		u.acquired == 2 && u.reused == 1 && u.peak_slots_in_use == 1
+	);
+}
+
+
+void SecureBufferTest::testWipe()
+{
+	shared_ptr<SecurePool> pool( new SecurePool(64, 1) );
+	
+	char* p = NULL;
+	{
+		SecureBuffer b(sizeof(SECRET), pool);
+		memcpy(b.data(), SECRET, sizeof(SECRET));
+		p = b.data();
+	}
+	// The slot stays mapped while the pool exists.
+	bool wiped = true;
+	for (size_t i = 0; i < pool->slot_size(); i++) {
+		wiped = wiped && (p[i] == 0);
+	}
+	CPPUNIT_ASSERT_MESSAGE("Released slot was not wiped.", wiped);
+	
+	char buffer[sizeof(SECRET)];
+	memcpy(buffer, SECRET, sizeof(SECRET));
+	secure_wipe(buffer, sizeof(buffer));
+	CPPUNIT_ASSERT_MESSAGE(
+		"secure_wipe() leaves data behind.",
+		buffer[0] == 0 && buffer[sizeof(buffer) - 1] == 0
+	);
+}
+
+
+void SecureBufferTest::testRegions()
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	shared_ptr<SecurePool> pool( new SecurePool(64, 1) );
+	size_t per_region = page / 64;
+	
+	std::vector< shared_ptr<SecureBuffer> > buffers;
+	for (size_t i = 0; i <= per_region; i++) {
+		buffers.push_back(
+			shared_ptr<SecureBuffer>( new SecureBuffer(64, pool) )
+		);
+		// Writing up to the slot end must not fault.
+		memset(buffers.back()->data(), 0x55, 64);
+	}
+	SecurePool::Usage u = pool->usage();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Full region does not make the pool grow.",
+		u.regions == 2 && u.slots == 2 * per_region
+	);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Slots handed out twice.",
+		buffers[0]->data() != buffers[1]->data()
+	);
+	
+	buffers.clear();
+	u = pool->usage();
+	CPPUNIT_ASSERT_MESSAGE(
+		"Regions are not kept for reuse.",
+		u.regions == 2 && u.slots_in_use == 0 &&
+		u.peak_slots_in_use == per_region + 1
+	);
+}
+
+
+void SecureBufferTest::testOversized()
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	shared_ptr<SecurePool> pool( new SecurePool(64, 1) );
+	{
+		SecureBuffer b(page + 1, pool);
+		memset(b.data(), 0x55, b.size());
+		CPPUNIT_ASSERT_MESSAGE(
+			"Oversized buffer not counted.",
+			pool->usage().oversized_in_use == 1
+		);
+		CPPUNIT_ASSERT_MESSAGE(
+			"Oversized buffer taken from a region.",
+			pool->usage().regions == 0
+		);
+	}
+	CPPUNIT_ASSERT_MESSAGE(
+		"Oversized buffer not returned.",
+		pool->usage().oversized_in_use == 0
+	);
+}
+
+} /* namespace _test */
+} /* namespace kadm5 */
@@ -36,11 +36,19 @@
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include "Connection.hpp"
+#include "ConnectionPool.hpp"
 #include "Error.hpp"
+#include "HdbScanner.hpp"
+#include "KeytabWriter.hpp"
+#include "NameList.hpp"
+#include "NameStream.hpp"
+#include "PartitionedNameStream.hpp"
+#include "PrincipalSet.hpp"
 #include "RandomPassword.hpp"
 #include "Principal.hpp"
 
@@ -74,21 +82,386 @@ struct time_duration_to_int
 };
 
 
+/*
+ * Iterator protocol for NameStream
+ */
+py::object NameStream_iter(py::object self)
+{
+	return self;
+}
+
+
+string NameStream_next(kadm5::NameStream& s)
+{
+	string name;
+	if (!s.next(name)) {
+		PyErr_SetNone(PyExc_StopIteration);
+		py::throw_error_already_set();
+	}
+	return name;
+}
+
+
+string PartitionedNameStream_next(kadm5::PartitionedNameStream& s)
+{
+	// Let the stream's threads deliver while waiting.
+	string name;
+	bool found = false;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		found = s.next(name);
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	if (!found) {
+		PyErr_SetNone(PyExc_StopIteration);
+		py::throw_error_already_set();
+	}
+	return name;
+}
+
+
+/*
+ * HdbScanner helpers
+ */
+py::object HdbScanner_iter(py::object self)
+{
+	return self;
+}
+
+
+kadm5::ScannedPrincipal HdbScanner_next(kadm5::HdbScanner& s)
+{
+	kadm5::ScannedPrincipal record;
+	if (!s.next(record)) {
+		PyErr_SetNone(PyExc_StopIteration);
+		py::throw_error_already_set();
+	}
+	return record;
+}
+
+
+py::list HdbScanner_scan(
+	const string& dbname,
+	const unsigned int workers
+)
+{
+	// Let other Python threads run while the database is read.
+	shared_ptr< vector<kadm5::ScannedPrincipal> > precords;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		precords = kadm5::HdbScanner::scan(dbname, workers);
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	
+	py::list ret;
+	for (size_t i = 0; i < precords->size(); i++) {
+		ret.append((*precords)[i]);
+	}
+	return ret;
+}
+
+
+/*
+ * Sequence protocol for NameList
+ */
+string NameList_getitem(const kadm5::NameList& list, long i)
+{
+	if (i < 0) {
+		i += list.size();
+	}
+	if (i < 0 || (size_t) i >= list.size()) {
+		PyErr_SetString(PyExc_IndexError, "NameList index out of range");
+		py::throw_error_already_set();
+	}
+	return list[i];
+}
+
+
+/*
+ * Sequence protocol for PrincipalSet
+ */
+kadm5::PrincipalSet::Entry PrincipalSet_getitem(
+	const kadm5::PrincipalSet& set,
+	long i
+)
+{
+	if (i < 0) {
+		i += set.size();
+	}
+	if (i < 0 || (size_t) i >= set.size()) {
+		PyErr_SetString(PyExc_IndexError, "PrincipalSet index out of range");
+		py::throw_error_already_set();
+	}
+	return set[i];
+}
+
+
+/*
+ * Connection helpers
+ */
+void Connection_enable_record_cache(
+	const kadm5::Connection& conn,
+	const size_t capacity,
+	const long ttl
+)
+{
+	conn.enable_record_cache(capacity, boost::posix_time::seconds(ttl));
+}
+
+
+py::list Connection_admin_servers(const kadm5::Connection& conn)
+{
+	py::list ret;
+	vector<string> servers = conn.admin_servers();
+	for (size_t i = 0; i < servers.size(); i++) {
+		ret.append(servers[i]);
+	}
+	return ret;
+}
+
+
+void Connection_set_admin_servers(
+	kadm5::Connection& conn,
+	py::object servers
+)
+{
+	py::stl_input_iterator<string> begin(servers);
+	py::stl_input_iterator<string> end;
+	conn.set_admin_servers(vector<string>(begin, end));
+}
+
+
+void Connection_set_retry_policy(
+	kadm5::Connection& conn,
+	const unsigned int retries,
+	const double backoff
+)
+{
+	conn.set_retry_policy(
+		retries,
+		boost::posix_time::microseconds((long) (backoff * 1e6))
+	);
+}
+
+
+void Connection_reconnect(const kadm5::Connection& conn)
+{
+	// Let other Python threads run while trying the servers.
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		conn.reconnect();
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+}
+
+
+double Connection_reconnect_time(const kadm5::Connection& conn)
+{
+	return conn.reconnect_time().total_microseconds() / 1e6;
+}
+
+
+shared_ptr<kadm5::Connection::BatchResult> Connection_commit_batch(
+	const kadm5::Connection& conn,
+	py::object principals,
+	const unsigned int handles
+)
+{
+	// Accept any iterable, e.g., lists and PrincipalVectors.
+	py::stl_input_iterator< shared_ptr<kadm5::Principal> > begin(principals);
+	py::stl_input_iterator< shared_ptr<kadm5::Principal> > end;
+	vector< shared_ptr<kadm5::Principal> > batch(begin, end);
+	
+	shared_ptr<kadm5::Connection::BatchResult> pret;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		pret = conn.commit_batch(batch, handles);
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return pret;
+}
+
+
+shared_ptr<kadm5::PrincipalSet> Connection_get_principal_set(
+	const kadm5::Connection& conn,
+	const string& filter,
+	const u_int32_t fields,
+	const unsigned int handles
+)
+{
+	shared_ptr<kadm5::PrincipalSet> pret;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		pret = conn.get_principal_set(filter, fields, handles);
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return pret;
+}
+
+
+shared_ptr<kadm5::Connection::BatchResult> Connection_export_keytab(
+	const kadm5::Connection& conn,
+	py::object names,
+	py::object writers,
+	const bool randomize,
+	const unsigned int handles,
+	const size_t batch_size
+)
+{
+	py::stl_input_iterator<string> names_begin(names);
+	py::stl_input_iterator<string> names_end;
+	vector<string> batch(names_begin, names_end);
+	
+	// Accept a single writer or an iterable with one per name.
+	vector< shared_ptr<kadm5::KeytabWriter> > targets;
+	py::extract< shared_ptr<kadm5::KeytabWriter> > single(writers);
+	if (single.check()) {
+		targets.push_back(single());
+	}
+	else {
+		py::stl_input_iterator< shared_ptr<kadm5::KeytabWriter> >
+			writers_begin(writers);
+		py::stl_input_iterator< shared_ptr<kadm5::KeytabWriter> >
+			writers_end;
+		targets.assign(writers_begin, writers_end);
+	}
+	
+	shared_ptr<kadm5::Connection::BatchResult> pret;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		pret = conn.export_keytab(
+			batch, targets, randomize, handles, batch_size
+		);
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return pret;
+}
+
+
+py::list BatchResult_errors(const kadm5::Connection::BatchResult& r)
+{
+	py::list ret;
+	for (size_t i = 0; i < r.errors.size(); i++) {
+		ret.append(r.errors[i]);
+	}
+	return ret;
+}
+
+
+/*
+ * ConnectionPool helpers
+ */
+shared_ptr<kadm5::Connection> ConnectionPool_acquire(
+	kadm5::ConnectionPool& pool,
+	py::object timeout
+)
+{
+	time_duration t = boost::posix_time::pos_infin;
+	if (!timeout.is_none()) {
+		double seconds = py::extract<double>(timeout);
+		t = boost::posix_time::microseconds((long) (seconds * 1e6));
+	}
+	
+	// Let other Python threads run (and return their Connections)
+	// while waiting.
+	shared_ptr<kadm5::Connection> pret;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		pret = pool.acquire(t);
+	}
+	catch (...) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return pret;
+}
+
+
+shared_ptr<kadm5::Connection> ConnectionPool_acquire_blocking(
+	kadm5::ConnectionPool& pool
+)
+{
+	return ConnectionPool_acquire(pool, py::object());
+}
+
+
 BOOST_PYTHON_FUNCTION_OVERLOADS(
 	Connection_from_password_overloads,
 	kadm5::Connection::from_password,
-	1, 5
+	1, 6
+);
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(
+	Connection_from_keytab_overloads,
+	kadm5::Connection::from_keytab,
+	0, 6
+);
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(
+	Connection_from_local_overloads,
+	kadm5::Connection::from_local,
+	0, 4
 );
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(
 	Connection_from_credential_cache_overloads,
 	kadm5::Connection::from_credential_cache,
-	0, 4
+	0, 5
+);
+BOOST_PYTHON_FUNCTION_OVERLOADS(
+	ConnectionPool_from_password_overloads,
+	kadm5::ConnectionPool::from_password,
+	2, 6
+);
+BOOST_PYTHON_FUNCTION_OVERLOADS(
+	ConnectionPool_from_keytab_overloads,
+	kadm5::ConnectionPool::from_keytab,
+	1, 6
+);
+BOOST_PYTHON_FUNCTION_OVERLOADS(
+	ConnectionPool_from_credential_cache_overloads,
+	kadm5::ConnectionPool::from_credential_cache,
+	1, 5
 );
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(
 	Connection_create_principal_overloads,
 	kadm5::Connection::create_principal,
-	1, 2
+	1, 3
+);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(
+	Connection_get_principals_overloads,
+	kadm5::Connection::get_principals,
+	1, 3
+);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(
+	Principal_load_overloads,
+	kadm5::Principal::load,
+	0, 1
 );
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(
 	Principal_randomize_password_overloads,
@@ -109,6 +482,9 @@ BOOST_PYTHON_MODULE(kadm5)
 	 */
 	py::register_ptr_to_python< shared_ptr<kadm5::Connection> >();
 	py::register_ptr_to_python< shared_ptr<kadm5::Principal> >();
+	py::register_ptr_to_python<
+		shared_ptr<kadm5::Connection::BatchResult>
+	>();
 	py::register_ptr_to_python< shared_ptr< vector<string> > >();
 	py::register_ptr_to_python< shared_ptr< vector< shared_ptr<kadm5::Principal> > > >();
 
@@ -124,6 +500,159 @@ BOOST_PYTHON_MODULE(kadm5)
 		)
 	;
 	
+	py::class_<
+		kadm5::NameStream,
+		shared_ptr<kadm5::NameStream>,
+		boost::noncopyable
+	>("NameStream", py::no_init)
+		.def("__iter__", NameStream_iter)
+		.def("next", NameStream_next)
+	;
+	
+	py::class_<
+		kadm5::PartitionedNameStream,
+		shared_ptr<kadm5::PartitionedNameStream>,
+		boost::noncopyable
+	>("PartitionedNameStream", py::no_init)
+		.def("__iter__", NameStream_iter)
+		.def("next", PartitionedNameStream_next)
+		.add_property(
+			"partitions",
+			&kadm5::PartitionedNameStream::partitions
+		)
+	;
+	
+	py::class_<kadm5::ScannedPrincipal>("ScannedPrincipal", py::no_init)
+		.add_property(
+			"name",
+			py::make_function(
+				&kadm5::ScannedPrincipal::name,
+				py::return_value_policy<py::copy_const_reference>()
+			)
+		)
+		.add_property(
+			"expire_time",
+			&kadm5::ScannedPrincipal::expire_time
+		)
+		.add_property(
+			"password_expiration",
+			&kadm5::ScannedPrincipal::password_expiration
+		)
+		.add_property(
+			"max_lifetime",
+			&kadm5::ScannedPrincipal::max_lifetime
+		)
+		.add_property(
+			"max_renewable_lifetime",
+			&kadm5::ScannedPrincipal::max_renewable_lifetime
+		)
+		.add_property(
+			"modifier",
+			py::make_function(
+				&kadm5::ScannedPrincipal::modifier,
+				py::return_value_policy<py::copy_const_reference>()
+			)
+		)
+		.add_property(
+			"modify_time",
+			&kadm5::ScannedPrincipal::modify_time
+		)
+		.add_property(
+			"last_password_change",
+			&kadm5::ScannedPrincipal::last_password_change
+		)
+		.add_property(
+			"last_success",
+			&kadm5::ScannedPrincipal::last_success
+		)
+		.add_property(
+			"last_failed",
+			&kadm5::ScannedPrincipal::last_failed
+		)
+		.add_property(
+			"key_version",
+			&kadm5::ScannedPrincipal::key_version
+		)
+	;
+	
+	py::class_<
+		kadm5::NameList,
+		shared_ptr<kadm5::NameList>,
+		boost::noncopyable
+	>("NameList", py::no_init)
+		.def("__len__", &kadm5::NameList::size)
+		.def("__getitem__", NameList_getitem)
+		.def("strings", &kadm5::NameList::strings)
+	;
+	py::class_<kadm5::PrincipalSet::Entry>(
+		"PrincipalSetEntry",
+		py::no_init
+	)
+		.add_property("name", &kadm5::PrincipalSet::Entry::name)
+		.add_property(
+			"expire_time",
+			&kadm5::PrincipalSet::Entry::expire_time
+		)
+		.add_property(
+			"password_expiration",
+			&kadm5::PrincipalSet::Entry::password_expiration
+		)
+		.add_property(
+			"max_lifetime",
+			&kadm5::PrincipalSet::Entry::max_lifetime
+		)
+		.add_property(
+			"max_renewable_lifetime",
+			&kadm5::PrincipalSet::Entry::max_renewable_lifetime
+		)
+		.add_property("modifier", &kadm5::PrincipalSet::Entry::modifier)
+		.add_property(
+			"modify_time",
+			&kadm5::PrincipalSet::Entry::modify_time
+		)
+		.add_property(
+			"last_password_change",
+			&kadm5::PrincipalSet::Entry::last_password_change
+		)
+		.add_property(
+			"last_success",
+			&kadm5::PrincipalSet::Entry::last_success
+		)
+		.add_property(
+			"last_failed",
+			&kadm5::PrincipalSet::Entry::last_failed
+		)
+	;
+	py::class_<
+		kadm5::PrincipalSet,
+		shared_ptr<kadm5::PrincipalSet>,
+		boost::noncopyable
+	>("PrincipalSet", py::no_init)
+		.def("__len__", &kadm5::PrincipalSet::size)
+		.def(
+			"__getitem__",
+			PrincipalSet_getitem,
+			// Entries refer to the set; keep it alive.
+			py::with_custodian_and_ward_postcall<0, 1>()
+		)
+		.def("principal", &kadm5::PrincipalSet::principal)
+		.add_property("fields", &kadm5::PrincipalSet::fields)
+	;
+	py::class_<kadm5::HdbScanner, boost::noncopyable>(
+		"HdbScanner",
+		py::init< py::optional<string> >( (py::arg("dbname")="") )
+	)
+		.def("__iter__", HdbScanner_iter)
+		.def("next", HdbScanner_next)
+		.add_property("position", &kadm5::HdbScanner::position)
+		.def(
+			"scan",
+			HdbScanner_scan,
+			(py::arg("dbname")="", py::arg("workers")=1)
+		)
+		.staticmethod("scan")
+	;
+	
 	py::to_python_converter<ptime, ptime_to_int>();
 	py::to_python_converter<time_duration, time_duration_to_int>();
 	
@@ -140,8 +669,45 @@ BOOST_PYTHON_MODULE(kadm5)
 		.def("delete_principal", &kadm5::Connection::delete_principal)
 
 		.def("get_principal", &kadm5::Connection::get_principal)
-		.def("get_principals", &kadm5::Connection::get_principals)
+		.def(
+			"get_principals",
+			&kadm5::Connection::get_principals,
+			Connection_get_principals_overloads()
+		)
+		.def(
+			"get_principal_set",
+			Connection_get_principal_set,
+			(
+				py::arg("filter"),
+				py::arg("fields")=(u_int32_t)
+					kadm5::Principal::default_fields,
+				py::arg("handles")=1
+			)
+		)
 		.def("list_principals", &kadm5::Connection::list_principals)
+		.def("list_names", &kadm5::Connection::list_names)
+		.def(
+			"commit_batch",
+			Connection_commit_batch,
+			(py::arg("principals"), py::arg("handles")=4)
+		)
+		.def(
+			"export_keytab",
+			Connection_export_keytab,
+			(
+				py::arg("names"),
+				py::arg("writers"),
+				py::arg("randomize")=false,
+				py::arg("handles")=4,
+				py::arg("batch_size")=64
+			)
+		)
+		.def("stream_principals", &kadm5::Connection::stream_principals)
+		.def(
+			"stream_principals_partitioned",
+			&kadm5::Connection::stream_principals_partitioned,
+			(py::arg("filter"), py::arg("handles")=4)
+		)
 
 		.add_property("may_get", &kadm5::Connection::may_get)
 		.add_property("may_add", &kadm5::Connection::may_add)
@@ -150,11 +716,55 @@ BOOST_PYTHON_MODULE(kadm5)
 		.add_property("may_list", &kadm5::Connection::may_list)
 		.add_property("may_change_password", &kadm5::Connection::may_change_password)
 		.add_property("may_all", &kadm5::Connection::may_all)
+		.def(
+			"refresh_privileges",
+			&kadm5::Connection::refresh_privileges
+		)
+		.def(
+			"enable_record_cache",
+			Connection_enable_record_cache,
+			(py::arg("capacity")=1024, py::arg("ttl")=30)
+		)
+		.def(
+			"disable_record_cache",
+			&kadm5::Connection::disable_record_cache
+		)
+		.add_property(
+			"record_cache_hits",
+			&kadm5::Connection::record_cache_hits
+		)
+		.add_property(
+			"record_cache_misses",
+			&kadm5::Connection::record_cache_misses
+		)
+		.add_property(
+			"privilege_queries",
+			&kadm5::Connection::privilege_queries
+		)
 
 		.add_property("client", &kadm5::Connection::client)
 		.add_property("realm", &kadm5::Connection::realm)
 		.add_property("host", &kadm5::Connection::host)
 		.add_property("port", &kadm5::Connection::port)
+		.def("reload_config", &kadm5::Connection::reload_config)
+		.add_property("connected", &kadm5::Connection::connected)
+		.add_property(
+			"admin_servers",
+			Connection_admin_servers,
+			Connection_set_admin_servers
+		)
+		.def(
+			"set_endpoint_order",
+			&kadm5::Connection::set_endpoint_order
+		)
+		.def(
+			"set_retry_policy",
+			Connection_set_retry_policy,
+			(py::arg("retries")=3, py::arg("backoff")=0.25)
+		)
+		.def("reconnect", Connection_reconnect)
+		.add_property("reconnects", &kadm5::Connection::reconnects)
+		.add_property("reconnect_time", Connection_reconnect_time)
 
 		/* Factory methods */
 		.def(
@@ -163,6 +773,18 @@ BOOST_PYTHON_MODULE(kadm5)
 			Connection_from_password_overloads()
 		)
 		.staticmethod("from_password")
+		.def(
+			"from_keytab",
+			kadm5::Connection::from_keytab,
+			Connection_from_keytab_overloads()
+		)
+		.staticmethod("from_keytab")
+		.def(
+			"from_local",
+			kadm5::Connection::from_local,
+			Connection_from_local_overloads()
+		)
+		.staticmethod("from_local")
 		.def(
 			"from_credential_cache",
 			kadm5::Connection::from_credential_cache,
@@ -171,6 +793,132 @@ BOOST_PYTHON_MODULE(kadm5)
 		.staticmethod("from_credential_cache")
 	;
 	
+	/*
+	 * ConnectionPool
+	 */
+	py::class_<
+		kadm5::ConnectionPool,
+		shared_ptr<kadm5::ConnectionPool>,
+		boost::noncopyable
+	>("ConnectionPool", py::no_init)
+		.def("acquire", ConnectionPool_acquire)
+		.def("acquire", ConnectionPool_acquire_blocking)
+		.def(
+			"stream_principals_partitioned",
+			&kadm5::ConnectionPool::stream_principals_partitioned,
+			(py::arg("filter"), py::arg("handles")=4)
+		)
+		.add_property("size", &kadm5::ConnectionPool::size)
+		.add_property("statistics", &kadm5::ConnectionPool::statistics)
+		.def(
+			"from_password",
+			kadm5::ConnectionPool::from_password,
+			ConnectionPool_from_password_overloads()
+		)
+		.staticmethod("from_password")
+		.def(
+			"from_keytab",
+			kadm5::ConnectionPool::from_keytab,
+			ConnectionPool_from_keytab_overloads()
+		)
+		.staticmethod("from_keytab")
+		.def(
+			"from_credential_cache",
+			kadm5::ConnectionPool::from_credential_cache,
+			ConnectionPool_from_credential_cache_overloads()
+		)
+		.staticmethod("from_credential_cache")
+	;
+	
+	py::class_<kadm5::ConnectionPool::Statistics>(
+		"ConnectionPoolStatistics",
+		py::no_init
+	)
+		.def_readonly("size", &kadm5::ConnectionPool::Statistics::size)
+		.def_readonly("open", &kadm5::ConnectionPool::Statistics::open)
+		.def_readonly("in_use", &kadm5::ConnectionPool::Statistics::in_use)
+		.def_readonly(
+			"acquisitions",
+			&kadm5::ConnectionPool::Statistics::acquisitions
+		)
+		.def_readonly("waits", &kadm5::ConnectionPool::Statistics::waits)
+		.def_readonly(
+			"timeouts",
+			&kadm5::ConnectionPool::Statistics::timeouts
+		)
+		.def_readonly(
+			"replacements",
+			&kadm5::ConnectionPool::Statistics::replacements
+		)
+		.add_property(
+			"total_wait",
+			py::make_getter(
+				&kadm5::ConnectionPool::Statistics::total_wait,
+				py::return_value_policy<py::return_by_value>()
+			)
+		)
+		.add_property(
+			"max_wait",
+			py::make_getter(
+				&kadm5::ConnectionPool::Statistics::max_wait,
+				py::return_value_policy<py::return_by_value>()
+			)
+		)
+	;
+	
+	py::class_<kadm5::Connection::BatchResult>("BatchResult", py::no_init)
+		.add_property("errors", BatchResult_errors)
+		.def_readonly(
+			"committed",
+			&kadm5::Connection::BatchResult::committed
+		)
+		.def_readonly("failed", &kadm5::Connection::BatchResult::failed)
+		.add_property(
+			"elapsed",
+			py::make_getter(
+				&kadm5::Connection::BatchResult::elapsed,
+				py::return_value_policy<py::return_by_value>()
+			)
+		)
+		.add_property(
+			"throughput",
+			&kadm5::Connection::BatchResult::throughput
+		)
+	;
+	
+	/*
+	 * KeytabWriter
+	 */
+	py::class_<
+		kadm5::KeytabWriter,
+		shared_ptr<kadm5::KeytabWriter>,
+		boost::noncopyable
+	>(
+		"KeytabWriter",
+		py::init<string, py::optional<bool, size_t> >(
+			(
+				py::arg("name"),
+				py::arg("append")=false,
+				py::arg("buffer_size")=65536
+			)
+		)
+	)
+		.def("flush", &kadm5::KeytabWriter::flush)
+		.def("close", &kadm5::KeytabWriter::close)
+		.add_property("path", &kadm5::KeytabWriter::path)
+		.add_property("entries", &kadm5::KeytabWriter::entries)
+	;
+	
+	py::enum_<kadm5::Connection::CreateMode>("CreateMode")
+		.value("checked", kadm5::Connection::create_checked)
+		.value("optimistic", kadm5::Connection::create_optimistic)
+	;
+	
+	py::enum_<kadm5::Context::EndpointOrder>("EndpointOrder")
+		.value("in_order", kadm5::Context::endpoints_in_order)
+		.value("by_latency", kadm5::Context::endpoints_by_latency)
+	;
+	
 	/*
 	 * Principal
 	 */
@@ -184,6 +932,20 @@ BOOST_PYTHON_MODULE(kadm5)
 			"commit_modifications",
 			&kadm5::Principal::commit_modifications
 		)
+		.def(
+			"plan_commit",
+			static_cast<
+				const kadm5::Principal::CommitPlan
+					(kadm5::Principal::*)() const
+			>(&kadm5::Principal::plan_commit)
+		)
+		.def(
+			"load",
+			static_cast<void (kadm5::Principal::*)(const u_int32_t) const>(
+				&kadm5::Principal::load
+			),
+			Principal_load_overloads()
+		)
 		
 		.add_property("id", &kadm5::Principal::id)
 		.add_property(
@@ -197,7 +959,7 @@ BOOST_PYTHON_MODULE(kadm5)
 			&kadm5::Principal::randomize_password,
 			Principal_randomize_password_overloads()
 		)
-//		.def("randomize_keys")
+		.def("randomize_keys", &kadm5::Principal::randomize_keys)
 		
 		.add_property(
 			"expire_time",
@@ -235,6 +997,50 @@ BOOST_PYTHON_MODULE(kadm5)
 		.add_property("last_failed", &kadm5::Principal::last_failed)
 	;
 	
+	py::class_<kadm5::Principal::CommitPlan>("CommitPlan", py::no_init)
+		.def_readonly("probed", &kadm5::Principal::CommitPlan::probed)
+		.def_readonly("create", &kadm5::Principal::CommitPlan::create)
+		.def_readonly(
+			"create_mask",
+			&kadm5::Principal::CommitPlan::create_mask
+		)
+		.def_readonly(
+			"change_password",
+			&kadm5::Principal::CommitPlan::change_password
+		)
+		.def_readonly(
+			"randomize_keys",
+			&kadm5::Principal::CommitPlan::randomize_keys
+		)
+		.def_readonly("rename", &kadm5::Principal::CommitPlan::rename)
+		.def_readonly(
+			"modify_mask",
+			&kadm5::Principal::CommitPlan::modify_mask
+		)
+		.add_property("requests", &kadm5::Principal::CommitPlan::requests)
+	;
+	
+	py::enum_<kadm5::Principal::Field>("Field")
+		.value("expire_time", kadm5::Principal::field_expire_time)
+		.value(
+			"password_expiration",
+			kadm5::Principal::field_password_expiration
+		)
+		.value(
+			"last_password_change",
+			kadm5::Principal::field_last_password_change
+		)
+		.value("max_lifetime", kadm5::Principal::field_max_lifetime)
+		.value(
+			"max_renewable_lifetime",
+			kadm5::Principal::field_max_renewable_lifetime
+		)
+		.value("modifier", kadm5::Principal::field_modifier)
+		.value("modify_time", kadm5::Principal::field_modify_time)
+		.value("last_success", kadm5::Principal::field_last_success)
+		.value("last_failed", kadm5::Principal::field_last_failed)
+	;
+	
 	py::def(
 		"random_password",
 		&kadm5::random_password,